@@ -0,0 +1,55 @@
+// Repeated-run memory benchmark: build with `make bench`.
+// Elaborates and simulates the same design many times, the way repeated "Run Simulation" clicks do,
+// and prints the resident set size as it goes. With the circuit arena it should stay flat.
+#include "../includes/Interpreter.h"
+#include "../includes/Arena.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+static size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+int main(int argc, char** argv) {
+    const std::string design = argc > 1 ? argv[1] : "examples/4-bit Shift Register.txt";
+    const std::string testbench = argc > 2 ? argv[2] : "";
+    const int runs = argc > 3 ? std::stoi(argv[3]) : 1000;
+
+    // The interpreter logs every wire and gate it creates
+    std::ostringstream sink;
+    std::streambuf* console = std::cout.rdbuf(sink.rdbuf());
+    std::streambuf* errors = std::cerr.rdbuf(sink.rdbuf());
+
+    size_t firstRss = 0;
+    for (int run = 1; run <= runs; ++run) {
+        waveform.clear();
+        Interpreter::runSimulation(design, testbench, 20);
+        sink.str("");
+        if (run == 1) firstRss = residentBytes();
+        if (run == 1 || run % (runs / 10 > 0 ? runs / 10 : 1) == 0) {
+            std::fprintf(stdout, "run %5d  rss %8zu KiB  arena %6zu KiB used / %6zu KiB reserved\n", run,
+                         residentBytes() / 1024, Arena::circuit.used() / 1024, Arena::circuit.reserved() / 1024);
+        }
+    }
+    std::cout.rdbuf(console);
+    std::cerr.rdbuf(errors);
+    std::printf("RSS growth after run 1: %lld KiB\n", (static_cast<long long>(residentBytes()) - static_cast<long long>(firstRss)) / 1024);
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Gate kernel benchmark: build with `make bench`.
+// Evaluates a synthetic netlist of random two-input gates, grouped into runs by type the way the compiler
+// groups them, with every kernel variant at a few lane widths.
+#include "../includes/GateKernels.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static constexpr size_t WIRES = 1 << 16;
+static constexpr size_t GATES_PER_RUN = 4096;
+static constexpr size_t RUNS = 16;
+
+int main() {
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<uint32_t> pickWire(0, WIRES - 1);
+    std::vector<uint32_t> inputA(RUNS * GATES_PER_RUN), inputB(RUNS * GATES_PER_RUN), output(RUNS * GATES_PER_RUN);
+    for (size_t g = 0; g < inputA.size(); ++g) {
+        inputA[g] = pickWire(random);
+        inputB[g] = pickWire(random);
+        output[g] = pickWire(random);
+    }
+    const NODE_OP ops[] = {NODE_OP::AND, NODE_OP::OR, NODE_OP::NOT, NODE_OP::XOR, NODE_OP::NAND, NODE_OP::NOR, NODE_OP::XNOR};
+
+    std::printf("Best instruction set: %s\n", GateKernels::name(GateKernels::detect()));
+    for (size_t words : {1, 4, 16}) {
+        std::vector<uint64_t> value(WIRES * words), unknown(WIRES * words, 0);
+        for (uint64_t& word : value) word = (uint64_t(random()) << 32) | random();
+
+        for (GateKernels::ISA isa : {GateKernels::ISA::SCALAR, GateKernels::ISA::SSE2, GateKernels::ISA::AVX2}) {
+            if (!GateKernels::supported(isa)) continue;
+            GateKernels::Kernel kernel = GateKernels::kernel(isa);
+            const size_t passes = 64 / words + 1;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t pass = 0; pass < passes; ++pass) {
+                for (size_t r = 0; r < RUNS; ++r) {
+                    size_t first = r * GATES_PER_RUN;
+                    kernel(ops[r % 7], &inputA[first], &inputB[first], &output[first], GATES_PER_RUN, value.data(), unknown.data(), words);
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double gates = double(passes) * RUNS * GATES_PER_RUN;
+            std::printf("%4zu lanes  %-6s  %8.1f Mgates/s  %9.1f Mlane-gates/s\n",
+                        words * 64, GateKernels::name(isa), gates / seconds / 1e6, gates * words * 64 / seconds / 1e6);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Netlist parser benchmark: build with `make bench`.
+// Writes a synthetic design of about a million lines (wires, buses, gates and flip-flops, with comments and
+// blank lines) and times elaborating it, which is parsing plus levelizing the netlist, then loading the same
+// circuit from its .lsimb netlist cache. Last, a 1 MiB ROM image is loaded from text, Intel HEX and raw binary.
+#include "../includes/Interpreter.h"
+#include "../includes/Wire.h"
+#include "../includes/Component.h"
+#include "../includes/NetlistCache.h"
+#include "../includes/ROM.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Discards everything written to it, so the creation log costs as little as possible
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Returns the number of lines written
+static size_t writeDesign(const std::string& path, size_t lines) {
+    std::ofstream out(path);
+    std::mt19937 random(42);
+    const size_t wires = lines / 2;
+    const char* gates[] = {"AND", "OR", "XOR", "NAND", "NOR", "XNOR"};
+
+    out << "// Synthetic netlist\n\nwire clk clk\n";
+    size_t written = 3;
+    for (size_t wire = 0; wire < wires; ++wire) {
+        if (wire % 64 == 0) out << "wire bus" << wire << "[7:0] low\n";
+        else out << "wire w" << wire << (wire < 64 ? " low" : "") << '\n';
+        ++written;
+    }
+    out << '\n';
+    ++written;
+    // Every gate drives its own wire from two earlier ones, so the netlist is acyclic
+    auto name = [&](size_t wire) {
+        return wire % 64 == 0 ? "bus" + std::to_string(wire) + "[" + std::to_string(wire % 8) + "]" : "w" + std::to_string(wire);
+    };
+    for (size_t wire = 64; wire < wires; ++wire) {
+        if (wire % 64 == 0) continue;
+        ++written;
+        const std::string a = name(random() % wire), b = name(random() % wire);
+        if (wire % 97 == 0) out << "DFF ff" << wire << " clk " << a << ' ' << name(wire) << " rising\n";
+        else if (wire % 31 == 0) out << "NOT n" << wire << ' ' << a << ' ' << name(wire) << '\n';
+        else out << gates[wire % 6] << " g" << wire << ' ' << a << ' ' << b << ' ' << name(wire) << (wire % 50 == 0 ? " // tap\n" : "\n");
+    }
+    return written;
+}
+
+// Writes the same image of 16 bit words in every memory file format, and a design reading it for each
+static std::vector<std::string> writeImages(const std::string& base, size_t words) {
+    std::mt19937 random(7);
+    std::vector<uint8_t> image(words * 2);
+    for (uint8_t& byte : image) byte = static_cast<uint8_t>(random());
+
+    std::ofstream bin(base + ".bin", std::ios::binary), text(base + ".txt"), hex(base + ".hex");
+    bin.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    char line[64];
+    for (size_t word = 0; word < words; ++word) {
+        std::snprintf(line, sizeof(line), "0x%02X%02X\n", image[2 * word + 1], image[2 * word]);
+        text << line;
+    }
+    auto record = [&](uint8_t type, size_t address, const uint8_t* bytes, size_t count) {
+        uint8_t sum = static_cast<uint8_t>(count + (address >> 8) + address + type);
+        hex << ':';
+        std::snprintf(line, sizeof(line), "%02zX%04zX%02X", count, address & 0xFFFF, type);
+        hex << line;
+        for (size_t i = 0; i < count; ++i) {
+            std::snprintf(line, sizeof(line), "%02X", bytes[i]);
+            hex << line;
+            sum += bytes[i];
+        }
+        std::snprintf(line, sizeof(line), "%02X\n", static_cast<uint8_t>(-sum));
+        hex << line;
+    };
+    for (size_t offset = 0; offset < image.size(); offset += 16) {
+        if (offset % 0x10000 == 0) {
+            const uint8_t upper[2] = {static_cast<uint8_t>(offset >> 24), static_cast<uint8_t>(offset >> 16)};
+            record(0x04, 0, upper, 2);
+        }
+        record(0x00, offset, image.data() + offset, std::min<size_t>(16, image.size() - offset));
+    }
+    record(0x01, 0, nullptr, 0);
+
+    size_t addressBits = 0;
+    while ((size_t(1) << addressBits) < words) ++addressBits;
+    std::vector<std::string> designs;
+    for (const char* format : {".txt", ".hex", ".bin"}) {
+        designs.push_back(base + format + ".design");
+        std::ofstream design(designs.back());
+        design << "wire A[" << addressBits - 1 << ":0] low\nwire D[15:0]\nROM image A D " << base << format << '\n';
+    }
+    return designs;
+}
+
+int main(int argc, char** argv) {
+    const size_t target = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const int runs = argc > 2 ? std::stoi(argv[2]) : 3;
+    const std::string path = (std::filesystem::temp_directory_path() / "logic_sim_parser_bench.txt").string();
+    const size_t lines = writeDesign(path, target);
+
+    NullBuffer null;
+    std::streambuf* console = std::cout.rdbuf(&null);
+    auto best = [&]() {
+        double fastest = 0;
+        for (int run = 0; run < runs; ++run) {
+            const auto start = std::chrono::steady_clock::now();
+            Interpreter::buildCircuit(path);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < fastest) fastest = seconds;
+        }
+        return fastest;
+    };
+    NetlistCache::enabled = false;
+    const double parsed = best();
+    NetlistCache::enabled = true;
+    Interpreter::buildCircuit(path); // writes the cache
+    const double cached = best();
+    std::cout.rdbuf(console);
+
+    std::printf("%zu lines, %zu wires, %zu components: best of %d elaborations %.1f ms (%.2f M lines/s), from the netlist cache %.1f ms\n",
+                lines, Wire::wireMap.size(), Component::components.size(), runs, parsed * 1000.0, lines / parsed / 1e6, cached * 1000.0);
+    std::filesystem::remove(path);
+    std::filesystem::remove(NetlistCache::pathFor(path));
+
+    const std::string image = (std::filesystem::temp_directory_path() / "logic_sim_rom_bench").string();
+    const std::vector<std::string> designs = writeImages(image, size_t(1) << 19);
+    NetlistCache::enabled = false;
+    const char* formats[] = {"text", "Intel HEX", "binary"};
+    for (size_t format = 0; format < designs.size(); ++format) {
+        console = std::cout.rdbuf(&null);
+        const auto start = std::chrono::steady_clock::now();
+        Interpreter::buildCircuit(designs[format]);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout.rdbuf(console);
+        std::printf("1 MiB ROM image (%zu words) from %s: %.1f ms\n", ROM::roms.empty() ? 0 : ROM::roms[0]->depth(), formats[format], seconds * 1000.0);
+        std::filesystem::remove(designs[format]);
+    }
+    for (const char* format : {".txt", ".hex", ".bin"}) std::filesystem::remove(image + format);
+    return 0;
+}
@@ -0,0 +1,168 @@
+// Headless simulator for batch runs: no SDL, ImGui or file dialogs, only the logic core.
+//
+//   logic_sim_headless --design <file> [--testbench <file>] [--cycles <n>] [--threads <n>] [--lanes <n>]
+//                      [--output <file|->] [--vcd <file>] [--waveform-db <file>] [--query <query>]... [--no-cache] [--verbose]
+#include "../includes/Interpreter.h"
+#include "../includes/NetlistCache.h"
+#include "../includes/Scheduler.h"
+#include "../includes/PatternSimulator.h"
+#include "../includes/VcdWriter.h"
+#include "../includes/WaveformQuery.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+
+static void printUsage() {
+    std::cerr << "Usage: logic_sim_headless --design <file> [options]\n"
+              << "  --testbench <file>   testbench to apply\n"
+              << "  --cycles <n>         clock cycles to simulate (default 10)\n"
+              << "  --threads <n>        threads for the event-driven kernel (default 1)\n"
+              << "  --lanes <n>          run n pattern-parallel lanes instead (up to " << PatternSimulator::MAX_LANES << ")\n"
+              << "  --output <file|->    write the waveform, one line per wire (lane 0 for pattern runs)\n"
+              << "  --vcd <file>         stream the run to a value change dump (not for pattern runs)\n"
+              << "  --waveform-db <file> record the run into a memory-mapped waveform database (not for pattern runs)\n"
+              << "  --query <query>      answer a query on the run, can be repeated:\n"
+              << "                       next/prev [rising|falling] <signal> [after/before <n>], value <signal> <n>,\n"
+              << "                       count <signal> [<first> <last>], find <bus>==<value> [from <n>], period <signal>\n"
+              << "  --no-cache           elaborate from the design text, without reading or writing its .lsimb cache\n"
+              << "  --verbose            keep the elaboration log\n";
+}
+
+static void writeWaveform(std::ostream& out, const WaveformStore& result) {
+    // Names are sorted, so runs can be diffed
+    std::string line;
+    for (size_t entry = 0; entry < result.size(); ++entry) {
+        line.assign(result.cycles(), 'X');
+        auto transitions = result.transitions(entry);
+        size_t cycle, runStart = 0;
+        WIRE_STATE state;
+        char symbol = 'X';
+        // Each state holds until the next transition
+        while (transitions.next(cycle, state)) {
+            std::fill(line.begin() + runStart, line.begin() + cycle, symbol);
+            symbol = state == WIRE_STATE::LOGIC_HIGH ? '1' : state == WIRE_STATE::LOGIC_LOW ? '0' : 'X';
+            runStart = cycle;
+        }
+        std::fill(line.begin() + runStart, line.end(), symbol);
+        out << result.name(entry) << ' ' << line << '\n';
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string designFile, testbenchFile, outputFile, vcdFile, databaseFile;
+    size_t cycles = 10, threads = 1, lanes = 0;
+    std::vector<std::string> queries;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << option << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        try {
+            if (option == "--design") designFile = value();
+            else if (option == "--testbench") testbenchFile = value();
+            else if (option == "--cycles") cycles = std::stoul(value());
+            else if (option == "--threads") threads = std::stoul(value());
+            else if (option == "--lanes") lanes = std::stoul(value());
+            else if (option == "--output") outputFile = value();
+            else if (option == "--vcd") vcdFile = value();
+            else if (option == "--waveform-db") databaseFile = value();
+            else if (option == "--query") queries.push_back(value());
+            else if (option == "--no-cache") NetlistCache::enabled = false;
+            else if (option == "--verbose") verbose = true;
+            else if (option == "--help" || option == "-h") {
+                printUsage();
+                return 0;
+            } else {
+                std::cerr << "Unknown option: " << option << std::endl;
+                printUsage();
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid number for " << option << std::endl;
+            return 1;
+        }
+    }
+    if (designFile.empty()) {
+        printUsage();
+        return 1;
+    }
+    if (lanes > 0 && !vcdFile.empty()) {
+        std::cerr << "--vcd is ignored for pattern runs." << std::endl;
+    }
+    if (lanes > 0 && !databaseFile.empty()) {
+        std::cerr << "--waveform-db is ignored for pattern runs." << std::endl;
+    }
+    if (!std::ifstream(designFile)) {
+        std::cerr << "Cannot open design file: " << designFile << std::endl;
+        return 1;
+    }
+
+    // Opened before std::cout is redirected, so returning here leaves it alone
+    std::unique_ptr<VcdWriter> vcd;
+    if (lanes == 0 && !vcdFile.empty()) {
+        vcd.reset(new VcdWriter(vcdFile));
+        if (!vcd->isOpen()) return 1;
+    }
+
+    // The interpreter logs every wire and gate it creates. Errors still go to stderr.
+    std::ostringstream log;
+    std::streambuf* console = std::cout.rdbuf();
+    if (!verbose) std::cout.rdbuf(log.rdbuf());
+
+    Scheduler::setThreads(threads);
+    auto start = std::chrono::steady_clock::now();
+    WaveformStore result;
+    if (lanes > 0) {
+        Interpreter::runPatternSimulation(designFile, testbenchFile, cycles, lanes, {&result});
+    } else {
+        // Only keep the run if it has to be written as a table or database, or queried
+        std::vector<WaveformSink*> sinks;
+        result.recordTo(databaseFile);
+        if (!outputFile.empty() || !databaseFile.empty() || !queries.empty()) sinks.push_back(&result);
+        if (vcd) sinks.push_back(vcd.get());
+        Interpreter::runSimulation(designFile, testbenchFile, cycles, sinks);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout.rdbuf(console);
+
+    if (!outputFile.empty()) {
+        if (outputFile == "-") {
+            writeWaveform(std::cout, result);
+        } else {
+            std::ofstream out(outputFile);
+            if (!out) {
+                std::cerr << "Cannot write output file: " << outputFile << std::endl;
+                return 1;
+            }
+            writeWaveform(out, result);
+        }
+    }
+    bool answered = true;
+    for (const std::string& query : queries) {
+        const WaveformQueryResult answer = runWaveformQuery(result, query);
+        if (answer.ok) std::cout << query << ": " << answer.text << '\n';
+        else std::cerr << query << ": " << answer.text << std::endl;
+        answered = answered && answer.ok;
+    }
+    if (!outputFile.empty() || result.isMapped()) {
+        std::fprintf(stderr, "Waveform: %zu signals x %zu cycles in %zu bytes%s\n", result.size(), result.cycles(), result.memoryBytes(),
+                     result.isMapped() ? (" + " + databaseFile).c_str() : "");
+    }
+
+    std::fprintf(stderr, "Simulated %zu cycles%s in %.3f ms (%.0f cycles/s)\n", cycles,
+                 lanes > 0 ? (" x " + std::to_string(lanes) + " lanes").c_str() : "",
+                 seconds * 1000.0, seconds > 0 ? cycles / seconds : 0.0);
+    return answered ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+#include "WaveformView.h"
+#include "gui.h"
+#include "../includes/WaveformQuery.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+static const float label_width = 100.0f;  // names column
+static const float y_step = 35.0f;        // vertical space per wire
+static const float line_height = 20.0f;
+static const float ruler_height = 25.0f;
+static const float tick_spacing = 80.0f;  // minimum pixels between cycle labels
+static const double max_pixels_per_cycle = 200.0;
+static const float click_slop = 4.0f;     // pixels the mouse may move for a press to count as a click
+static const ImU32 cursor_color = IM_COL32(255, 220, 0, 255);
+
+static ImU32 stateColor(uint8_t state) {
+    if (state == static_cast<uint8_t>(WIRE_STATE::LOGIC_HIGH))
+        return IM_COL32(0, 255, 0, 255); // green
+    if (state == static_cast<uint8_t>(WIRE_STATE::LOGIC_LOW))
+        return IM_COL32(255, 0, 0, 255); // red
+    return IM_COL32(128, 128, 128, 255);
+}
+
+// Smallest 1, 2 or 5 times a power of ten that is at least minCycles
+static double tickStep(double minCycles) {
+    for (double power = 1;; power *= 10) {
+        for (double multiple : {1.0, 2.0, 5.0}) {
+            if (multiple * power >= minCycles) return multiple * power;
+        }
+    }
+}
+
+void DrawWaveformVisual(const WaveformStore& waveform, int max_cycles) {
+    // One view per window, so each keeps its own zoom and scroll position
+    static std::unordered_map<ImGuiID, WaveformView> views;
+    views[ImGui::GetID("##waveform")].draw(waveform, static_cast<size_t>(std::max(max_cycles, 0)));
+}
+
+void WaveformView::clampView(float width, size_t cycles) {
+    // No further out than the whole run
+    const double fit = cycles > 0 ? width / static_cast<double>(cycles) : max_pixels_per_cycle;
+    pixelsPerCycle = std::clamp(pixelsPerCycle, std::min(fit, max_pixels_per_cycle), max_pixels_per_cycle);
+    firstCycle = std::clamp(firstCycle, 0.0, std::max(0.0, cycles - width / pixelsPerCycle));
+}
+
+void WaveformView::zoom(double factor, double anchorCycle, float width, size_t cycles) {
+    // Keep anchorCycle under the same pixel
+    const double anchorX = (anchorCycle - firstCycle) * pixelsPerCycle;
+    pixelsPerCycle *= factor;
+    clampView(width, cycles);
+    firstCycle = anchorCycle - anchorX / pixelsPerCycle;
+    clampView(width, cycles);
+}
+
+void WaveformView::moveCursor(size_t cycle, float width, size_t cycles) {
+    cursor = cycle;
+    const double visible = width / pixelsPerCycle;
+    if (cycle < firstCycle || cycle + 1 > firstCycle + visible) firstCycle = cycle - visible / 2;
+    clampView(width, cycles);
+}
+
+void WaveformView::drawMeasurements(const WaveformStore& waveform) {
+    std::string text;
+    if (selectedRow < waveform.size() && cursor < waveform.cycles()) {
+        text = waveform.name(selectedRow) + " @ " + std::to_string(cursor) + ": " + waveformValueAt(waveform, {selectedRow}, cursor);
+        // Period of the clock cycle the cursor is in
+        const size_t rise = waveform.previousEdge(selectedRow, cursor + 1, WaveformStore::EDGE::RISING);
+        size_t period, high;
+        if (waveform.measurePeriod(selectedRow, rise == SIZE_MAX ? 0 : rise - 1, period, high)) {
+            text += "   period " + std::to_string(period) + ", high " + std::to_string(high) + " (" + std::to_string(100 * high / period) + "%)";
+        }
+    } else if (cursor < waveform.cycles()) {
+        text = "cycle " + std::to_string(cursor);
+    } else {
+        text = "Click the plot to place the cursor and select a signal";
+    }
+    if (!queryAnswer.empty()) text += "   |   " + queryAnswer;
+    ImGui::TextUnformatted(text.c_str());
+}
+
+void WaveformView::buildRow(const WaveformStore& waveform, size_t entry, size_t cycles, float width, std::vector<Segment>& row) const {
+    row.clear();
+    auto toX = [&](double cycle) { return static_cast<float>((cycle - firstCycle) * pixelsPerCycle); };
+
+    if (pixelsPerCycle >= 1.0) {
+        // One segment per run of equal states
+        const size_t begin = static_cast<size_t>(firstCycle);
+        const size_t end = std::min(cycles, static_cast<size_t>(firstCycle + width / pixelsPerCycle) + 2);
+        auto transitions = waveform.transitions(entry, begin);
+        size_t cycle, runStart = begin;
+        WIRE_STATE state;
+        int runState = -1;
+        while (transitions.next(cycle, state) && cycle < end) {
+            if (runState >= 0) row.push_back({toX(runStart), toX(cycle), static_cast<uint8_t>(runState)});
+            runStart = cycle;
+            runState = static_cast<int>(state);
+        }
+        if (runState >= 0) row.push_back({toX(runStart), toX(end), static_cast<uint8_t>(runState)});
+        return;
+    }
+
+    // Several cycles per pixel: summarize each pixel column, and merge neighbours of the same kind
+    const double cyclesPerPixel = 1.0 / pixelsPerCycle;
+    const int columns = static_cast<int>(std::ceil(width));
+    for (int column = 0; column < columns; ++column) {
+        const size_t first = static_cast<size_t>(firstCycle + column * cyclesPerPixel);
+        if (first >= cycles) break;
+        const size_t last = std::min(std::max(static_cast<size_t>(firstCycle + (column + 1) * cyclesPerPixel), first + 1), cycles);
+        const uint8_t mask = waveform.statesIn(entry, first, last);
+
+        uint8_t kind;
+        if ((mask & (mask - 1)) == 0) kind = mask == 1 ? LOW : mask == 2 ? HIGH : UNDEFINED;
+        else kind = (mask & 4) ? ACTIVITY_UNDEFINED : ACTIVITY;
+        const float x1 = last == cycles ? toX(cycles) : static_cast<float>(column + 1);
+
+        if (!row.empty() && row.back().kind == kind) row.back().x1 = x1;
+        else row.push_back({static_cast<float>(column), x1, kind});
+    }
+}
+
+void WaveformView::draw(const WaveformStore& waveform, size_t maxCycles) {
+    ImGuiIO& io = ImGui::GetIO();
+    const ImGuiStyle& style = ImGui::GetStyle();
+    const size_t cycles = std::min(maxCycles, waveform.cycles());
+
+    // Width of the plot inside the child below, for the toolbar
+    float width = std::max(1.0f, ImGui::GetContentRegionAvail().x - label_width - style.ScrollbarSize - 2 * style.WindowPadding.x);
+    clampView(width, cycles);
+
+    if (ImGui::Button("Fit")) {
+        pixelsPerCycle = 0;
+        firstCycle = 0;
+        clampView(width, cycles);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("-")) zoom(0.5, firstCycle + width / pixelsPerCycle / 2, width, cycles);
+    ImGui::SameLine();
+    if (ImGui::Button("+")) zoom(2.0, firstCycle + width / pixelsPerCycle / 2, width, cycles);
+    ImGui::SameLine();
+    // Edge jumps on the selected row, from the cursor or the left edge of the view
+    const bool canJump = selectedRow < waveform.size();
+    const size_t from = cursor < cycles ? cursor : static_cast<size_t>(firstCycle);
+    if (ImGui::ArrowButton("##previousEdge", ImGuiDir_Left) && canJump) {
+        const size_t edge = waveform.previousEdge(selectedRow, from);
+        if (edge < cycles) moveCursor(edge, width, cycles);
+    }
+    ImGui::SameLine();
+    if (ImGui::ArrowButton("##nextEdge", ImGuiDir_Right) && canJump) {
+        const size_t edge = waveform.nextEdge(selectedRow, from);
+        if (edge < cycles) moveCursor(edge, width, cycles);
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(260.0f);
+    if (ImGui::InputTextWithHint("##query", "next rising clk, find A==0x5, period clk ...", query, sizeof(query),
+                                 ImGuiInputTextFlags_EnterReturnsTrue)) {
+        const WaveformQueryResult answer = runWaveformQuery(waveform, query);
+        queryAnswer = answer.text;
+        if (answer.ok && answer.cycle < cycles) moveCursor(answer.cycle, width, cycles);
+    }
+    ImGui::SameLine();
+    const double minFirst = 0, maxFirst = std::max(0.0, cycles - width / pixelsPerCycle);
+    ImGui::SetNextItemWidth(-FLT_MIN);
+    ImGui::SliderScalar("##position", ImGuiDataType_Double, &firstCycle, &minFirst, &maxFirst, "cycle %.0f");
+    drawMeasurements(waveform);
+
+    // Scrolling is handled below: Ctrl+wheel zooms, Shift+wheel or dragging pans
+    ImGui::BeginChild("##waveformRows", ImVec2(0, 0), true, ImGuiWindowFlags_NoScrollWithMouse);
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 origin = ImGui::GetCursorScreenPos(); // moves up as the child scrolls
+    const float scrollY = ImGui::GetScrollY();
+    const float top = origin.y + scrollY;
+    const float bottom = top + ImGui::GetWindowHeight();
+    const float plotLeft = origin.x + label_width;
+    width = std::max(1.0f, ImGui::GetContentRegionAvail().x - label_width);
+    const size_t rowCount = waveform.size();
+    // Row r is drawn at rowsTop + r * y_step
+    const float rowsTop = origin.y + ruler_height;
+
+    // The whole plot is one item: it takes the mouse and gives the child its scroll height
+    ImGui::InvisibleButton("##plot", ImVec2(label_width + width, ruler_height + rowCount * y_step));
+    if (ImGui::IsItemHovered()) {
+        const double mouseCycle = firstCycle + (io.MousePos.x - plotLeft) / pixelsPerCycle;
+        if (io.MouseWheel != 0 && io.KeyCtrl) zoom(std::pow(1.25, io.MouseWheel), mouseCycle, width, cycles);
+        else if (io.MouseWheel != 0 && io.KeyShift) firstCycle -= io.MouseWheel * 100 / pixelsPerCycle;
+        else if (io.MouseWheel != 0) ImGui::SetScrollY(scrollY - io.MouseWheel * y_step * 3);
+        if (io.MouseWheelH != 0) firstCycle -= io.MouseWheelH * 100 / pixelsPerCycle;
+    }
+    if (ImGui::IsItemActivated()) {
+        pressX = io.MousePos.x;
+        pressY = io.MousePos.y;
+    }
+    if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left, 0.0f)) {
+        firstCycle -= io.MouseDelta.x / pixelsPerCycle;
+        ImGui::SetScrollY(scrollY - io.MouseDelta.y);
+    }
+    // A click rather than a drag: select the row, and put the cursor on the cycle unless it was on the names
+    if (ImGui::IsItemDeactivated() && std::abs(io.MousePos.x - pressX) < click_slop && std::abs(io.MousePos.y - pressY) < click_slop) {
+        if (io.MousePos.y >= rowsTop) {
+            const size_t row = static_cast<size_t>((io.MousePos.y - rowsTop) / y_step);
+            if (row < rowCount) selectedRow = row;
+        }
+        if (io.MousePos.x >= plotLeft && cycles > 0) {
+            cursor = std::min(cycles - 1, static_cast<size_t>(std::max(0.0, firstCycle + (io.MousePos.x - plotLeft) / pixelsPerCycle)));
+        }
+    }
+    clampView(width, cycles);
+
+    // Rows in view
+    const size_t firstRow = std::min(rowCount, static_cast<size_t>(scrollY / y_step));
+    const size_t lastRow = std::min(rowCount, static_cast<size_t>((scrollY + bottom - top) / y_step) + 1);
+
+    const bool stale = cachedStore != &waveform || cachedGeneration != waveform.generation() || cachedFirstCycle != firstCycle ||
+                       cachedPixelsPerCycle != pixelsPerCycle || cachedWidth != width || cachedCycles != cycles;
+    if (stale || firstRow < rowBegin || lastRow > rowBegin + rows.size()) {
+        rowBegin = firstRow;
+        rows.resize(lastRow - firstRow);
+        for (size_t row = firstRow; row < lastRow; ++row) {
+            buildRow(waveform, row, cycles, width, rows[row - firstRow]);
+        }
+        cachedStore = &waveform;
+        cachedGeneration = waveform.generation();
+        cachedFirstCycle = firstCycle;
+        cachedPixelsPerCycle = pixelsPerCycle;
+        cachedWidth = width;
+        cachedCycles = cycles;
+    }
+
+    // Cycle ruler, pinned to the top of the child
+    const double step = tickStep(tick_spacing / pixelsPerCycle);
+    const double lastVisible = std::min<double>(cycles, firstCycle + width / pixelsPerCycle);
+    draw_list->PushClipRect(ImVec2(plotLeft, top), ImVec2(plotLeft + width, bottom), true);
+    for (double tick = std::ceil(firstCycle / step) * step; tick <= lastVisible; tick += step) {
+        const float x = plotLeft + static_cast<float>((tick - firstCycle) * pixelsPerCycle);
+        draw_list->AddText(ImVec2(x + 2, top), IM_COL32_WHITE, std::to_string(static_cast<size_t>(tick)).c_str());
+        draw_list->AddLine(ImVec2(x, top + ruler_height - 5), ImVec2(x, bottom), IM_COL32(80, 80, 80, 100));
+    }
+    draw_list->PopClipRect();
+
+    draw_list->PushClipRect(ImVec2(origin.x, top + ruler_height), ImVec2(plotLeft + width, bottom), true);
+    for (size_t row = firstRow; row < lastRow; ++row) {
+        const float y = rowsTop + row * y_step;
+        draw_list->AddText(ImVec2(origin.x, y), row == selectedRow ? cursor_color : IM_COL32_WHITE, waveform.name(row).c_str());
+
+        int previous = -1;
+        for (const Segment& segment : rows[row - rowBegin]) {
+            const float x0 = plotLeft + std::max(segment.x0, -1.0f);
+            const float x1 = plotLeft + std::min(segment.x1, width + 1.0f);
+            switch (segment.kind) {
+                case LOW:
+                case HIGH: {
+                    const float level = segment.kind == HIGH ? y : y + line_height;
+                    draw_list->AddLine(ImVec2(x0, level), ImVec2(x1, level), stateColor(segment.kind), 2.0f);
+                    // Vertical edge (rising or falling)
+                    if ((previous == LOW || previous == HIGH) && previous != segment.kind)
+                        draw_list->AddLine(ImVec2(x0, y), ImVec2(x0, y + line_height), stateColor(previous), 2.0f);
+                    break;
+                }
+                case UNDEFINED:
+                    draw_list->AddRectFilled(ImVec2(x0, y), ImVec2(x1, y + line_height), IM_COL32(128, 128, 128, 40));
+                    draw_list->AddLine(ImVec2(x0, y + line_height / 2), ImVec2(x1, y + line_height / 2), IM_COL32(128, 128, 128, 100), 1.0f);
+                    break;
+                default:
+                    // Toggles faster than the zoom can show: fill the whole swing
+                    draw_list->AddRectFilled(ImVec2(x0, y), ImVec2(std::max(x1, x0 + 1.0f), y + line_height),
+                                             segment.kind == ACTIVITY ? IM_COL32(0, 200, 0, 160) : IM_COL32(128, 128, 128, 160));
+                    break;
+            }
+            previous = segment.kind;
+        }
+    }
+    draw_list->PopClipRect();
+
+    if (cursor < cycles) {
+        const float x = plotLeft + static_cast<float>((cursor - firstCycle) * pixelsPerCycle);
+        if (x >= plotLeft && x <= plotLeft + width) draw_list->AddLine(ImVec2(x, top), ImVec2(x, bottom), cursor_color, 1.0f);
+    }
+    ImGui::EndChild();
+}
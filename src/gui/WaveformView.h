@@ -0,0 +1,50 @@
+#pragma once
+#include "../includes/WaveformStore.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Waveform viewer for one window. Only the rows and cycles in view are drawn. Zoomed in, every run of equal
+// states is one segment. Zoomed out past one cycle per pixel, each pixel column is summarized from the store
+// and columns where the signal toggles become activity bars. The geometry of the visible rows is cached and
+// only rebuilt when the run, the zoom or the scroll position changes.
+//
+// Clicking the plot puts a cursor on a cycle and selects a row. The toolbar jumps the cursor to the previous or
+// next edge of that row and runs waveform queries, which answer from the store's index instead of walking cycles.
+class WaveformView {
+public:
+    void draw(const WaveformStore& waveform, size_t maxCycles);
+
+private:
+    enum KIND : uint8_t { LOW, HIGH, UNDEFINED, ACTIVITY, ACTIVITY_UNDEFINED };
+    struct Segment {
+        float x0, x1; // pixels from the left edge of the plot
+        uint8_t kind;
+    };
+
+    void buildRow(const WaveformStore& waveform, size_t entry, size_t cycles, float width, std::vector<Segment>& row) const;
+    void zoom(double factor, double anchorCycle, float width, size_t cycles);
+    void clampView(float width, size_t cycles);
+    // Put the cursor on a cycle and scroll it into view
+    void moveCursor(size_t cycle, float width, size_t cycles);
+    void drawMeasurements(const WaveformStore& waveform);
+
+    double firstCycle = 0;      // cycle at the left edge of the plot
+    double pixelsPerCycle = 50; // zoom
+
+    size_t cursor = SIZE_MAX;      // cycle under the cursor, SIZE_MAX if none
+    size_t selectedRow = SIZE_MAX;
+    float pressX = 0, pressY = 0;  // where the mouse went down on the plot, to tell clicks from drags
+    char query[128] = "";
+    std::string queryAnswer;
+
+    // Cached geometry of rows [rowBegin, rowBegin + rows.size())
+    const WaveformStore* cachedStore = nullptr;
+    uint64_t cachedGeneration = 0;
+    double cachedFirstCycle = -1;
+    double cachedPixelsPerCycle = 0;
+    float cachedWidth = 0;
+    size_t cachedCycles = 0;
+    size_t rowBegin = 0;
+    std::vector<std::vector<Segment>> rows;
+};
@@ -6,6 +6,9 @@
 #include "../includes/FlipFlop.h"
 #include "../includes/Multiplexer.h"
 #include "../includes/ROM.h"
+#include "../includes/PatternSimulator.h"
+#include "../includes/Scheduler.h"
+#include "../includes/VcdWriter.h"
 
 
 #include <SDL3/SDL.h>
@@ -18,18 +21,33 @@
 #include "imnodes.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <iomanip>  // for std::setw
 #include <algorithm> // for std::sort
 #include <vector>
 #include <filesystem>
 #include <map>
 #include <cstdlib>
+#include <thread>
+#include <memory>
 
-std::unordered_map<std::string, std::vector<WIRE_STATE>> waveform;
 std::string designFilePath, testbenchFilePath;
 static char designBuffer[1024 * 16] = "";
 static char testbenchBuffer[1024 * 16] = "";
 static int cycleCount = 10; 
+static int laneCount = 1;
+static int viewLane = 0;
+static int threadCount = 1;
+static bool diskWaveform = false;
+// One compressed store per lane after a pattern run, so switching lanes needs no rerun
+static std::vector<std::unique_ptr<WaveformStore>> laneWaveforms;
+
+// The lane picked under View Lane after a pattern run, the global waveform otherwise
+static const WaveformStore& shownWaveform() {
+    if (viewLane < (int)laneWaveforms.size()) return *laneWaveforms[viewLane];
+    return waveform;
+}
 
 void open_url(const std::string& url) {
 #ifdef _WIN32
@@ -389,6 +407,7 @@ void init() {
                 ImGui::OpenPopup("Error");
             } else {
                 waveform.clear();
+                laneWaveforms.clear();
                 Interpreter::runSimulation(designFilePath, testbenchFilePath, cycleCount);
             }
             drawRTL = true;
@@ -410,14 +429,39 @@ void init() {
         ImGui::Text("Clock Cycles:");
         ImGui::SameLine();
         ImGui::PushItemWidth(200.0f);
-        ImGui::InputInt("##Cycles", &cycleCount, 1, 5);
+        ImGui::InputInt("##Cycles", &cycleCount, 1, 100);
         ImGui::PopItemWidth();
         if (cycleCount < 2) {
             cycleCount = 2;
-        } else if (cycleCount > 99) {
-            cycleCount = 99;
         }
 
+        // Long runs: stream the waveform to a file and map it, so only the part in view is read back
+        ImGui::Checkbox("Waveform on Disk", &diskWaveform);
+
+        // Pattern-parallel runs: every lane is an independent testbench vector
+        ImGui::Text("Lanes:");
+        ImGui::SameLine();
+        ImGui::PushItemWidth(200.0f);
+        ImGui::InputInt("##Lanes", &laneCount, 1, 8);
+        ImGui::PopItemWidth();
+        laneCount = std::clamp(laneCount, 1, static_cast<int>(PatternSimulator::MAX_LANES));
+        if (laneCount > 1) {
+            ImGui::Text("View Lane:");
+            ImGui::SameLine();
+            ImGui::PushItemWidth(200.0f);
+            ImGui::InputInt("##ViewLane", &viewLane, 1, 8);
+            viewLane = std::clamp(viewLane, 0, laneCount - 1);
+            ImGui::PopItemWidth();
+        }
+
+        // Threads used to evaluate wide levels of the netlist. Results are the same for any count.
+        ImGui::Text("Threads:");
+        ImGui::SameLine();
+        ImGui::PushItemWidth(200.0f);
+        ImGui::InputInt("##Threads", &threadCount, 1, 4);
+        ImGui::PopItemWidth();
+        threadCount = std::clamp(threadCount, 1, std::max(1, (int)std::thread::hardware_concurrency()));
+
         ImVec2 center = ImGui::GetMainViewport()->GetCenter();
         ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
 
@@ -427,9 +471,8 @@ void init() {
             float close_button_height = ImGui::GetFrameHeightWithSpacing() + 10.0f;
             float child_height = ImGui::GetContentRegionAvail().y - close_button_height;
 
-            // Horizontal scrolling region
-            ImGui::BeginChild("WaveformRegion", ImVec2(0, child_height), true, ImGuiWindowFlags_HorizontalScrollbar);
-                DrawWaveformVisual(waveform, cycleCount);
+            ImGui::BeginChild("WaveformRegion", ImVec2(0, child_height), true);
+                DrawWaveformVisual(shownWaveform(), cycleCount);
             ImGui::EndChild();
             ImGui::Spacing();
             if (ImGui::Button("Close", ImVec2(120, 0))) {
@@ -523,6 +566,40 @@ void init() {
                     ImGui::PopID();
                     ImGui::TreePop();
                 }
+
+                if (ImGui::TreeNode("RAM")) {
+                    static char ramName[64] = "RAM";
+                    ImGui::PushID("RAM");
+                    ImGui::InputText("##input", ramName, IM_ARRAYSIZE(ramName));
+                    ImGui::SameLine();
+                    if (ImGui::SmallButton("+")) {
+                        strcat(designBuffer, "RAM <name> <clock> <writeEnable> <addressBus> <dataInBus> <dataOutBus> <optional: preloadFile/-> <optional: dumpFile>\n");
+                        isTestbenchModified = true;
+                    }
+                    ImGui::PopID();
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Arithmetic")) {
+                    static char arithmeticName[5][32] = {"Adder", "Subtractor", "Comparator", "Shift Left", "Shift Right"};
+                    for (int i = 0; i < 5; ++i) {
+                        ImGui::PushID(arithmeticName[i]);
+                        ImGui::InputText(("##input" + std::to_string(i)).c_str(), arithmeticName[i], IM_ARRAYSIZE(arithmeticName[i]));
+                        ImGui::SameLine();
+                        if (ImGui::SmallButton("+")) {
+                            switch(i) {
+                                case 0: strcat(designBuffer, "ADD <name> <busA> <busB> <sumBus> <optional: carryIn/-> <optional: carryOut>\n"); break;
+                                case 1: strcat(designBuffer, "SUB <name> <busA> <busB> <differenceBus> <optional: borrowIn/-> <optional: borrowOut>\n"); break;
+                                case 2: strcat(designBuffer, "CMP <name> <busA> <busB> <equal/-> <less/-> <greater/->\n"); break;
+                                case 3: strcat(designBuffer, "SHL <name> <busA> <amountBus> <outputBus>\n"); break;
+                                case 4: strcat(designBuffer, "SHR <name> <busA> <amountBus> <outputBus>\n"); break;
+                            }
+                            isTestbenchModified = true;
+                        }
+                        ImGui::PopID();
+                    }
+                    ImGui::TreePop();
+                }
             }
         
             if (ImGui::CollapsingHeader("Sequential Logic", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -545,6 +622,19 @@ void init() {
                     }
                     ImGui::TreePop();
                 }
+
+                if (ImGui::TreeNode("Register")) {
+                    static char registerName[64] = "N-bit Register";
+                    ImGui::PushID("Register");
+                    ImGui::InputText("##input", registerName, IM_ARRAYSIZE(registerName));
+                    ImGui::SameLine();
+                    if (ImGui::SmallButton("+")) {
+                        strcat(designBuffer, "REG <name> <clock> <enable/-> <inputBusD> <outputBusQ> <default: rising/falling>\n");
+                        isTestbenchModified = true;
+                    }
+                    ImGui::PopID();
+                    ImGui::TreePop();
+                }
             }
 
             if (ImGui::CollapsingHeader("Wires", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -573,7 +663,7 @@ void init() {
                 ImGui::InputText("##input", clockName, IM_ARRAYSIZE(clockName));
                 ImGui::SameLine();
                 if (ImGui::SmallButton("+")) {
-                    strcat(designBuffer, "WIRE <name> clk\n");
+                    strcat(designBuffer, "WIRE <name> clk <optional: period or clock/divider> <optional: phase/-> <optional: high>\n");
                     isTestbenchModified = true;
                 }
                 ImGui::PopID();
@@ -586,10 +676,38 @@ void init() {
         ImGui::Begin("Waveform Viewer", nullptr, ImGuiWindowFlags_NoCollapse);
             if(ImGui::Button("Run Simulation", ImVec2(ImGui::GetContentRegionAvail().x, 0))){
                 waveform.clear();
-                Interpreter::runSimulation(designFilePath, testbenchFilePath, cycleCount);
+                laneWaveforms.clear();
+                if (laneCount > 1) {
+                    std::vector<WaveformStore*> stores;
+                    for (int lane = 0; lane < laneCount; ++lane) {
+                        laneWaveforms.push_back(std::make_unique<WaveformStore>());
+                        stores.push_back(laneWaveforms.back().get());
+                    }
+                    Interpreter::runPatternSimulation(designFilePath, testbenchFilePath, cycleCount, laneCount, stores);
+                } else {
+                    Scheduler::setThreads(threadCount);
+                    waveform.recordTo(diskWaveform ? (std::filesystem::temp_directory_path() / "logic_sim_waveform.lswave").string() : "");
+                    Interpreter::runSimulation(designFilePath, testbenchFilePath, cycleCount);
+                }
                 showWaveForm = true;
             }
-            DrawWaveformVisual(waveform, cycleCount);
+            if (ImGui::Button("Export VCD", ImVec2(ImGui::GetContentRegionAvail().x, 0))) {
+                nfdchar_t* outPath = NULL;
+                if (!designFilePath.empty() && NFD_SaveDialog("vcd", NULL, &outPath) == NFD_OKAY) {
+                    std::string pathStr = outPath;
+                    if (pathStr.size() < 4 || pathStr.substr(pathStr.size() - 4) != ".vcd") {
+                        pathStr += ".vcd";
+                    }
+                    // Streams straight to the file, the waveform shown here is left alone
+                    VcdWriter vcd(pathStr);
+                    if (vcd.isOpen()) {
+                        Scheduler::setThreads(threadCount);
+                        Interpreter::runSimulation(designFilePath, testbenchFilePath, cycleCount, {&vcd});
+                    }
+                    free(outPath);
+                }
+            }
+            DrawWaveformVisual(shownWaveform(), cycleCount);
         ImGui::End();
 
 
@@ -611,73 +729,6 @@ void init() {
     SDL_Quit();
 }
 
-void DrawWaveformVisual(const std::unordered_map<std::string, std::vector<WIRE_STATE>>& waveform, int max_cycles) {
-    const float x_scale = 50.0f;  // horizontal spacing per cycle
-    const float y_step  = 35.0f;  // vertical space per wire
-    const float line_height = 20.0f;
-
-    ImDrawList* draw_list = ImGui::GetWindowDrawList();
-    ImVec2 origin = ImGui::GetCursorScreenPos();
-
-    origin.y += 10.f;
-
-    for (int i = 0; i < max_cycles; ++i) {
-        float x = origin.x + 100.0f + i * x_scale;
-        draw_list->AddText(ImVec2(x, origin.y - 15), IM_COL32_WHITE, std::to_string(i).c_str());
-        draw_list->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + y_step * waveform.size()), IM_COL32(80, 80, 80, 100));
-    }
-
-    origin.y += 20.f;
-
-    int row = 0;
-
-    std::map<std::string, std::vector<WIRE_STATE>> sorted_map(waveform.begin(), waveform.end());
-
-    for (const auto& [name, states] : sorted_map) {
-        float y = origin.y + row * y_step;
-        ImVec2 label_pos = ImVec2(origin.x, y);
-        draw_list->AddText(label_pos, IM_COL32_WHITE, name.c_str());
-
-        float x_start = origin.x + 100.0f;
-
-        for (int i = 0; i < std::min(max_cycles - 1, (int)states.size() - 1); ++i) {
-            float x0 = x_start + i * x_scale;
-            float x1 = x_start + (i + 1) * x_scale;
-
-            WIRE_STATE s0 = states[i];
-            WIRE_STATE s1 = states[i + 1];
-
-            ImU32 color = IM_COL32(128, 128, 128, 255); // default undefined
-            if (s0 == WIRE_STATE::LOGIC_HIGH)
-                color = IM_COL32(0, 255, 0, 255); // green
-            else if (s0 == WIRE_STATE::LOGIC_LOW)
-                color = IM_COL32(255, 0, 0, 255); // red
-
-            float y0 = (s0 == WIRE_STATE::LOGIC_HIGH) ? y : y + line_height;
-            float y1 = (s1 == WIRE_STATE::LOGIC_HIGH) ? y : y + line_height;
-
-            if (s0 == WIRE_STATE::LOGIC_UNDEFINED || s1 == WIRE_STATE::LOGIC_UNDEFINED) {
-                // Draw a dashed gray line for undefined
-                for (float dash = x0; dash < x1; dash += 4.0f) {
-                    draw_list->AddLine(ImVec2(dash, y + line_height / 2), ImVec2(dash + 2.0f, y + line_height / 2), IM_COL32(128, 128, 128, 100), 1.0f);
-                }
-            } else {
-                // Horizontal segment
-                draw_list->AddLine(ImVec2(x0, y0), ImVec2(x1, y0), color, 2.0f);
-
-                // Vertical edge (rising or falling)
-                if (s0 != s1)
-                    draw_list->AddLine(ImVec2(x1, y0), ImVec2(x1, y1), color, 2.0f);
-            }
-        }
-
-        row++;
-    }
-    //ImGui::Text("Simulated %d cycles", max_cycles);
-    float content_width = 100.0f + max_cycles * x_scale;
-    ImGui::Dummy(ImVec2(content_width, row * y_step + 20));
-}
-
 void gui_openFile() {
     // TODO: Expand the functionality of the lsim file format
     nfdchar_t *outPath = NULL;
@@ -2,9 +2,10 @@
 #include <vector>
 #include <string>
 #include "../includes/Wire.h"
+#include "../includes/WaveformStore.h"
 #include "nfd.h"
 
-extern std::unordered_map<std::string, std::vector<WIRE_STATE>> waveform;
+extern WaveformStore waveform;
 static bool isDesignModified;
 static bool isTestbenchModified;
 static std::string lastSavedDesign;
@@ -12,4 +13,4 @@ static std::string lastSavedTestbench;
 void init();
 void gui_saveFile();
 void gui_openFile();
-void DrawWaveformVisual(const std::unordered_map<std::string, std::vector<WIRE_STATE>>& waveform, int max_cycles);
\ No newline at end of file
+void DrawWaveformVisual(const WaveformStore& waveform, int max_cycles);
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator that owns every object of the elaborated circuit (wires, buses, gates, flip-flops,
+// multiplexers, ROMs). Objects are carved out of large blocks and are never freed one by one.
+// release() runs the pending destructors in reverse creation order and rewinds to the first block,
+// keeping the blocks for the next circuit, so repeated runs reuse the same memory.
+class Arena {
+public:
+    // The circuit being simulated. Released by Interpreter::buildCircuit() before elaborating the next one.
+    static Arena circuit;
+
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    Arena() = default;
+    ~Arena() {
+        release();
+    }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            destructors.push_back({object, [](void* pointer) { static_cast<T*>(pointer)->~T(); }});
+        }
+        return object;
+    }
+
+    void* allocate(size_t size, size_t alignment);
+
+    // Destroy everything created since the last release
+    void release();
+
+    // Bytes handed out since the last release, and bytes held in blocks
+    size_t used() const;
+    size_t reserved() const;
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size;
+    };
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0; // block being filled
+    size_t offset = 0;  // first free byte in it
+    std::vector<Destructor> destructors;
+};
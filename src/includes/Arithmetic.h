@@ -0,0 +1,80 @@
+#pragma once
+#include "Wire.h"
+#include "WireBus.h"
+#include "Scheduler.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ARITHMETIC_OP : uint8_t {
+    ADD,
+    SUB,
+    CMP,
+    SHL,
+    SHR,
+};
+
+// Bus-level combinational unit, evaluated as one 64-bit word operation instead of a netlist of gates.
+// Operands are unsigned, wire 0 is the least significant bit, and every bus is at most 64 wires wide.
+//   ADD <name> <A> <B> <sum> [<carry in>|-] [<carry out>]         sum = A + B + carry in
+//   SUB <name> <A> <B> <difference> [<borrow in>|-] [<borrow out>] difference = A - B - borrow in
+//   CMP <name> <A> <B> <equal|-> <less|-> <greater|->              A == B, A < B, A > B
+//   SHL <name> <A> <amount> <out>, SHR <name> <A> <amount> <out>   logical shifts, 0 once amount >= width
+// An undefined operand makes every output of ADD, SUB and CMP undefined. Shifts move undefined bits of A
+// along with the rest, and an undefined amount makes the whole output undefined.
+class Arithmetic : public Schedulable {
+public:
+    static std::vector<Arithmetic*> units;
+
+    // Keyword of the design file, case-insensitive
+    static bool parseType(std::string_view word, ARITHMETIC_OP& op);
+    // Single wire outputs of an op: carry/borrow out, or equal, less and greater
+    static size_t flagCount(ARITHMETIC_OP op);
+    // What is wrong with the bus widths, or nothing. resultWidth is ignored for CMP.
+    static std::string shapeError(ARITHMETIC_OP op, size_t widthA, size_t widthB, size_t resultWidth);
+
+    // carryIn and flags may be nullptr where the design leaves them out. result is empty for CMP.
+    Arithmetic(ARITHMETIC_OP op, std::string name, const std::vector<Wire*>& busA, const std::vector<Wire*>& busB, Wire* carryIn,
+               const std::vector<Wire*>& result, const std::vector<Wire*>& flags);
+
+    void tick();
+    void evaluate() override {
+        tick();
+    }
+
+    ARITHMETIC_OP getOp() const {
+        return op;
+    }
+    const std::string& getName() const {
+        return name;
+    }
+    const std::vector<Wire*>& getBusA() const {
+        return busA;
+    }
+    const std::vector<Wire*>& getBusB() const {
+        return busB;
+    }
+    Wire* getCarryIn() const {
+        return carryIn;
+    }
+    const std::vector<Wire*>& getResult() const {
+        return result;
+    }
+    const std::vector<Wire*>& getFlags() const {
+        return flags;
+    }
+
+private:
+    void drive(uint64_t value, uint64_t unknown, const bool* flagValues, bool defined);
+
+    ARITHMETIC_OP op;
+    std::string name;
+    std::vector<Wire*> busA;
+    std::vector<Wire*> busB;
+    Wire* carryIn;
+    std::vector<Wire*> result;
+    std::vector<Wire*> flags;
+    bool consecutiveA, consecutiveB, consecutiveResult;
+};
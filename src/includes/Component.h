@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "Wire.h"
 #include <iostream>
@@ -24,9 +25,9 @@ private:
 protected:
     std::string name;
     const COMPONENT componentType;
-    Wire* input_A;
-    Wire* input_B;
-    Wire* output;
+    Wire* input_A = nullptr;
+    Wire* input_B = nullptr;
+    Wire* output = nullptr;
 public:
     static std::vector<Component*> components;
     Component(std::string name, COMPONENT component) : name(name), componentType(component), uid(next_uid++) {
@@ -36,6 +37,11 @@ public:
     uint32_t getUid() const {
         return uid;
     }
+    // Gate keyword of the design file (AND, OR, NOT, ...), case-insensitive
+    static bool parseType(std::string_view word, COMPONENT& type);
+    // Creates a gate of the given type in the circuit arena
+    static Component* create(COMPONENT type, std::string name);
+
     void setName(std::string name);
     std::string getName() const {
         return name;
@@ -67,8 +73,8 @@ public:
     static void evaluateSystem();
     virtual void evaluateComponent();
 
-    std::string typeToString() const {
-        switch (componentType) {
+    static const char* typeName(COMPONENT type) {
+        switch (type) {
             case COMPONENT::AND: return "AND";
             case COMPONENT::OR: return "OR";
             case COMPONENT::NOT: return "NOT";
@@ -79,6 +85,9 @@ public:
             default: return "Unknown Component Type";
         }
     }
+    std::string typeToString() const {
+        return typeName(componentType);
+    }
 };
 
 class AND_GATE : public Component {
@@ -2,19 +2,21 @@
 // TODO - refactor to be part of the Component class
 
 #pragma once
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "Wire.h"
+#include "Scheduler.h"
 #include <iostream>
 
 
-// Unused for now.
-// enum class FLIP_FLOP_TYPE {
-//     D_FLIP_FLOP,
-//     SR_FLIP_FLOP,
-//     JK_FLIP_FLOP,
-//     T_FLIP_FLOP
-// };
+enum class FLIP_FLOP_TYPE {
+    D_FLIP_FLOP,
+    SR_FLIP_FLOP,
+    JK_FLIP_FLOP,
+    T_FLIP_FLOP
+};
 
 enum class EDGE_TYPE {
     RISING_EDGE,
@@ -22,18 +24,20 @@ enum class EDGE_TYPE {
 };
 
 
+// A flip-flop of the design: DFF, TFF, SRFF or JKFF. Only the parsed record, which ClockDomain::build() groups
+// by clock; the domains hold the behaviour of every type.
 class FlipFlop {
 
 public:
     static std::vector<FlipFlop*> flipFlops;
-    FlipFlop(std::string name, std::vector<Wire*> inputs, Wire* output, Wire* clock, EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE)
-        : inputs(inputs), output(output), clock(clock), edgeType(edgeType) {
-            this->name = name;
-            flipFlops.push_back(this);
-        }
+    FlipFlop(std::string name, FLIP_FLOP_TYPE type, std::vector<Wire*> inputs, Wire* output, Wire* clock, EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE);
 
-    virtual void tick();
-    void process();
+    // Flip-flop keyword of the design file (DFF, SRFF, JKFF, TFF), case-insensitive
+    static bool parseType(std::string_view word, FLIP_FLOP_TYPE& type);
+    // Data inputs of a type: 1 for D and T, 2 for SR and JK
+    static size_t inputCount(FLIP_FLOP_TYPE type);
+    // Creates a flip-flop in the circuit arena. D and T flip-flops ignore inputB.
+    static FlipFlop* create(FLIP_FLOP_TYPE type, std::string name, Wire* clock, Wire* inputA, Wire* inputB, Wire* output, EDGE_TYPE edgeType);
 
     std::vector<Wire*> getInputs() const {
         return inputs;
@@ -43,110 +47,82 @@ public:
         return output;
     }
 
+    Wire* getClock() const {
+        return clock;
+    }
+
     std::string getName() const {
         return name;
     }
 
-    bool onEdge() const {
-        WIRE_STATE currentClock = clock->getState();
-        if (edgeType == EDGE_TYPE::RISING_EDGE)
-            return (previousClock == WIRE_STATE::LOGIC_LOW && currentClock == WIRE_STATE::LOGIC_HIGH);
-        else // falling edge
-            return (previousClock == WIRE_STATE::LOGIC_HIGH && currentClock == WIRE_STATE::LOGIC_LOW);
+    FLIP_FLOP_TYPE getType() const {
+        return type;
     }
 
-protected:
-    void updatePreviousClock() {
-        previousClock = clock->getState();
+    EDGE_TYPE getEdgeType() const {
+        return edgeType;
     }
-    
-    //const FLIP_FLOP_TYPE type;
+
+private:
+    const FLIP_FLOP_TYPE type;
     std::vector<Wire*> inputs;
     Wire* output;
     Wire* clock;
     std::string name;
-    WIRE_STATE previousClock = WIRE_STATE::LOGIC_LOW;
     EDGE_TYPE edgeType;
 };
 
-class DFlipFlop : public FlipFlop {
+// Flip-flops sharing a clock wire and edge, woken as one when the clock changes and stored as parallel arrays.
+// On an edge the whole group samples its inputs before any output is written (see Schedulable::commit()),
+// so a flip-flop reading another one's output directly, as in a shift register, sees the value from before
+// the edge whatever the declaration order. Domains whose clock doesn't move cost nothing.
+class ClockDomain : public Schedulable {
 public:
-    DFlipFlop(std::string name, Wire* clk, Wire* d, Wire* q, EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE) : FlipFlop(name, {d}, q, clk, edgeType) {
-        std::cout << "Creating D Flip-Flop: " << name << " D: " << d->getName() << " Q: " << q->getName() << " Clock: " << clk->getName() << std::endl;
-    }
+    static std::vector<ClockDomain*> domains;
 
-    void tick() override {
-        if (onEdge()) {
-            output->setState(inputs[0]->getState());
-#ifdef DEBUG
-            std::cout << "D Flip-Flop rising edge: Output set to " << (output->getState() == WIRE_STATE::LOGIC_HIGH ? "HIGH" : "LOW") << std::endl;
-#endif
-        }
-        updatePreviousClock();
-    }
-};
+    // Groups FlipFlop::flipFlops, domains in the order of their first flip-flop and flip-flops in registry order
+    static void build();
 
-class SRFlipFlop : public FlipFlop {
-public:
-    SRFlipFlop(std::string name, Wire* clk, Wire* s, Wire* r, Wire* q, EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE) : FlipFlop(name, {s, r}, q, clk, edgeType) {
-        std::cout << "Creating SR Flip-Flop: " << name << " S: " << s->getName() << " R: " << r->getName() << " Q: " << q->getName() << " Clock: " << clk->getName() << std::endl;
-    }
+    ClockDomain(Wire* clock, EDGE_TYPE edgeType) : clock(clock), edgeType(edgeType) {}
 
-    void tick() override {
-        if (onEdge()) {
-            if (inputs[0]->isLogicHigh() && inputs[1]->isLogicLow()) {
-                output->setState(WIRE_STATE::LOGIC_HIGH);
-            } else if (inputs[0]->isLogicLow() && inputs[1]->isLogicHigh()) {
-                output->setState(WIRE_STATE::LOGIC_LOW);
-            }
-#ifdef DEBUG
-            std::cout << "SR Flip-Flop rising edge: Output set to " << (output->getState() == WIRE_STATE::LOGIC_HIGH ? "HIGH" : "LOW") << std::endl;
-#endif
-        }
-        updatePreviousClock();
+    void add(const FlipFlop* flipFlop);
+    void evaluate() override;
+    void commit() override;
+    bool isSequential() const override {
+        return true;
     }
-};
 
-class JKFlipFlop : public FlipFlop {
-    
-public:
-    JKFlipFlop(std::string name, Wire* clk, Wire* j, Wire* k, Wire* q, EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE) : FlipFlop(name, {j, k}, q, clk, edgeType) {
-        std::cout << "Creating JK Flip-Flop: " << name << " J: " << j->getName() << " K: " << k->getName() << " Q: " << q->getName() << " Clock: " << clk->getName() << std::endl;
+    Wire* getClock() const {
+        return clock;
     }
-
-    void tick() override {
-        if (onEdge()) {
-            if(inputs[0]->isLogicLow() && inputs[1]->isLogicHigh()){
-                output->setState(WIRE_STATE::LOGIC_LOW);
-            }
-            else if (inputs[0]->isLogicHigh() && inputs[1]->isLogicLow()) {
-                output->setState(WIRE_STATE::LOGIC_HIGH);
-            } else if (inputs[0]->isLogicHigh() && inputs[1]->isLogicHigh()) {
-                output->setState(output->getState() == WIRE_STATE::LOGIC_HIGH ? WIRE_STATE::LOGIC_LOW : WIRE_STATE::LOGIC_HIGH);
-            }
-#ifdef DEBUG
-            std::cout << "JK Flip-Flop rising edge: Output set to " << (output->getState() == WIRE_STATE::LOGIC_HIGH ? "HIGH" : "LOW") << std::endl;
-#endif
-        } 
-        updatePreviousClock();
+    EDGE_TYPE getEdgeType() const {
+        return edgeType;
     }
-};
-
-class TFlipFlop : public FlipFlop {
-public:
-    TFlipFlop(std::string name, Wire* clk, Wire* t, Wire* q, EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE) : FlipFlop(name, {t}, q, clk, edgeType) {
-        std::cout << "Creating T Flip-Flop: " << name << " T: " << t->getName() << " Q: " << q->getName() << " Clock: " << clk->getName() << std::endl;
+    size_t size() const {
+        return types.size();
     }
-
-    void tick() override {
-        if (onEdge()) {
-            if (inputs[0]->isLogicHigh()) {
-                output->setState(output->getState() == WIRE_STATE::LOGIC_HIGH ? WIRE_STATE::LOGIC_LOW : WIRE_STATE::LOGIC_HIGH);
-            }
-#ifdef DEBUG
-            std::cout << "T Flip-Flop rising edge: Output set to " << (output->getState() == WIRE_STATE::LOGIC_HIGH ? "HIGH" : "LOW") << std::endl;
-#endif
-        }
-        updatePreviousClock();
+    // Per flip-flop, wire indices. inputB is only read by SR and JK flip-flops, missing inputs read the floating wire.
+    const std::vector<FLIP_FLOP_TYPE>& getTypes() const {
+        return types;
+    }
+    const std::vector<uint32_t>& getInputA() const {
+        return inputA;
+    }
+    const std::vector<uint32_t>& getInputB() const {
+        return inputB;
     }
-};
\ No newline at end of file
+    const std::vector<uint32_t>& getOutputs() const {
+        return outputs;
+    }
+
+private:
+    Wire* clock;
+    EDGE_TYPE edgeType;
+    WIRE_STATE previousClock = WIRE_STATE::LOGIC_LOW;
+    std::vector<FLIP_FLOP_TYPE> types;
+    std::vector<uint32_t> inputA;
+    std::vector<uint32_t> inputB;
+    std::vector<uint32_t> outputs;
+    // Outputs sampled on the last edge, written by commit()
+    std::vector<std::pair<uint32_t, WIRE_STATE>> pending;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include "Netlist.h"
+#include <cstddef>
+#include <cstdint>
+
+// Batch gate kernels for the pattern-parallel engine.
+//
+// A batch is a run of gates with the same NODE_OP (the compiler groups them inside each level).
+// Every wire owns `words` consecutive uint64_t in two planes, value and unknown, so one gate evaluation
+// covers 64 * words lanes. The SIMD variants process 128 or 256 lanes per instruction and are picked at
+// runtime from what the CPU supports. The scalar variant is the reference and the fallback.
+//
+// All kernels share the three-valued gate semantics of Netlist::evaluateNode(): a controlling input decides
+// the output, otherwise an undefined input gives an undefined output. They return true if any output lane changed.
+namespace GateKernels {
+
+enum class ISA {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+using Kernel = bool (*)(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                        uint64_t* value, uint64_t* unknown, size_t words);
+
+bool evaluateScalar(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                    uint64_t* value, uint64_t* unknown, size_t words);
+bool evaluateSSE2(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                  uint64_t* value, uint64_t* unknown, size_t words);
+bool evaluateAVX2(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                  uint64_t* value, uint64_t* unknown, size_t words);
+
+// Best instruction set available on this machine
+ISA detect();
+bool supported(ISA isa);
+const char* name(ISA isa);
+
+// Kernel for an instruction set, or the best one for a lane width. SIMD only pays off once a wire spans
+// at least one full register, so narrow runs fall back to the scalar kernel.
+Kernel kernel(ISA isa);
+Kernel select(size_t words);
+
+}
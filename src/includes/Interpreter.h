@@ -1,56 +1,40 @@
 #pragma once
 #include "Wire.h"
+#include "WaveformStore.h"
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <vector>
 #include <unordered_map>
 
-struct testbenchInstruction {
-    int cycle;
-    std::unordered_map<Wire*, WIRE_STATE> assignments;
-};
+// Result of the last runSimulation(). Shown by the waveform viewer.
+extern WaveformStore waveform;
 
 class Interpreter {
 public:
-    Interpreter(const std::string& filename) : file(filename) {}
-
-    // Reads all lines from the file into a vector
-    std::vector<std::string> readAllLines() {
-        std::vector<std::string> lines;
-        std::string line;
-        if (!file.is_open()) return lines;
-        while (std::getline(file, line)) {
-            lines.push_back(line);
-        }
-        return lines;
-    }
-
-    // Reads the next line from the file
-    bool readNextLine(std::string& line) {
-        if (!file.is_open()) return false;
-        return static_cast<bool>(std::getline(file, line));
-    }
+    Interpreter(const std::string& filename) : path(filename) {}
 
     // I currently use txt files to read the circuit and testbench files. In the future I want to implement JSON, and include that as part of the file format.
-    void createCircuitTXT();
-    static std::vector<testbenchInstruction> circuitTestbench(const std::string& testbenchFile);
+    // False if the design could not be read or had mistakes
+    bool createCircuitTXT();
     //void createCircuitJSON();
     //void txtToJSON(const std::string& outputFile);
 
-    // Reset file to beginning
-    void reset() {
-        if (file.is_open()) {
-            file.clear();
-            file.seekg(0);
-        }
-    }
+    // Records into the global waveform store
+    static void runSimulation(std::string designFile, std::string testbenchFile, size_t maxCycles);
+    // Streams every cycle to the given sinks instead (see WaveformSink.h)
+    static void runSimulation(std::string designFile, std::string testbenchFile, size_t maxCycles, const std::vector<WaveformSink*>& sinks);
 
-    ~Interpreter() {
-        if (file.is_open()) file.close();
-    }
+    // Runs up to PatternSimulator::MAX_LANES independent testbench lanes in one pass and records lane i into laneWaveforms[i].
+    // Lanes are selected in the testbench with @<cycle>[<lane>] or @<cycle>[<high>:<low>].
+    // Lanes past the end of laneWaveforms are not kept, for callers that don't look at every lane.
+    static void runPatternSimulation(std::string designFile, std::string testbenchFile, size_t maxCycles, size_t lanes, const std::vector<WaveformStore*>& laneWaveforms);
 
-    static void runSimulation(std::string designFile, std::string testbenchFile, size_t maxCycles);
+    // Clears every registry and elaborates the design, from its netlist cache if that is up to date (see NetlistCache.h)
+    static void buildCircuit(const std::string& designFile);
 
 private:
-    std::ifstream file;
+    static void clearCircuit();
+
+    std::string path;
 };
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are read from disk the first time they are
+// touched, so opening even a very large file costs nothing until it is read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() {
+        close();
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the file, replacing any file mapped before. Fails for missing and empty files.
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const {
+        return bytes != nullptr;
+    }
+    const uint8_t* data() const {
+        return bytes;
+    }
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
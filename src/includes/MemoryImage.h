@@ -0,0 +1,55 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Memory files of ROMs and RAMs. A word takes (data width + 7) / 8 bytes, least significant byte first.
+//   - text, one hexadecimal word per line (0x is optional), blank lines and // comments are skipped.
+//     A line @<address> (hexadecimal, in words) continues at that address.
+//   - Intel HEX (.hex or .ihex, or any file starting with ':'), byte addressed
+//   - raw binary (.bin), the image as it is
+class MemoryImage {
+public:
+    enum class FORMAT {
+        TEXT,
+        INTEL_HEX,
+        BINARY
+    };
+
+    // Receives the bytes of the file in file order, at their byte address
+    using Store = std::function<void(uint64_t address, const uint8_t* bytes, size_t count)>;
+
+    // Bytes [address, address + size) of an image to write
+    struct Chunk {
+        uint64_t address;
+        const uint8_t* bytes;
+        size_t size;
+    };
+
+    // From the extension, or for a file that is already open, a ':' at its start
+    static FORMAT formatOf(const std::string& filename, const MappedFile* file = nullptr);
+
+    // Reads a mapped memory file of any format. Mistakes are reported with their line.
+    static bool read(const std::string& filename, const MappedFile& file, size_t wordSize, const Store& store);
+
+    // Writes chunks sorted by address in the format of the filename. Binary files fill the gaps between chunks
+    // with zeros, text and Intel HEX files leave them out.
+    static bool write(const std::string& filename, size_t wordSize, const std::vector<Chunk>& chunks);
+
+    // Bits [first, first + 64) of a word, first a multiple of 8. Bits past the end of the word read as 0.
+    static uint64_t bits(const uint8_t* word, size_t wordSize, size_t first) {
+        uint64_t result = 0;
+        for (size_t byte = first / 8, shift = 0; byte < wordSize && shift < 64; ++byte, shift += 8) {
+            result |= static_cast<uint64_t>(word[byte]) << shift;
+        }
+        return result;
+    }
+    static void setBits(uint8_t* word, size_t wordSize, size_t first, uint64_t bits) {
+        for (size_t byte = first / 8, shift = 0; byte < wordSize && shift < 64; ++byte, shift += 8) {
+            word[byte] = static_cast<uint8_t>(bits >> shift);
+        }
+    }
+};
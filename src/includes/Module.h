@@ -0,0 +1,126 @@
+#pragma once
+#include "Wire.h"
+#include "Component.h"
+#include "FlipFlop.h"
+#include "Arithmetic.h"
+#include "Tokenizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Module of the design file:
+//   module <name> <ports...>        a port is a wire (cin) or a bus (A[3:0])
+//       <the same commands as at the top level, including instances of earlier modules>
+//   endmodule
+// used with <module name> <instance name> <one wire or bus per port>. A port can also be connected to part
+// of a bus, e.g. A[7:4].
+// The body is parsed once, when the definition is read, into statements whose names are already resolved
+// to nets: the ports first, then the wires the module declares. An instance only replays the statements, so
+// a module is tokenized and checked once however many times it is used. Instances are flattened into the
+// circuit with their own wires and components named <instance>.<name> (<outer>.<inner>.<name> when nested),
+// so the compiled netlist, testbenches and the waveform treat them like any other wire.
+// The lines outside of any module are read as the body of an implicit top-level module, so every command is
+// parsed and checked in one place. Its names are the wires and buses of the circuit, and each line is
+// created as soon as it is read instead of being kept.
+class Module {
+public:
+    static std::unordered_map<std::string, Module*> modules;
+
+    // The top level of a design
+    Module() : topLevel(true) {}
+    // Reads the "module <name> <ports...>" line. Mistakes are reported through words.
+    explicit Module(const Tokenizer& words);
+
+    // Adds a line of the body, or creates it at the top level. Lines with mistakes are reported and left out.
+    void addLine(const Tokenizer& words);
+
+    // Creates an instance. ports holds the wires connected to each port, in port order, with the port's width.
+    void instantiate(const std::string& instance, const std::vector<std::vector<Wire*>>& ports) const;
+
+    const std::string& getName() const {
+        return name;
+    }
+    size_t portCount() const {
+        return ports;
+    }
+    uint32_t portWidth(size_t port) const {
+        return nets[port].width;
+    }
+
+private:
+    // A port or a wire the module declares
+    struct Net {
+        uint32_t width;
+        bool bus;
+    };
+    // Net of an optional wire the line left out, or of a wire declared at the top level
+    static constexpr uint32_t NO_NET = UINT32_MAX;
+    // A whole net, or count wires of a bus from bit on: x[3] or x[7:4]. count is the width either way.
+    // At the top level the net is already there, and wires points at its wires in Wire::wireMap or WireBus::wireBusMap.
+    struct Operand {
+        uint32_t net;
+        int32_t bit = -1;
+        uint32_t count = 1;
+        bool bus = false;
+        Wire* const* wires = nullptr;
+    };
+    enum class STATEMENT : uint8_t {
+        WIRE,
+        GATE,
+        FLIP_FLOP,
+        MUX,
+        DEMUX,
+        ROM,
+        RAM,
+        ARITHMETIC,
+        REGISTER,
+        ASSIGN,
+        INSTANCE,
+    };
+    struct Statement {
+        STATEMENT kind;
+        COMPONENT gate = COMPONENT::AND;
+        FLIP_FLOP_TYPE flipFlop = FLIP_FLOP_TYPE::D_FLIP_FLOP;
+        ARITHMETIC_OP arithmetic = ARITHMETIC_OP::ADD;
+        EDGE_TYPE edge = EDGE_TYPE::RISING_EDGE;
+        WIRE_STATE state = WIRE_STATE::LOGIC_UNDEFINED;
+        bool clock = false;
+        ClockTiming timing; // WIRE of a clock
+        Operand net{NO_NET}; // WIRE: the net it declares
+        size_t ways = 0;    // MUX, DEMUX
+        const Module* module = nullptr; // INSTANCE
+        std::string name;   // local name of what is created
+        std::string file;   // ROM, RAM preload
+        std::string dump;   // RAM
+        std::vector<Operand> operands;
+    };
+
+    // Wires of every net of an instance, by net. Unused at the top level.
+    using Frame = std::vector<std::vector<Wire*>>;
+
+    // Declares a net from a word such as x or x[3:0]. Returns what is wrong with the word, or nothing.
+    std::string declare(std::string_view word, Operand& net);
+    // Resolves a word to any net or bus wire, one wire only, or a whole bus
+    bool operand(const Tokenizer& words, size_t word, Operand& result) const;
+    bool wireOperand(const Tokenizer& words, size_t word, Operand& result) const;
+    bool busOperand(const Tokenizer& words, size_t word, Operand& result) const;
+    // " in module <name>", or nothing at the top level
+    std::string where() const;
+
+    // Creates what a statement describes, named prefix + its name. False if a ROM or RAM couldn't load its memory,
+    // or if a wire declared at the top level took a name that was already there.
+    bool create(const Statement& statement, const std::string& prefix, Frame& frame) const;
+
+    std::string name;
+    bool topLevel = false;
+    size_t ports = 0;
+    std::vector<Net> nets;
+    std::unordered_map<std::string, uint32_t> netIndex;
+    std::vector<Statement> statements;
+    // Reused at the top level for each line and its lookups
+    Statement line;
+    mutable std::string key;
+};
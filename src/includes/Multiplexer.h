@@ -1,63 +1,116 @@
 #pragma once
 #include <cstddef>
 #include <iostream>
+#include <string_view>
 #include <sys/stat.h>
 #include <vector>
 #include "Wire.h"
 #include "WireBus.h"
+#include "Scheduler.h"
 
-class Multiplexer {
+class Multiplexer : public Schedulable {
 private:
     std::vector<std::vector<Wire*>> inputBuses;
     std::vector<Wire*> select;
     std::vector<Wire*> outBus;
     std::string name;
     size_t size;
+    // Buses with consecutive handles are read and driven 64 wires at a time
+    bool consecutiveSelect;
+    std::vector<bool> consecutiveInputs;
+    bool consecutiveOutput;
 public:
     static std::vector<Multiplexer*> multiplexers; 
 
-    Multiplexer(size_t size, std::string name, std::vector<std::vector<Wire*>> inputBuses, std::vector<Wire*> select, std::vector<Wire*> outBus)
-        : size(size), name(name), inputBuses(inputBuses), select(select), outBus(outBus) {
+    // Dimensions of a MUX/DEMUX line: <N>x1 for a multiplexer, 1x<N> for a demultiplexer, any N of at least 2
+    static bool parseDimensions(std::string_view word, size_t& ways, bool& demux);
+    // Select wires of an N-way MUX/DEMUX, enough to count to N - 1. A select past the last way picks nothing.
+    static size_t selectWidth(size_t ways);
+
+    Multiplexer(size_t size, std::string name, std::vector<std::vector<Wire*>> inputs, std::vector<Wire*> selectBus, std::vector<Wire*> output)
+        : inputBuses(std::move(inputs)), select(std::move(selectBus)), outBus(std::move(output)), name(name), size(size) {
         std::cout << "Creating Multiplexer: " << name << " with size: " << size << std::endl;
         if (inputBuses.empty() || select.empty() || outBus.empty()) {
             throw std::invalid_argument("Input buses, select lines, and output bus cannot be empty.");
         }
-        if (select.size() > 1 && inputBuses.size() != (1 << select.size())) {
-            throw std::invalid_argument("Number of input buses must match 2^number_of_select_lines.");
+        if (select.size() != selectWidth(inputBuses.size())) {
+            throw std::invalid_argument("Number of select lines must fit the number of input buses.");
         }
-        if (outBus.size() != inputBuses[0].size()) {
-            throw std::invalid_argument("Output bus size must match input bus size.");
+        for (const auto& bus : inputBuses) {
+            if (bus.size() != outBus.size()) throw std::invalid_argument("Output bus size must match input bus size.");
         }
+        consecutiveSelect = WireBus::consecutive(select);
+        consecutiveInputs.reserve(inputBuses.size());
+        for (const auto& bus : inputBuses) consecutiveInputs.push_back(WireBus::consecutive(bus));
+        consecutiveOutput = WireBus::consecutive(outBus);
         multiplexers.push_back(this);
     }
     
     void tick();
+    void evaluate() override {
+        tick();
+    }
+
+    const std::string& getName() const {
+        return name;
+    }
+    const std::vector<std::vector<Wire*>>& getInputBuses() const {
+        return inputBuses;
+    }
+    const std::vector<Wire*>& getSelect() const {
+        return select;
+    }
+    const std::vector<Wire*>& getOutputBus() const {
+        return outBus;
+    }
 };
 
-class Demultiplexer {
+class Demultiplexer : public Schedulable {
 private:
     std::vector<Wire*> input;
     std::vector<Wire*> select;
     std::vector<std::vector<Wire*>> outputBuses;
     std::string name;
     size_t size;
+    bool consecutiveInput;
+    bool consecutiveSelect;
+    std::vector<bool> consecutiveOutputs;
 public:
     static std::vector<Demultiplexer*> demultiplexers;
 
-    Demultiplexer(size_t size, std::string name, std::vector<Wire*> input, std::vector<Wire*> select, std::vector<std::vector<Wire*>> outputBuses)
-        : size(size), name(name), input(input), select(select), outputBuses(outputBuses) {
+    Demultiplexer(size_t size, std::string name, std::vector<Wire*> inputBus, std::vector<Wire*> selectBus, std::vector<std::vector<Wire*>> outputs)
+        : input(std::move(inputBus)), select(std::move(selectBus)), outputBuses(std::move(outputs)), name(name), size(size) {
         if (select.empty() || outputBuses.empty()) {
             throw std::invalid_argument("Select lines and output buses cannot be empty.");
         }
-        if (outputBuses.size() != (1 << select.size())) {
-            throw std::invalid_argument("Number of output buses must match 2^number_of_select_lines.");
+        if (select.size() != Multiplexer::selectWidth(outputBuses.size())) {
+            throw std::invalid_argument("Number of select lines must fit the number of output buses.");
         }
-        if (input.size() != outputBuses[0].size()) {
-            throw std::invalid_argument("Input size must match output bus size.");
+        for (const auto& bus : outputBuses) {
+            if (bus.size() != input.size()) throw std::invalid_argument("Input size must match output bus size.");
         }
+        consecutiveInput = WireBus::consecutive(input);
+        consecutiveSelect = WireBus::consecutive(select);
+        consecutiveOutputs.reserve(outputBuses.size());
+        for (const auto& bus : outputBuses) consecutiveOutputs.push_back(WireBus::consecutive(bus));
         demultiplexers.push_back(this);
     }
     
     void tick();
+    void evaluate() override {
+        tick();
+    }
 
+    const std::string& getName() const {
+        return name;
+    }
+    const std::vector<Wire*>& getInput() const {
+        return input;
+    }
+    const std::vector<Wire*>& getSelect() const {
+        return select;
+    }
+    const std::vector<std::vector<Wire*>>& getOutputBuses() const {
+        return outputBuses;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+#include "Wire.h"
+#include "Scheduler.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Operation of a node in the compiled netlist. The gate entries share their order with COMPONENT.
+enum class NODE_OP : uint8_t {
+    AND,
+    OR,
+    NOT,
+    XOR,
+    NAND,
+    NOR,
+    XNOR,
+    BLOCK, // Multiplexer, demultiplexer, ROM, RAM read port, arithmetic unit or gate of more than two inputs. Evaluated through its Schedulable.
+};
+
+// Compiled form of the combinational logic, built once after Interpreter::createCircuitTXT().
+// Nodes are topologically levelized and stored as flat arrays sorted by level, so walking the arrays
+// front to back is a valid evaluation order and each gate only needs a switch and two array reads.
+// Combinational loops (strongly connected components, e.g. cross-coupled NOR latches) each take a single
+// step of that order: they sit in cyclic levels and are evaluated in passes until they stop changing.
+class Netlist {
+public:
+    static Netlist current;
+    static constexpr uint32_t NO_WIRE = UINT32_MAX;
+    static constexpr uint32_t NO_LOOP = UINT32_MAX;
+
+    // Per node, sorted by level
+    std::vector<NODE_OP> op;
+    std::vector<uint32_t> inputA;
+    std::vector<uint32_t> inputB;
+    std::vector<uint32_t> output;
+    std::vector<Schedulable*> block; // nullptr for plain gates
+    std::vector<uint32_t> level;
+
+    std::vector<uint32_t> loop; // combinational loop of the node, or NO_LOOP
+
+    // Nodes of level L are [levelStart[L], levelStart[L + 1]).
+    // A cyclic level only holds loops, which don't depend on each other. Nodes downstream of a loop get
+    // ordinary levels after it.
+    std::vector<uint32_t> levelStart;
+    std::vector<uint8_t> cyclicLevel;
+
+    // Loop K -> its nodes, loopNodes[loopNodeStart[K] .. loopNodeStart[K + 1]), and the wires they drive,
+    // loopWires[loopWireStart[K] .. loopWireStart[K + 1]). All empty without loops.
+    std::vector<uint32_t> loopNodeStart;
+    std::vector<uint32_t> loopNodes;
+    std::vector<uint32_t> loopWireStart;
+    std::vector<uint32_t> loopWires;
+
+    // Wire -> combinational readers, CSR layout: readers of wire W are fanout[fanoutStart[W] .. fanoutStart[W + 1]).
+    std::vector<uint32_t> fanoutStart;
+    std::vector<uint32_t> fanout;
+
+    // Wire -> the nodes driving it after the first one, in file order, same layout. Only wires with several drivers
+    // have entries. The last driver in the file wins, so when one driver changes the wire the later ones run again.
+    std::vector<uint32_t> laterDriverStart;
+    std::vector<uint32_t> laterDrivers;
+
+    // Wire -> sequential elements clocked by it (clock domains of flip-flops, then RAM write ports, then registers),
+    // same layout.
+    std::vector<uint32_t> clockFanoutStart;
+    std::vector<Schedulable*> clockFanout;
+
+    // Unconnected gate inputs read this slot, which stays undefined.
+    uint32_t floatingWire = NO_WIRE;
+
+    void compile();
+    void clear();
+
+    size_t nodeCount() const {
+        return op.size();
+    }
+    size_t levelCount() const {
+        return levelStart.empty() ? 0 : levelStart.size() - 1;
+    }
+    size_t loopCount() const {
+        return loopNodeStart.empty() ? 0 : loopNodeStart.size() - 1;
+    }
+    size_t loopSize(uint32_t k) const {
+        return loopNodeStart[k + 1] - loopNodeStart[k];
+    }
+
+    // Error for loop K still changing after the given number of passes, naming the wires that kept changing
+    void reportOscillation(uint32_t k, size_t passes, const std::vector<uint32_t>& wires) const;
+    // Prints a line per loop after a run
+    void reportLoops(const std::vector<LoopStatistics>& statistics) const;
+
+    // Evaluate every node once, in level order.
+    void evaluateAll() {
+        for (uint32_t n = 0; n < op.size(); ++n) {
+            evaluateNode(n);
+        }
+    }
+
+    // Three-valued: a controlling input decides the output even if the other one is undefined (0 AND X is 0,
+    // 1 OR X is 1), otherwise an undefined input makes the output undefined.
+    void evaluateNode(uint32_t n) {
+        WireStates& states = Wire::states;
+        const WIRE_STATE a = states.get(inputA[n]);
+        const WIRE_STATE b = states.get(inputB[n]);
+        const bool aHigh = a == WIRE_STATE::LOGIC_HIGH, aLow = a == WIRE_STATE::LOGIC_LOW;
+        const bool bHigh = b == WIRE_STATE::LOGIC_HIGH, bLow = b == WIRE_STATE::LOGIC_LOW;
+        bool high, low;
+        switch (op[n]) {
+            case NODE_OP::AND:  high = aHigh && bHigh; low = aLow || bLow;   break;
+            case NODE_OP::OR:   high = aHigh || bHigh; low = aLow && bLow;   break;
+            case NODE_OP::NOT:  high = aLow;           low = aHigh;          break;
+            case NODE_OP::XOR:  high = (aHigh && bLow) || (aLow && bHigh); low = (aHigh && bHigh) || (aLow && bLow); break;
+            case NODE_OP::NAND: high = aLow || bLow;   low = aHigh && bHigh; break;
+            case NODE_OP::NOR:  high = aLow && bLow;   low = aHigh || bHigh; break;
+            case NODE_OP::XNOR: high = (aHigh && bHigh) || (aLow && bLow); low = (aHigh && bLow) || (aLow && bHigh); break;
+            default:
+                block[n]->evaluate();
+                return;
+        }
+        const uint32_t out = output[n];
+        if (states.set(out, high ? WIRE_STATE::LOGIC_HIGH : low ? WIRE_STATE::LOGIC_LOW : WIRE_STATE::LOGIC_UNDEFINED))
+            Scheduler::wireChanged(out);
+    }
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+// Compiled netlist cache. Elaborating a large text design is mostly tokenizing, name lookups and levelizing,
+// so the result is saved next to the design as <design>.lsimb: every wire, bus, gate, flip-flop, multiplexer,
+// RAM and ROM as records that refer to wires by handle, their names in one string table, and the arrays of
+// the compiled Netlist. ROM images read from text and Intel HEX are stored too, binary ones are mapped again on load.
+// The cache is keyed by a hash of the design text and of every ROM and RAM preload file it
+// loads, and is simply rewritten when any of them changes. Loading maps the file and recreates the objects straight from
+// the records, without reading the design text or compiling the netlist again.
+class NetlistCache {
+public:
+    // The design path with the extension .lsimb
+    static std::string pathFor(const std::string& designFile);
+
+    // Builds the circuit from the cache of the design if it is up to date. Expects empty registries.
+    // False if there is no usable cache, in which case the registries may hold part of a circuit.
+    static bool load(const std::string& designFile);
+
+    // Writes the cache of the circuit that was just elaborated from designFile
+    static bool save(const std::string& designFile);
+
+    // Cleared to always elaborate from the text, e.g. by --no-cache
+    static bool enabled;
+};
@@ -0,0 +1,219 @@
+#pragma once
+#include "Wire.h"
+#include "Netlist.h"
+#include "GateKernels.h"
+#include "RAM.h"
+#include "Arithmetic.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ClockDomain;
+class Multiplexer;
+class Demultiplexer;
+class ROM;
+class Register;
+class ReductionGate;
+
+// Pattern-parallel engine. Every wire holds a block of 64-bit words per plane, one bit per lane, where each
+// lane is an independent testbench vector. A gate is then a handful of bitwise operations across all lanes.
+//   value   - lane is high
+//   unknown - lane is undefined (value bit is kept at 0)
+// Wire W owns words [W * words, (W + 1) * words) of each plane. Runs of same-type gates go through the
+// batch kernels in GateKernels.h, which use SSE2/AVX2 when the lane block is wide enough.
+// It runs on the same compiled netlist as the event-driven kernel and reproduces its results lane by lane.
+class PatternSimulator {
+public:
+    static constexpr size_t LANES_PER_WORD = 64;
+    static constexpr size_t MAX_LANES = 1024;
+
+    PatternSimulator(const Netlist& netlist, size_t lanes);
+
+    size_t laneCount() const {
+        return words * LANES_PER_WORD;
+    }
+
+    // Drive a wire in lanes [firstLane, lastLane]
+    void setWire(uint32_t wire, size_t firstLane, size_t lastLane, WIRE_STATE state);
+
+    // Evaluate combinational logic and flip-flops until nothing changes
+    void settle();
+
+    // Append the current state of every wire to the recorded trace
+    void record();
+    size_t recordedCycles() const {
+        return cycles;
+    }
+
+    WIRE_STATE getState(uint32_t wire, size_t lane) const {
+        size_t word = wire * words + lane / LANES_PER_WORD;
+        return laneState(value[word], unknown[word], lane % LANES_PER_WORD);
+    }
+
+    // De-interleave one lane of the recorded trace into the usual name -> states layout
+    std::unordered_map<std::string, std::vector<WIRE_STATE>> laneWaveform(size_t lane) const;
+
+    // Writes the RAM contents of one lane to their dump files
+    void dumpRams(size_t lane) const;
+
+    // Per combinational loop of the netlist. A loop counts as woken in every settle, since all nodes run.
+    const std::vector<LoopStatistics>& getLoopStatistics() const {
+        return loopStatistics;
+    }
+
+private:
+    struct MuxProgram {
+        const Multiplexer* mux;
+        std::vector<std::vector<uint32_t>> inputs;
+        std::vector<uint32_t> select;
+        std::vector<uint32_t> outputs;
+    };
+    struct DemuxProgram {
+        const Demultiplexer* demux;
+        std::vector<uint32_t> input;
+        std::vector<uint32_t> select;
+        std::vector<std::vector<uint32_t>> outputs;
+    };
+    struct RomProgram {
+        const ROM* rom;
+        std::vector<uint32_t> address;
+        std::vector<uint32_t> outputs;
+    };
+    // Every lane starts from the RAM's own (preloaded) memory and gets a copy of a page when it first writes to it
+    struct RamProgram {
+        const RAM* ram;
+        uint32_t clock;
+        uint32_t writeEnable;
+        std::vector<uint32_t> address;
+        std::vector<uint32_t> dataIn;
+        std::vector<uint32_t> dataOut;
+        std::vector<uint64_t> previousValue;
+        std::vector<uint64_t> previousUnknown;
+        std::vector<SparseMemory> lanes;
+    };
+    // Evaluated bit-sliced: a ripple of word operations across all lanes, one per wire of the operands
+    struct ArithmeticProgram {
+        const Arithmetic* unit;
+        std::vector<uint32_t> a;
+        std::vector<uint32_t> b;
+        uint32_t carryIn; // Netlist::NO_WIRE reads as low
+        std::vector<uint32_t> result;
+        std::vector<uint32_t> flags; // Netlist::NO_WIRE where the design left a flag out
+    };
+    struct RegisterProgram {
+        const Register* reg;
+        uint32_t clock;
+        uint32_t enable; // Netlist::NO_WIRE is always enabled
+        std::vector<uint32_t> inputD;
+        std::vector<uint32_t> outputQ;
+        std::vector<uint64_t> previousValue;
+        std::vector<uint64_t> previousUnknown;
+        // Per word, lanes to write on commit, and per wire of Q and word their value
+        std::vector<uint64_t> load;
+        std::vector<uint64_t> nextValue;
+        std::vector<uint64_t> nextUnknown;
+    };
+    // Gate of more than two inputs, reduced one input at a time across all lanes
+    struct GateProgram {
+        const ReductionGate* gate;
+        std::vector<uint32_t> inputs;
+        uint32_t output;
+    };
+    enum class BLOCK_KIND : uint8_t { MUX, DEMUX, ROM, RAM, ARITHMETIC, GATE };
+    struct BlockRef {
+        BLOCK_KIND kind;
+        uint32_t index;
+    };
+    // The flip-flops of a ClockDomain, sampled together on an edge and written in the commit phase of settle()
+    struct DomainProgram {
+        const ClockDomain* domain;
+        uint32_t clock;
+        // Previous clock per word, all lanes start low
+        std::vector<uint64_t> previousValue;
+        std::vector<uint64_t> previousUnknown;
+        // Per flip-flop and word: lanes to write on commit, and their value
+        std::vector<uint64_t> load;
+        std::vector<uint64_t> nextValue;
+        std::vector<uint64_t> nextUnknown;
+    };
+    // Consecutive nodes with the same op. Blocks are always a run of one.
+    struct Run {
+        NODE_OP op;
+        uint32_t start;
+        uint32_t count;
+    };
+    // Runs [firstRun, lastRun). A combinational loop is a segment of its own and is iterated until it stops
+    // changing, the acyclic nodes between loops share one segment (loop is NO_LOOP).
+    struct Segment {
+        size_t firstRun;
+        size_t lastRun;
+        uint32_t loop;
+    };
+
+    static WIRE_STATE laneState(uint64_t value, uint64_t unknown, size_t lane) {
+        if ((unknown >> lane) & 1) return WIRE_STATE::LOGIC_UNDEFINED;
+        return ((value >> lane) & 1) ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW;
+    }
+
+    size_t at(uint32_t wire, size_t word) const {
+        return wire * words + word;
+    }
+    // Lanes where the wire is high / low, for one word of the lane block
+    uint64_t high(uint32_t wire, size_t word) const {
+        return value[at(wire, word)] & ~unknown[at(wire, word)];
+    }
+    uint64_t low(uint32_t wire, size_t word) const {
+        return ~value[at(wire, word)] & ~unknown[at(wire, word)];
+    }
+    // Write the lanes in mask, returns true if any lane changed
+    bool assign(uint32_t wire, size_t word, uint64_t mask, uint64_t newValue, uint64_t newUnknown);
+
+    bool evaluateRuns(size_t first, size_t last);
+    bool evaluateNodes();
+    bool settleLoop(const Segment& segment);
+    // Sets the wires of an oscillating loop undefined in the lanes it oscillates in, false if it doesn't
+    bool restartLoop(const Segment& segment);
+    bool evaluateBlock(uint32_t n);
+    bool evaluateMux(const MuxProgram& program, size_t word);
+    bool evaluateDemux(const DemuxProgram& program, size_t word);
+    bool evaluateRom(const RomProgram& program, size_t word);
+    bool evaluateRam(const RamProgram& program, size_t word);
+    bool evaluateArithmetic(const ArithmeticProgram& program, size_t word);
+    bool evaluateShift(const ArithmeticProgram& program, size_t word);
+    bool evaluateGate(const GateProgram& program, size_t word);
+    uint64_t selectMatch(const std::vector<uint32_t>& select, size_t index, size_t word) const;
+    uint64_t undefinedLanes(const std::vector<uint32_t>& bus, size_t word) const;
+    void tickDomain(DomainProgram& program, size_t word, uint64_t lanes);
+    void commitDomain(DomainProgram& program);
+    void tickRam(RamProgram& program, size_t word, uint64_t lanes);
+    void tickRegister(RegisterProgram& program, size_t word, uint64_t lanes);
+    void commitRegister(RegisterProgram& program);
+    uint64_t laneAddress(const std::vector<uint32_t>& address, size_t word, size_t lane) const;
+
+    const Netlist& netlist;
+    const size_t words;
+    const GateKernels::Kernel kernel;
+    std::vector<uint64_t> value;
+    std::vector<uint64_t> unknown;
+    std::vector<Run> runs;
+    std::vector<Segment> segments;
+    std::vector<LoopStatistics> loopStatistics;
+    std::vector<BlockRef> blockRefs; // per node, only meaningful for BLOCK nodes
+    std::vector<MuxProgram> muxes;
+    std::vector<DemuxProgram> demuxes;
+    std::vector<RomProgram> roms;
+    std::vector<RamProgram> rams;
+    std::vector<ArithmeticProgram> arithmetics;
+    std::vector<GateProgram> gates;
+    std::vector<RegisterProgram> registers;
+    std::vector<DomainProgram> domains;
+    bool firstSettle = true;
+
+    // Recorded trace: per cycle, a copy of both planes for the named wires
+    std::vector<uint64_t> traceValue;
+    std::vector<uint64_t> traceUnknown;
+    size_t tracedWires = 0;
+    size_t cycles = 0;
+};
@@ -0,0 +1,162 @@
+#pragma once
+#include "Wire.h"
+#include "WireBus.h"
+#include "Scheduler.h"
+#include "MemoryImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Words of a memory kept in pages of PAGE_WORDS words, which are only allocated once something is stored in
+// them. A 32-bit (or wider) address space costs the pages that were used and nothing else.
+class SparseMemory {
+public:
+    static constexpr uint64_t PAGE_WORDS = 1024;
+
+    explicit SparseMemory(size_t wordSize = 1) : wordSize(wordSize) {}
+
+    // Bytes of the word at an address, or nullptr if its page was never written (the word reads as 0)
+    const uint8_t* find(uint64_t address) const {
+        const uint8_t* stored = page(address / PAGE_WORDS);
+        return stored ? stored + address % PAGE_WORDS * wordSize : nullptr;
+    }
+    // Bytes of the word at an address, allocating its page
+    uint8_t* write(uint64_t address) {
+        return addPage(address / PAGE_WORDS) + address % PAGE_WORDS * wordSize;
+    }
+    // Byte addressed, e.g. from a memory file
+    void store(uint64_t address, const uint8_t* bytes, size_t count);
+
+    const uint8_t* page(uint64_t index) const {
+        auto found = pages.find(index);
+        return found == pages.end() ? nullptr : found->second.get();
+    }
+    // Allocates a page, zeroed or as a copy of initial. Existing pages are returned as they are.
+    uint8_t* addPage(uint64_t index, const uint8_t* initial = nullptr);
+
+    // Every page, lowest address first, with byte addresses
+    std::vector<MemoryImage::Chunk> chunks() const;
+
+    size_t pageCount() const {
+        return pages.size();
+    }
+    size_t pageBytes() const {
+        return PAGE_WORDS * wordSize;
+    }
+    size_t wordBytes() const {
+        return wordSize;
+    }
+
+private:
+    size_t wordSize;
+    std::unordered_map<uint64_t, std::unique_ptr<uint8_t[]>> pages;
+};
+
+// Synchronous RAM. The read port is combinational, like a ROM: the data out bus always shows the word at the
+// address, 0 for words never written, undefined while the address is. On a rising edge of the clock with write
+// enable high, the word on the data in bus is written at the address (undefined data wires are stored as 0, an
+// undefined address writes nothing), and shows on data out after everything clocked by the same edge has
+// sampled the old word, if it is being read.
+// Memory files are read and written by MemoryImage. The preload file fills the memory before the simulation,
+// the dump file receives its contents after it.
+class RAM : public Schedulable {
+public:
+    static std::vector<RAM*> rams;
+
+    RAM(std::string name, Wire* clock, Wire* writeEnable,
+        const std::vector<Wire*>& addressBus,
+        const std::vector<Wire*>& dataIn,
+        const std::vector<Wire*>& dataOut,
+        const std::string preloadFile = "",
+        const std::string dumpFile = "");
+
+    // Read port
+    void tick();
+    void evaluate() override {
+        tick();
+    }
+
+    // Write port, woken by the clock like a flip-flop
+    Schedulable* clockPort() {
+        return &writePort;
+    }
+
+    // Writes the contents to the dump file, if there is one
+    bool dump() const;
+    // Same, with the pages of overlay taking the place of the memory's own (see PatternSimulator)
+    bool dump(const SparseMemory& overlay) const;
+
+    const SparseMemory& getMemory() const {
+        return memory;
+    }
+    const std::string& getName() const {
+        return name;
+    }
+    const std::string& getPreloadFile() const {
+        return preloadFile;
+    }
+    const std::string& getDumpFile() const {
+        return dumpFile;
+    }
+    Wire* getClock() const {
+        return clock;
+    }
+    Wire* getWriteEnable() const {
+        return writeEnable;
+    }
+    const std::vector<Wire*>& getAddressBus() const {
+        return addressBus;
+    }
+    const std::vector<Wire*>& getDataIn() const {
+        return dataIn;
+    }
+    const std::vector<Wire*>& getDataOut() const {
+        return dataOut;
+    }
+
+private:
+    class WritePort : public Schedulable {
+    public:
+        explicit WritePort(RAM& ram) : ram(ram) {}
+        void evaluate() override {
+            ram.clockChanged();
+        }
+        void commit() override {
+            ram.showWritten();
+        }
+        bool isSequential() const override {
+            return true;
+        }
+
+    private:
+        RAM& ram;
+    };
+
+    void clockChanged();
+    // Puts a word written on this edge on data out, once everything clocked by the edge has sampled it
+    void showWritten();
+
+    std::string name;
+    Wire* clock;
+    Wire* writeEnable;
+    std::vector<Wire*> addressBus;
+    std::vector<Wire*> dataIn;
+    std::vector<Wire*> dataOut;
+    std::string preloadFile;
+    std::string dumpFile;
+    SparseMemory memory;
+    WritePort writePort{*this};
+
+    bool consecutiveAddress = false;
+    bool consecutiveDataIn = false;
+    bool consecutiveDataOut = false;
+    // Address whose word is on data out, unless stale
+    uint64_t lastAddress = 0;
+    bool stale = true;
+    // The word being read was written on this edge
+    bool written = false;
+    WIRE_STATE previousClock = WIRE_STATE::LOGIC_LOW;
+};
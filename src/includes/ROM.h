@@ -1,64 +1,93 @@
+#pragma once
 #include "WireBus.h"
 #include "Wire.h"
+#include "Scheduler.h"
+#include "MappedFile.h"
+#include "MemoryImage.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
-#include <fstream>
-#include <sstream>
-#include <bitset>
-#include <iomanip>
+#include <vector>
 
-class ROM {
+// Read-only memory of any data width. The image is one flat array of words of (data width + 7) / 8 bytes,
+// little-endian, so a ROM costs its image size and nothing per word. Memory files are read by MemoryImage;
+// raw binary (.bin) files are memory-mapped and read in place instead of being copied.
+// Addresses past the end of the image leave the data bus as it is, an undefined address makes it undefined.
+class ROM : public Schedulable {
     std::vector<Wire*> addressBus;
     std::vector<Wire*> outputBus;
-    std::unordered_map<int, std::vector<WIRE_STATE>> memory;
     std::string name;
     std::string filename;
+    size_t wordSize;
+
+    // The image: either the mapped binary file or memory filled from a text format
+    MappedFile mapped;
+    std::vector<uint8_t> memory;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    // Buses always have consecutive handles, so the address is decoded and the data driven a word at a time
+    bool consecutiveAddress = false;
+    bool consecutiveOutput = false;
+    uint64_t lastAddress = UINT64_MAX;
+
+    bool load();
+    void prepare();
+
 public:
     static std::vector<ROM*> roms;
     ROM(std::string name,
         const std::vector<Wire*>& addressBus,
         const std::vector<Wire*>& outputBus,
-        const std::string filename)
-        : name(name), addressBus(addressBus), outputBus(outputBus), filename(filename) {
+        const std::string filename);
 
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            std::cerr << "Error opening memory file: " << filename << std::endl;
-            return;
-        }
-        std::string line;
-        int address = 0;
-        while (std::getline(file, line)) {
-            std::stringstream iss(line);
-            std::vector<WIRE_STATE> binaryStates;
-            unsigned int hexValue;
-            iss >> std::hex >> hexValue;
+    // ROM with an image that was already read from filename, e.g. from a netlist cache
+    ROM(std::string name,
+        const std::vector<Wire*>& addressBus,
+        const std::vector<Wire*>& outputBus,
+        const std::string filename,
+        const uint8_t* image,
+        size_t imageSize);
 
-            std::cout << "Hex value: " << hexValue << " at address: " << address << std::endl;
-            
-            std::bitset<8> bits(hexValue);
-            for (int i = 0; i < 8; ++i) {
-                binaryStates.push_back(bits[i] ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW);
-            }
-            memory[address++] = binaryStates;
-        }
-        file.close();
-        roms.push_back(this);
-        std::cout << "ROM " << name << " loaded with " << memory.size() << " entries from " << filename << std::endl;
+    // Drives the data bus with the word at the current address. Nothing is read while the address stays the same.
+    void tick();
+
+    void evaluate() override {
+        tick();
     }
 
-    void tick() {
-        int address = 0;
-        for (size_t i = 0; i < addressBus.size(); ++i)
-            if (addressBus[i]->isLogicHigh())
-                address |= (1 << i);
+    // Bytes of the word stored at an address, or nullptr past the end of the image
+    const uint8_t* word(uint64_t address) const {
+        return address < depth() ? data + address * wordSize : nullptr;
+    }
+    size_t depth() const {
+        return size / wordSize;
+    }
+    size_t wordBytes() const {
+        return wordSize;
+    }
+    // The whole image, address 0 first
+    const uint8_t* image() const {
+        return data;
+    }
+    size_t imageSize() const {
+        return size;
+    }
+    // True for a binary file used in place, which a netlist cache maps again rather than storing
+    bool isMapped() const {
+        return mapped.isOpen();
+    }
 
-        auto it = memory.find(address);
-        if (it != memory.end()) {
-            const auto& data = it->second;
-            for (size_t i = 0; i < outputBus.size(); ++i) {
-                outputBus[i]->setState(data[i]);
-            }
-        }
+    const std::string& getName() const {
+        return name;
+    }
+    const std::string& getFilename() const {
+        return filename;
+    }
+    const std::vector<Wire*>& getAddressBus() const {
+        return addressBus;
+    }
+    const std::vector<Wire*>& getOutputBus() const {
+        return outputBus;
     }
 };
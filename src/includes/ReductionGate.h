@@ -0,0 +1,47 @@
+#pragma once
+#include "Wire.h"
+#include "WireBus.h"
+#include "Component.h"
+#include "Scheduler.h"
+#include <string>
+#include <vector>
+
+// Gate with any number of inputs: AND <name> <input1> <input2> ... <inputN> <output>, and the same for OR, XOR,
+// NAND, NOR and XNOR. An input can be a bus, which adds all of its wires, so AND <name> A <output> ANDs every
+// wire of A. Gates that come out at two input wires stay plain components, anything wider is one of these:
+// a single node whose inputs are read 64 wires at a time and reduced a word at a time. AND, OR and their
+// inverses stop at the first word with a controlling input, XOR and XNOR at the first undefined one.
+class ReductionGate : public Schedulable {
+public:
+    static std::vector<ReductionGate*> gates;
+
+    // Creates a two-input Component, or a ReductionGate for more inputs. Returns false for fewer than two.
+    static bool create(COMPONENT type, const std::string& name, std::vector<Wire*> inputs, Wire* output);
+
+    ReductionGate(COMPONENT type, std::string name, std::vector<Wire*> inputs, Wire* output);
+
+    void tick();
+    void evaluate() override {
+        tick();
+    }
+
+    COMPONENT getType() const {
+        return type;
+    }
+    const std::string& getName() const {
+        return name;
+    }
+    const std::vector<Wire*>& getInputs() const {
+        return inputs;
+    }
+    Wire* getOutput() const {
+        return output;
+    }
+
+private:
+    COMPONENT type;
+    std::string name;
+    std::vector<Wire*> inputs;
+    Wire* output;
+    bool consecutiveInputs;
+};
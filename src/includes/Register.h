@@ -0,0 +1,61 @@
+#pragma once
+#include "Wire.h"
+#include "WireBus.h"
+#include "Scheduler.h"
+#include "FlipFlop.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// N-bit register: REG <name> <clock> <enable|-> <D> <Q> [rising|falling]
+// On the clock edge, while enable is high (or without an enable), Q takes D, 64 wires at a time. While enable
+// is undefined, the bits where D and Q differ become undefined. Woken by its clock like a flip-flop, and like
+// one it samples D in tick() and drives Q in commit().
+class Register : public Schedulable {
+public:
+    static std::vector<Register*> registers;
+
+    Register(std::string name, Wire* clock, Wire* enable, const std::vector<Wire*>& inputD, const std::vector<Wire*>& outputQ,
+             EDGE_TYPE edgeType = EDGE_TYPE::RISING_EDGE);
+
+    void tick();
+    void evaluate() override {
+        tick();
+    }
+    void commit() override;
+    bool isSequential() const override {
+        return true;
+    }
+
+    const std::string& getName() const {
+        return name;
+    }
+    Wire* getClock() const {
+        return clock;
+    }
+    Wire* getEnable() const {
+        return enable;
+    }
+    const std::vector<Wire*>& getInputD() const {
+        return inputD;
+    }
+    const std::vector<Wire*>& getOutputQ() const {
+        return outputQ;
+    }
+    EDGE_TYPE getEdgeType() const {
+        return edgeType;
+    }
+
+private:
+    std::string name;
+    Wire* clock;
+    Wire* enable;
+    std::vector<Wire*> inputD;
+    std::vector<Wire*> outputQ;
+    EDGE_TYPE edgeType;
+    bool consecutiveD, consecutiveQ;
+    // Value and unknown plane of every 64 wires of Q, sampled on the edge
+    std::vector<uint64_t> next;
+    bool loaded = false;
+    WIRE_STATE previousClock = WIRE_STATE::LOGIC_LOW;
+};
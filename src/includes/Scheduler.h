@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// Anything that has to be re-evaluated when one of the wires it reads changes.
+// Gates, multiplexers, ROMs and flip-flops all derive from this so they can share one event queue.
+class Schedulable {
+public:
+    virtual ~Schedulable() = default;
+    virtual void evaluate() = 0;
+
+    // Sequential elements (flip-flops) only run once the combinational logic has settled.
+    virtual bool isSequential() const { return false; }
+
+    // Sequential elements sample their inputs in evaluate() and write their outputs here, once everything
+    // woken in the same delta has sampled. Elements feeding each other directly see the state before the edge.
+    virtual void commit() {}
+
+    bool queued = false;
+};
+
+// How often a combinational loop had to be evaluated before it settled, collected by the simulators.
+// A pass evaluates every node of the loop once.
+struct LoopStatistics {
+    size_t settles = 0;      // settles in which the loop was woken
+    size_t passes = 0;       // summed over all of them
+    size_t mostPasses = 0;   // in a single settle
+    size_t oscillations = 0; // settles where it hit the cap
+};
+
+// Event-driven kernel. Wire::setState() only schedules the readers of a wire when its value really changes,
+// so the amount of work per cycle tracks switching activity instead of design size.
+// Combinational readers are kept in one bucket per level of the compiled netlist (see Netlist.h) and
+// run in level order, so every node is evaluated at most once per settle() unless it sits in a loop.
+// When a node changes a wire that other nodes further down the file drive as well, those run again too,
+// so the last driver in the file wins no matter which of them was woken.
+// A woken loop is evaluated in passes over all its nodes in file order until a pass changes nothing, the
+// same passes PatternSimulator makes, so a race inside a loop resolves the same way in both engines.
+// A loop still changing after MAX_LOOP_PASSES passes is reported with the wires that keep toggling
+// and restarted with all its wires undefined, so an oscillation ends up as X. A loop that doesn't settle
+// from there either is left as it is, while the remaining logic still settles around it.
+//
+// With more than one thread, wide levels are split into chunks and evaluated on a work-stealing pool.
+// Nodes of one level never read each other's outputs and never share an output wire, so they can run
+// in any order. The wire changes they cause are collected per chunk and replayed in bucket order once the
+// level is done, which keeps every later bucket and the flip-flop queue identical to a single-threaded run.
+// Flip-flops and cyclic levels always run on the calling thread.
+class Scheduler {
+public:
+    // Called whenever a wire changes value. Queues every node reading it.
+    static void wireChanged(uint32_t wire);
+
+    // Queue a sequential element directly.
+    static void schedule(Schedulable* node);
+
+    // Size the level buckets for Netlist::current. Called once after compiling.
+    static void prepare();
+
+    // Queue every node once. Used for the very first evaluation, when nothing has "changed" yet.
+    static void scheduleAll();
+
+    // Run queued events until the system is stable.
+    static void settle();
+
+    static void clear();
+
+    // Number of threads used by settle(). 1 (the default) keeps everything on the calling thread.
+    static void setThreads(size_t threads);
+    static size_t getThreads();
+
+    static size_t evaluations;
+    // Per combinational loop of Netlist::current
+    static std::vector<LoopStatistics> loopStatistics;
+
+private:
+    static std::vector<std::vector<uint32_t>> levelBuckets;
+    static std::vector<uint8_t> dirty;
+    static size_t lowestDirtyLevel;
+    // Level settle() is working off, NO_LEVEL outside of it. Only changes made there wake later drivers.
+    static size_t currentLevel;
+    static constexpr size_t NO_LEVEL = SIZE_MAX;
+    static std::vector<Schedulable*> sequentialQueue;
+
+    static void evaluateLevel(std::vector<uint32_t>& bucket);
+    // Works off a cyclic level, returns the number of evaluations
+    static size_t settleLoops(std::vector<uint32_t>& bucket);
+    // Passes over loop K until it stops changing, returns their number
+    static size_t settleLoop(uint32_t k);
+    // Evaluates every node of loop K once in file order, true if it has to run again
+    static bool loopPass(uint32_t k);
+
+    static std::unique_ptr<ThreadPool> pool;
+    // Wire changes made by each chunk of the level being evaluated in parallel
+    static std::vector<std::vector<uint32_t>> chunkChanges;
+    // Set on a thread while it evaluates a chunk. wireChanged() appends to it instead of waking readers.
+    static thread_local std::vector<uint32_t>* deferredChanges;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include "Wire.h"
+#include "Tokenizer.h"
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Testbench stimulus, handed out one cycle at a time. Lines look like
+//   @<cycle>[<lane>|<high>:<low>] set <wire> high|low
+// Wire names are resolved to handles once, when their line is read. A file whose cycles never go down is
+// streamed: only the lines up to the cycle being simulated are read, so memory stays bounded however long
+// the stimulus is. Any other file is read whole and sorted by cycle once.
+class Testbench {
+public:
+    struct Stimulus {
+        size_t cycle;
+        uint32_t wire;
+        WIRE_STATE state;
+        // Pattern-parallel runs only: the lanes [firstLane, lastLane] the assignment applies to. Scalar runs simulate lane 0.
+        int firstLane = 0;
+        int lastLane = INT_MAX;
+    };
+
+    // Opens a testbench for the circuit that is currently built. An empty path gives an empty testbench.
+    explicit Testbench(const std::string& path);
+
+    // Stimuli of one cycle, in file order. Cycles have to be asked for in increasing order.
+    const std::vector<Stimulus>& at(size_t cycle);
+    // Cycle of the first stimulus not handed out yet, SIZE_MAX once there are none
+    size_t nextCycle() const {
+        if (streaming) return hasLookahead ? lookahead.cycle : SIZE_MAX;
+        return next < sorted.size() ? sorted[next].cycle : SIZE_MAX;
+    }
+
+private:
+    // Next valid stimulus in the file, reporting bad lines to stderr
+    bool read(Stimulus& stimulus);
+
+    std::ifstream file;
+    std::string line;
+    size_t lineNumber = 0;
+    Tokenizer words;
+    std::string wireName; // lookup key, reused so reading a line does not allocate
+    bool streaming = false;
+
+    // Streaming: the first stimulus not handed out yet
+    Stimulus lookahead{};
+    bool hasLookahead = false;
+
+    // Otherwise: the whole file in cycle order and a cursor into it
+    std::vector<Stimulus> sorted;
+    size_t next = 0;
+
+    std::vector<Stimulus> current;
+};
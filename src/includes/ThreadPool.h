@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads used by the scheduler to evaluate large netlist levels in parallel.
+// run() splits the chunks of a job evenly between the participants (the calling thread is one of them).
+// A participant that runs out of chunks steals from the others, so an uneven level still finishes
+// together. run() only returns once every chunk is done, which makes it the barrier between levels.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of participants, including the calling thread
+    size_t size() const {
+        return slices.size();
+    }
+
+    // Calls task(chunk) once for every chunk in [0, chunks)
+    void run(size_t chunks, const std::function<void(size_t)>& task);
+
+private:
+    // Chunks still owned by one participant. Padded so the cursors don't share a cache line.
+    struct alignas(64) Slice {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+
+    void work(size_t participant);
+    void workerLoop(size_t participant);
+
+    std::vector<Slice> slices;
+    std::vector<std::thread> workers;
+    const std::function<void(size_t)>* task = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    size_t generation = 0;
+    bool stopping = false;
+    std::atomic<size_t> busy{0};
+};
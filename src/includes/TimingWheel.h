@@ -0,0 +1,39 @@
+#pragma once
+#include "Wire.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Clock edges of a run, kept in a timing wheel (calendar queue): SLOTS buckets of the cycles
+// [now, now + SLOTS), one per cycle modulo SLOTS, and a bitmap of the buckets that hold an edge. Every clock
+// has exactly one edge pending, its next level change, so next() finds the earliest edge with a few bit scans
+// however long the gaps between edges are. Edges further out than the wheel reaches, e.g. of a slow divided
+// clock, wait in a heap and move into their bucket once the wheel gets close enough.
+// The simulation loop jumps from one edge or stimulus to the next instead of visiting every cycle.
+class TimingWheel {
+public:
+    static constexpr size_t SLOTS = 256;
+
+    // Schedules every clock on cycle 0, where it takes its first level
+    explicit TimingWheel(const std::vector<ClockTiming>& timings);
+
+    // Cycle of the earliest pending edge, SIZE_MAX without clocks
+    size_t next() const;
+    // Moves to `cycle`, which can't be past next(), and returns the clocks (indices into the timings) with an
+    // edge on it. Each of them gets its following edge scheduled.
+    const std::vector<uint32_t>& advance(size_t cycle);
+
+private:
+    void schedule(size_t cycle, uint32_t clock);
+
+    const std::vector<ClockTiming>& timings;
+    size_t now = 0;
+    std::vector<std::vector<uint32_t>> slots;
+    uint64_t occupied[SLOTS / 64] = {};
+    // Edges at or past now + SLOTS, earliest on top
+    std::priority_queue<std::pair<size_t, uint32_t>, std::vector<std::pair<size_t, uint32_t>>, std::greater<>> later;
+    std::vector<uint32_t> due;
+};
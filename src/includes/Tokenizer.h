@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Splits text into lines of whitespace separated words without copying it: every word is a view into the
+// text, so a memory-mapped file can be parsed with no allocations per line. A word starting with // comments
+// out the rest of the line. Line numbers and columns are kept for diagnostics.
+class Tokenizer {
+public:
+    Tokenizer() = default;
+    Tokenizer(std::string_view text, std::string source) : text(text), source(std::move(source)) {}
+
+    // Tokenize other text, e.g. the next line of a streamed file. firstLine is the line number of its first line.
+    void reset(std::string_view newText, size_t firstLine = 1) {
+        text = newText;
+        position = 0;
+        lineNumber = firstLine - 1;
+        words.clear();
+    }
+
+    // Moves to the next line with at least one word. False at the end of the text.
+    bool nextLine();
+
+    size_t size() const {
+        return words.size();
+    }
+    // Word of the current line, or an empty view past the last one
+    std::string_view operator[](size_t word) const {
+        return word < words.size() ? words[word] : std::string_view();
+    }
+    size_t line() const {
+        return lineNumber;
+    }
+    // 1-based column of a word; past the last word, the end of the line
+    size_t column(size_t word) const;
+
+    // Prints "source:line:column: message" to stderr
+    void error(size_t word, const std::string& message) const;
+    // Number of errors reported so far
+    size_t errors() const {
+        return errorCount;
+    }
+
+    // Case-insensitive comparison with a lowercase keyword
+    static bool equalsLower(std::string_view word, std::string_view lower);
+    // Bus range such as A[7:0]: the name and both bounds. False for anything else.
+    static bool busRange(std::string_view word, std::string_view& name, int& high, int& low);
+    // Unsigned decimal number filling the whole word
+    static bool number(std::string_view word, size_t& value);
+
+private:
+    std::string_view text;
+    std::string source;
+    size_t position = 0;
+    size_t lineNumber = 0;
+    std::string_view lineText;
+    std::vector<std::string_view> words;
+    mutable size_t errorCount = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include "WaveformSink.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Streams a run to an IEEE 1364 value change dump. Buses from WireBus::wireBusMap become vector signals,
+// every other wire is a scalar. Each cycle is one time step and only signals that changed are written.
+// Output goes through a fixed size buffer, and the only per-run state is the previous snapshot, so memory
+// stays constant however long the run is.
+class VcdWriter : public WaveformSink {
+public:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    explicit VcdWriter(const std::string& path, const std::string& scope = "top");
+    ~VcdWriter() override;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    void begin(size_t maxCycles) override;
+    void sample(size_t cycle) override;
+    // Nothing changed, so there is nothing to write
+    void hold(size_t, size_t) override {}
+    void end(size_t cycles) override;
+
+private:
+    struct Signal {
+        std::string name;
+        std::string id;
+        std::vector<uint32_t> wires; // bit 0 first
+    };
+
+    void writeHeader();
+    void writeValue(const Signal& signal);
+    void flush();
+
+    std::FILE* file = nullptr;
+    std::string path;
+    std::string scope;
+    std::string buffer;
+
+    std::vector<Signal> signals;
+    std::vector<uint32_t> signalOf; // wire handle -> signal, UINT32_MAX for wires that aren't dumped
+    std::vector<uint8_t> dirty;
+    std::vector<uint32_t> changed;
+    std::vector<uint64_t> previous;
+    bool first = true;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "WaveformStore.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Text queries on a recorded run, shared by the headless simulator (--query) and the waveform viewer's search box.
+// A signal is a wire name, or a bus name that has name[0], name[1], ... entries.
+//
+//   next [rising|falling] <signal> [after <cycle>]    first edge after a cycle (default: the start)
+//   prev [rising|falling] <signal> [before <cycle>]   last edge before a cycle (default: the end)
+//   value <signal> <cycle>                            value at a cycle, buses in hex
+//   count <signal> [<first> <last>]                   number of edges in between (default: the whole run)
+//   find <signal>==<value> [from <cycle>]             first cycle with that value, decimal or 0x hex
+//   period <signal> [from <cycle>]                    period and high time between two rising edges
+struct WaveformQueryResult {
+    bool ok = false;
+    std::string text;          // the answer, or why the query failed
+    size_t cycle = SIZE_MAX;   // cycle the answer points at, for the viewer's cursor
+};
+
+WaveformQueryResult runWaveformQuery(const WaveformStore& waveform, const std::string& query);
+
+// Value of a signal or bus at a cycle: 0/1/X for wires, hex for buses (binary with X if a bit is undefined)
+std::string waveformValueAt(const WaveformStore& waveform, const std::vector<size_t>& bits, size_t cycle);
@@ -0,0 +1,19 @@
+#pragma once
+#include "Wire.h"
+#include <cstddef>
+
+// Receives the wire states of a run once per cycle. runSimulation() calls begin() after elaboration,
+// sample() after every settled cycle with a clock edge or stimulus, hold() for the cycles between those,
+// where no wire changes, and end() once the run is over. Sinks read Wire::states directly, so sampling
+// costs nothing unless the sink does something with it.
+class WaveformSink {
+public:
+    virtual ~WaveformSink() = default;
+    virtual void begin(size_t /*maxCycles*/) {}
+    virtual void sample(size_t cycle) = 0;
+    // Cycles [firstCycle, lastCycle) with the same states as the last sample
+    virtual void hold(size_t firstCycle, size_t lastCycle) {
+        for (size_t cycle = firstCycle; cycle < lastCycle; ++cycle) sample(cycle);
+    }
+    virtual void end(size_t /*cycles*/) {}
+};
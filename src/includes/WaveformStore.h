@@ -0,0 +1,211 @@
+#pragma once
+#include "WaveformSink.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compressed waveform. Each signal is cut into blocks of BLOCK_CYCLES cycles, and every block is stored in
+// whichever of these is smallest:
+//   CHANGES  - the value at the start of the block plus (offset, state) for every change. A constant block
+//              is just the 8 byte header.
+//   PERIODIC - a signal flipping between two states at a fixed interval (clocks, counter bits). Also
+//              header only.
+//   DENSE    - 2 bits per cycle.
+// Reading a cycle is a block lookup plus a binary search inside the block. Every GROUP_BLOCKS blocks also
+// get a mask of the states seen in them and their number of changes. That is the index for searching long
+// traces: edge searches and counts skip whole groups and constant blocks instead of walking every cycle.
+//
+// It records a run as a WaveformSink: sample() only copies the packed wire states, and the copies are
+// encoded every BLOCK_CYCLES cycles. The blocks are kept in memory, or with recordTo() streamed to a
+// waveform database file that is memory-mapped once the run ends. A mapped store only reads the pages of
+// the blocks that are looked at, so runs far larger than memory can be viewed.
+class WaveformStore : public WaveformSink {
+public:
+    static constexpr uint32_t BLOCK_CYCLES = 256;
+    static constexpr uint32_t GROUP_BLOCKS = 64;
+
+    WaveformStore() = default;
+    ~WaveformStore() override;
+    WaveformStore(const WaveformStore&) = delete;
+    WaveformStore& operator=(const WaveformStore&) = delete;
+
+    void begin(size_t maxCycles) override;
+    void sample(size_t cycle) override;
+    void end(size_t cycles) override;
+
+    // Where the next runs are recorded: a database file, or memory if the path is empty
+    void recordTo(const std::string& path) {
+        databasePath = path;
+    }
+    // Map a database written by an earlier run
+    bool load(const std::string& path);
+    bool isMapped() const {
+        return file.isOpen();
+    }
+
+    // Replace the contents with per-name state vectors, e.g. one lane of a pattern-parallel run
+    void assign(const std::unordered_map<std::string, std::vector<WIRE_STATE>>& states);
+    void clear();
+
+    bool empty() const {
+        return entries.empty();
+    }
+    // Number of names. Several names can share a signal if a wire was renamed.
+    size_t size() const {
+        return entries.size();
+    }
+    size_t cycles() const {
+        return cycleCount;
+    }
+    // Names are kept sorted
+    const std::string& name(size_t entry) const {
+        return entries[entry].name;
+    }
+    // Entry index of a name, or SIZE_MAX
+    size_t find(const std::string& name) const;
+
+    WIRE_STATE at(size_t entry, size_t cycle) const;
+    // Every state an entry takes in [first, last), as a mask of 1 << state. Whole blocks are answered from
+    // their header and whole groups from their mask, so summarizing a long span stays cheap.
+    uint8_t statesIn(size_t entry, size_t first, size_t last) const;
+
+    // Edge searches. An edge at cycle c means the state at c differs from the state at c - 1.
+    enum class EDGE { ANY, RISING, FALLING };
+    // First edge after the given cycle, or SIZE_MAX
+    size_t nextEdge(size_t entry, size_t after, EDGE edge = EDGE::ANY) const;
+    // Last edge before the given cycle, or SIZE_MAX
+    size_t previousEdge(size_t entry, size_t before, EDGE edge = EDGE::ANY) const;
+    // Number of edges at cycles first < c < last
+    size_t countChanges(size_t entry, size_t first, size_t last) const;
+    // Period and high time of a clock-like signal, from the first rising edge after the given cycle.
+    // False if there are not two rising edges.
+    bool measurePeriod(size_t entry, size_t after, size_t& period, size_t& high) const;
+
+    // Entries of a bus, bit 0 first: name[0], name[1], ... Empty if there is no name[0].
+    std::vector<size_t> busEntries(const std::string& bus) const;
+    // First cycle at or after `from` where the bits read `value` (bit 0 first, no undefined bits), or SIZE_MAX
+    size_t findValue(const std::vector<size_t>& bits, uint64_t value, size_t from) const;
+
+    // Changes on every clear(), begin(), load() and assign(), so views can tell when their cached geometry is stale
+    uint64_t generation() const {
+        return generationCount;
+    }
+
+    // Walks the state changes of one entry: first the state at the starting cycle, then every cycle where it changes.
+    class Transitions {
+    public:
+        bool next(size_t& cycle, WIRE_STATE& state);
+
+    private:
+        friend class WaveformStore;
+        Transitions(const WaveformStore& store, uint32_t signal, size_t fromCycle);
+        void decodeBlock();
+
+        const WaveformStore& store;
+        uint32_t signal;
+        size_t block = 0;
+        std::vector<std::pair<uint16_t, uint8_t>> pending; // changes of the current block, offset and state
+        size_t position = 0;
+        int last = -1;
+    };
+    Transitions transitions(size_t entry, size_t fromCycle = 0) const {
+        return Transitions(*this, entries[entry].signal, fromCycle);
+    }
+
+    // Heap memory used by the store. A mapped database only counts its names.
+    size_t memoryBytes() const;
+
+private:
+    enum class ENCODING : uint8_t { CHANGES, PERIODIC, DENSE };
+    struct Block {
+        // CHANGES/DENSE: offset of the block's bytes from the data base. PERIODIC: first change | period << 8 | other state << 16.
+        uint32_t data;
+        uint16_t count; // CHANGES/PERIODIC: number of changes in the block. DENSE: mask of the states in it.
+        ENCODING encoding;
+        uint8_t initial; // state at the first cycle of the block
+    };
+    struct Signal {
+        std::vector<Block> blocks;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> groups;        // mask of the states in every GROUP_BLOCKS blocks
+        std::vector<uint32_t> groupChanges; // edges inside every group, not counting its first cycle
+    };
+    struct Entry {
+        std::string name;
+        uint32_t signal;
+    };
+
+    // Database file: header, then one slice per BLOCK_CYCLES cycles holding the block of every signal
+    // (headers first, then their bytes, offsets relative to the slice), then a footer with the offset of
+    // every slice, the group change counts and masks of every signal and the names. Native byte order.
+    struct DatabaseHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t signalCount;
+        uint64_t cycleCount;
+        uint64_t sliceCount;
+        uint64_t groupCount;
+        uint64_t footerOffset;
+        uint32_t entryCount;
+        uint32_t reserved;
+    };
+
+    static Block encodeBlock(const uint8_t* states, size_t count, std::vector<uint8_t>& data, uint8_t& mask, uint32_t& changes);
+    // State stored in the bytes of a block. Those are only read when looked at, so a corrupt one reads as undefined.
+    static uint8_t storedState(uint8_t state) {
+        return state > 2 ? 2 : state;
+    }
+    // Whether a block of `count` cycles read from a database stays inside the dataSize bytes of its slice
+    static bool validBlock(const Block& block, size_t count, uint64_t dataSize);
+    static uint8_t blockState(const Block& block, const uint8_t* data, uint32_t offset);
+    static uint8_t blockStates(const Block& block, const uint8_t* data, uint32_t from, uint32_t to);
+    // Offset and state of every change in a block of `count` cycles, starting with (0, initial state)
+    static void decodeChanges(const Block& block, const uint8_t* data, size_t count, std::vector<std::pair<uint16_t, uint8_t>>& changes);
+
+    size_t blockCount(uint32_t signal) const;
+    // Header of one block, and the base its data offset is relative to
+    const Block& blockAt(uint32_t signal, size_t index, const uint8_t*& data) const;
+    uint8_t groupStates(uint32_t signal, size_t group) const;
+    uint32_t groupEdges(uint32_t signal, size_t group) const;
+    uint8_t stateAt(uint32_t signal, size_t cycle) const;
+    size_t blockLength(size_t block) const;
+    // First cycle > after where the state goes from one in fromMask to a different one in toMask
+    size_t nextChange(uint32_t signal, size_t after, uint8_t fromMask, uint8_t toMask) const;
+
+    void flushPending();
+    void finishDatabase();
+
+    std::vector<Entry> entries;
+    std::vector<Signal> signals;
+    size_t cycleCount = 0;
+    uint64_t generationCount = 0;
+
+    // Mapped database
+    MappedFile file;
+    uint32_t signalCount = 0;
+    size_t sliceCount = 0;
+    size_t groupCount = 0;
+    const uint64_t* sliceOffsets = nullptr;
+    const uint8_t* groupMasks = nullptr;          // [signal][group]
+    const uint32_t* groupChangeCounts = nullptr;  // [signal][group]
+
+    // Recording: wire handle of every signal and the packed snapshots of the current block
+    std::vector<uint32_t> signalWires;
+    std::vector<uint64_t> pending;
+    size_t pendingCycles = 0;
+    size_t snapshotWords = 0;
+
+    // Recording to a database: the file, the slice being built and what the footer needs
+    std::string databasePath;
+    std::FILE* output = nullptr;
+    uint64_t outputOffset = 0;
+    std::vector<uint8_t> slice;
+    std::vector<uint64_t> writtenSlices;
+    std::vector<uint8_t> writtenGroups;         // [group][signal] while recording
+    std::vector<uint32_t> writtenGroupChanges;  // [group][signal] while recording
+    std::vector<uint8_t> lastStates;            // state at the end of the last block of every signal
+};
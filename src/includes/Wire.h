@@ -1,34 +1,210 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <stdexcept>
-enum class WIRE_STATE {
+#include "Scheduler.h"
+
+class Tokenizer;
+
+enum class WIRE_STATE : uint8_t {
     LOGIC_LOW,
     LOGIC_HIGH,
     LOGIC_UNDEFINED,
 };
 
+// State of every wire, packed 2 bits per wire (32 wires per word) using the WIRE_STATE values as the code.
+// A wire is only ever written by one node at a time, but its neighbours in the same word may be written by
+// other threads while the scheduler evaluates a level in parallel. Writes flip just the wire's own bits with
+// an atomic xor in that mode, and reads are relaxed atomic loads (plain loads on x86).
+class WireStates {
+public:
+    static constexpr uint32_t WIRES_PER_WORD = 32;
+
+    size_t size() const {
+        return count;
+    }
+    void clear() {
+        words.clear();
+        count = 0;
+    }
+    uint32_t push_back(WIRE_STATE state) {
+        if (count % WIRES_PER_WORD == 0) words.push_back(0);
+        uint32_t wire = static_cast<uint32_t>(count++);
+        words.back() |= static_cast<uint64_t>(state) << shift(wire);
+        return wire;
+    }
+
+    WIRE_STATE operator[](uint32_t wire) const {
+        return get(wire);
+    }
+    WIRE_STATE get(uint32_t wire) const {
+        uint64_t word = __atomic_load_n(&words[wire / WIRES_PER_WORD], __ATOMIC_RELAXED);
+        return static_cast<WIRE_STATE>((word >> shift(wire)) & 3);
+    }
+
+    // Returns true if the state changed
+    bool set(uint32_t wire, WIRE_STATE state) {
+        uint64_t& word = words[wire / WIRES_PER_WORD];
+        uint64_t old = (__atomic_load_n(&word, __ATOMIC_RELAXED) >> shift(wire)) & 3;
+        uint64_t flip = (old ^ static_cast<uint64_t>(state)) << shift(wire);
+        if (!flip) return false;
+        if (concurrent) __atomic_fetch_xor(&word, flip, __ATOMIC_RELAXED);
+        else word ^= flip;
+        return true;
+    }
+
+    // Up to 64 consecutive wires as one number: bit i is set if wire first + i is high.
+    // Reads whole words instead of one wire at a time.
+    uint64_t highBits(uint32_t first, uint32_t count) const {
+        uint64_t value, unknown;
+        bits(first, count, value, unknown);
+        return value;
+    }
+
+    // Up to 64 consecutive wires as two bit-planes: bit i of value is set if wire first + i is high, bit i of
+    // unknown if it is undefined. Each state word gives 32 wires with a few shifts and masks.
+    void bits(uint32_t first, uint32_t count, uint64_t& value, uint64_t& unknown) const {
+        value = unknown = 0;
+        for (uint32_t done = 0; done < count;) {
+            const uint32_t wire = first + done;
+            const uint32_t take = std::min(WIRES_PER_WORD - wire % WIRES_PER_WORD, count - done);
+            const uint64_t word = __atomic_load_n(&words[wire / WIRES_PER_WORD], __ATOMIC_RELAXED) >> shift(wire);
+            const uint64_t mask = take < WIRES_PER_WORD ? (uint64_t(1) << take) - 1 : 0xFFFFFFFFull;
+            // High is code 01, undefined is code 10
+            value |= (compress(word & ~(word >> 1) & EVEN_BITS) & mask) << done;
+            unknown |= (compress(word >> 1 & EVEN_BITS) & mask) << done;
+            done += take;
+        }
+    }
+
+    // Writes up to 64 consecutive wires from bit-planes, undefined where unknown is set. Returns a mask of the
+    // wires that changed (bit i for wire first + i), so the caller can wake their readers.
+    uint64_t setBits(uint32_t first, uint32_t count, uint64_t value, uint64_t unknown) {
+        uint64_t changed = 0;
+        for (uint32_t done = 0; done < count;) {
+            const uint32_t wire = first + done;
+            const uint32_t take = std::min(WIRES_PER_WORD - wire % WIRES_PER_WORD, count - done);
+            const uint64_t mask = take < WIRES_PER_WORD ? (uint64_t(1) << take) - 1 : 0xFFFFFFFFull;
+            const uint64_t undefined = unknown >> done & mask;
+            const uint64_t codes = (spread(value >> done & mask & ~undefined) | spread(undefined) << 1) << shift(wire);
+            uint64_t& word = words[wire / WIRES_PER_WORD];
+            const uint64_t flip = (__atomic_load_n(&word, __ATOMIC_RELAXED) ^ codes) & (spread(mask) * 3) << shift(wire);
+            if (flip) {
+                if (concurrent) __atomic_fetch_xor(&word, flip, __ATOMIC_RELAXED);
+                else word ^= flip;
+                changed |= compress((flip | flip >> 1) & EVEN_BITS) >> wire % WIRES_PER_WORD << done;
+            }
+            done += take;
+        }
+        return changed;
+    }
+
+    // Raw packed words, e.g. for snapshotting every wire at once
+    const std::vector<uint64_t>& packed() const {
+        return words;
+    }
+    // Replaces every state with words laid out like packed(), holding wireCount wires
+    void assign(const uint64_t* packedWords, size_t wireCount) {
+        words.assign(packedWords, packedWords + (wireCount + WIRES_PER_WORD - 1) / WIRES_PER_WORD);
+        count = wireCount;
+    }
+    static WIRE_STATE unpack(const uint64_t* words, uint32_t wire) {
+        return static_cast<WIRE_STATE>((words[wire / WIRES_PER_WORD] >> shift(wire)) & 3);
+    }
+
+    // Set by the scheduler while worker threads are writing
+    bool concurrent = false;
+
+private:
+    static uint32_t shift(uint32_t wire) {
+        return (wire % WIRES_PER_WORD) * 2;
+    }
+
+    static constexpr uint64_t EVEN_BITS = 0x5555555555555555ull;
+    // Bits 0, 2, 4 ... 62 moved to bits 0 ... 31, and back
+    static uint64_t compress(uint64_t bits) {
+        bits = (bits | bits >> 1) & 0x3333333333333333ull;
+        bits = (bits | bits >> 2) & 0x0F0F0F0F0F0F0F0Full;
+        bits = (bits | bits >> 4) & 0x00FF00FF00FF00FFull;
+        bits = (bits | bits >> 8) & 0x0000FFFF0000FFFFull;
+        return (bits | bits >> 16) & 0x00000000FFFFFFFFull;
+    }
+    static uint64_t spread(uint64_t bits) {
+        bits &= 0x00000000FFFFFFFFull;
+        bits = (bits | bits << 16) & 0x0000FFFF0000FFFFull;
+        bits = (bits | bits << 8) & 0x00FF00FF00FF00FFull;
+        bits = (bits | bits << 4) & 0x0F0F0F0F0F0F0F0Full;
+        bits = (bits | bits << 2) & 0x3333333333333333ull;
+        return (bits | bits << 1) & EVEN_BITS;
+    }
+
+    std::vector<uint64_t> words;
+    size_t count = 0;
+};
+
+// When a clock wire is high, in cycles: high for `high` cycles out of every `period`, rising on the cycles
+// equal to `phase` modulo the period. The default is the clock of a plain `wire <name> clk`, low on even
+// cycles and high on odd ones.
+struct ClockTiming {
+    uint32_t period = 2;
+    uint32_t phase = 1;
+    uint32_t high = 1;
+
+    // Reads the words after clk in "wire <name> clk [<period>|<clock>/<divider>] [<phase>|-] [<high>|-]", from word
+    // `first` on. findClock looks up the clock named before a divider. Mistakes are reported through words.
+    static bool parse(const Tokenizer& words, size_t first, const std::function<const ClockTiming*(std::string_view)>& findClock,
+                      ClockTiming& timing);
+
+    WIRE_STATE at(size_t cycle) const {
+        return (cycle + period - phase) % period < high ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW;
+    }
+    // First cycle after `cycle` where the level changes
+    size_t nextEdge(size_t cycle) const {
+        const size_t offset = (cycle + period - phase) % period;
+        return cycle + (offset < high ? high - offset : period - offset);
+    }
+};
+
 class Wire {
-    
+
     private:
-        WIRE_STATE state;
+        // Handle of the wire: its index into Wire::states. Wires of a bus get consecutive indices.
+        uint32_t index;
         std::string name;
         bool isClock = false;
     public:
         static std::unordered_map<std::string, Wire*> wireMap;
-        Wire(std::string name, WIRE_STATE init_state = WIRE_STATE::LOGIC_UNDEFINED) : state(init_state), name(name) {
-            std::cout << "Creating Wire: " << name << " with initial state: " << static_cast<int>(state) << std::endl;
+        // The states of every wire, stored contiguously so the compiled netlist can evaluate without touching Wire objects.
+        static WireStates states;
+        // Handle -> Wire. Names are only needed at elaboration and for the waveform.
+        static std::vector<Wire*> wires;
+        // Handles of the clock wires, in declaration order, and their timing
+        static std::vector<uint32_t> clocks;
+        static std::vector<ClockTiming> clockTimings;
+        Wire(std::string name, WIRE_STATE init_state = WIRE_STATE::LOGIC_UNDEFINED) : name(name) {
+            std::cout << "Creating Wire: " << name << " with initial state: " << static_cast<int>(init_state) << std::endl;
             if(name.empty()) {
                 std::cout << "Wire name cannot be empty" << std::endl;
                 throw std::invalid_argument("Wire name cannot be empty");
             }
+            index = states.push_back(init_state);
+            wires.push_back(this);
             wireMap[name] = this;
         }
 
+        uint32_t getIndex() const {
+            return index;
+        }
+
         WIRE_STATE getState() const {
-            return state;
+            return states[index];
         }
 
         std::string getName() const {
@@ -40,36 +216,49 @@ class Wire {
         }
 
         void setState(WIRE_STATE state) {
-            this->state = state;
+            drive(index, state);
+        }
+
+        // Handle based versions of setState() and toggle() for the simulation loop
+        static void drive(uint32_t wire, WIRE_STATE state) {
+            if (states.set(wire, state))
+                Scheduler::wireChanged(wire);
+        }
+        static void toggle(uint32_t wire) {
+            // Wire shouldn't be undefined as a clock. Default to low
+            drive(wire, states[wire] == WIRE_STATE::LOGIC_LOW ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW);
         }
 
         bool isLogicHigh() const {
-            return state == WIRE_STATE::LOGIC_HIGH;
+            return getState() == WIRE_STATE::LOGIC_HIGH;
         }
 
         bool isLogicLow() const {
-            return state == WIRE_STATE::LOGIC_LOW;
+            return getState() == WIRE_STATE::LOGIC_LOW;
         }
 
         bool isLogicUndefined() const {
-            return state == WIRE_STATE::LOGIC_UNDEFINED;
+            return getState() == WIRE_STATE::LOGIC_UNDEFINED;
         }
 
-        void setClock(bool clock) {
-            isClock = clock;
+        void setClock(const ClockTiming& timing = {}) {
+            if (isClock) return;
+            clocks.push_back(index);
+            clockTimings.push_back(timing);
+            isClock = true;
+        }
+        // Timing of a clock wire, nullptr for any other wire
+        const ClockTiming* getClockTiming() const {
+            if (!isClock) return nullptr;
+            const auto found = std::find(clocks.begin(), clocks.end(), index);
+            return &clockTimings[found - clocks.begin()];
         }
         bool isClockWire() {
             return isClock;
         }
 
-        // Toggle the state of the wire. Primarily used for toggling the clock wires.
+        // Toggle the state of the wire: low goes high, anything else goes low
         void toggle() {
-            if(state == WIRE_STATE::LOGIC_UNDEFINED)
-                // Wire shouldn't be undefined as a clock. Default to low
-                state = WIRE_STATE::LOGIC_LOW;
-            else if (state == WIRE_STATE::LOGIC_HIGH)
-                state = WIRE_STATE::LOGIC_LOW;
-            else if (state == WIRE_STATE::LOGIC_LOW)
-                state = WIRE_STATE::LOGIC_HIGH;
-        }
-};
\ No newline at end of file
+            toggle(index);
+        }
+};
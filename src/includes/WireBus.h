@@ -1,6 +1,8 @@
 #pragma once
 #include "Wire.h"
+#include "Arena.h"
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -17,7 +19,7 @@ public:
     WireBus(std::string name, int size, WIRE_STATE initialState = WIRE_STATE::LOGIC_UNDEFINED) : name(name), size(size) {
         for(size_t i = 0; i < size; ++i) {
             std::string wireName = name + "[" + std::to_string(i) + "]";
-            wires.push_back(new Wire(wireName, initialState));
+            wires.push_back(Arena::circuit.create<Wire>(wireName, initialState));
         }
         wireBusMap[name] = wires;
         std::cout << "Creating Wire Bus: " << name << " (" << size-1 << " down to " << "0)" << " with initial state: " << static_cast<int>(initialState) << std::endl;
@@ -30,4 +32,16 @@ public:
     const std::vector<Wire*>& getWires() const {
         return wires;
     }
+
+    // True if the wires of bus have consecutive handles, as every bus declared in a design has
+    static bool consecutive(const std::vector<Wire*>& bus);
+    // The bus read as a number, wire 0 first. Consecutive buses of up to 64 wires are read a state word at a time.
+    // A high wire above the 64th gives UINT64_MAX. defined is cleared if any wire is undefined (those read as 0).
+    static uint64_t value(const std::vector<Wire*>& bus, bool consecutive, bool& defined);
+
+    // Wires [first, first + 64) of a bus, or up to its end, as bit-planes: bit i of value is set if wire first + i
+    // is high, bit i of unknown if it is undefined. Consecutive buses go through WireStates::bits().
+    static void read(const std::vector<Wire*>& bus, bool consecutive, size_t first, uint64_t& value, uint64_t& unknown);
+    // Drives wires [first, first + 64) of a bus from bit-planes and wakes the readers of the ones that changed
+    static void drive(const std::vector<Wire*>& bus, bool consecutive, size_t first, uint64_t value, uint64_t unknown);
 };
\ No newline at end of file
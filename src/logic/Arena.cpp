@@ -0,0 +1,46 @@
+#include "../includes/Arena.h"
+#include <algorithm>
+
+Arena Arena::circuit;
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+        size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + size <= block.size) {
+            offset = aligned + size;
+            return block.memory.get() + aligned;
+        }
+        // Doesn't fit, move on to the next kept block or allocate a new one
+        ++current;
+        offset = 0;
+    }
+    // Oversized objects get a block of their own
+    size_t blockSize = std::max(BLOCK_SIZE, size + alignment);
+    blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[blockSize]), blockSize});
+    current = blocks.size() - 1;
+    offset = 0;
+    return allocate(size, alignment);
+}
+
+void Arena::release() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    destructors.clear();
+    current = 0;
+    offset = 0;
+}
+
+size_t Arena::used() const {
+    size_t total = offset;
+    for (size_t i = 0; i < current && i < blocks.size(); ++i) total += blocks[i].size;
+    return total;
+}
+
+size_t Arena::reserved() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
@@ -0,0 +1,100 @@
+#include "../includes/Arithmetic.h"
+#include "../includes/Tokenizer.h"
+#include <iostream>
+
+std::vector<Arithmetic*> Arithmetic::units;
+
+bool Arithmetic::parseType(std::string_view word, ARITHMETIC_OP& op) {
+    static const struct { const char* keyword; ARITHMETIC_OP op; } keywords[] = {
+        {"add", ARITHMETIC_OP::ADD}, {"sub", ARITHMETIC_OP::SUB}, {"cmp", ARITHMETIC_OP::CMP},
+        {"shl", ARITHMETIC_OP::SHL}, {"shr", ARITHMETIC_OP::SHR}};
+    for (const auto& keyword : keywords) {
+        if (Tokenizer::equalsLower(word, keyword.keyword)) {
+            op = keyword.op;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t Arithmetic::flagCount(ARITHMETIC_OP op) {
+    switch (op) {
+        case ARITHMETIC_OP::ADD:
+        case ARITHMETIC_OP::SUB: return 1;
+        case ARITHMETIC_OP::CMP: return 3;
+        default:                 return 0;
+    }
+}
+
+std::string Arithmetic::shapeError(ARITHMETIC_OP op, size_t widthA, size_t widthB, size_t resultWidth) {
+    if (widthA == 0 || widthB == 0 || (op != ARITHMETIC_OP::CMP && resultWidth == 0)) return "missing bus";
+    if (widthA > 64 || widthB > 64) return "arithmetic buses can be at most 64 wires wide";
+    const bool shift = op == ARITHMETIC_OP::SHL || op == ARITHMETIC_OP::SHR;
+    if (!shift && widthA != widthB) return "A and B differ in width";
+    if (op != ARITHMETIC_OP::CMP && resultWidth != widthA) return "the result has to be as wide as A";
+    return "";
+}
+
+Arithmetic::Arithmetic(ARITHMETIC_OP op, std::string name, const std::vector<Wire*>& busA, const std::vector<Wire*>& busB, Wire* carryIn,
+                       const std::vector<Wire*>& result, const std::vector<Wire*>& flags)
+    : op(op), name(name), busA(busA), busB(busB), carryIn(carryIn), result(result), flags(flags) {
+    std::cout << "Creating Arithmetic Unit: " << name << " with " << busA.size() << " wide operands" << std::endl;
+    const std::string problem = shapeError(op, busA.size(), busB.size(), result.size());
+    if (!problem.empty()) throw std::invalid_argument(problem);
+    this->flags.resize(flagCount(op), nullptr);
+    consecutiveA = WireBus::consecutive(busA);
+    consecutiveB = WireBus::consecutive(busB);
+    consecutiveResult = WireBus::consecutive(result);
+    units.push_back(this);
+}
+
+void Arithmetic::tick() {
+    uint64_t a, aUnknown, b, bUnknown;
+    WireBus::read(busA, consecutiveA, 0, a, aUnknown);
+    WireBus::read(busB, consecutiveB, 0, b, bUnknown);
+    const size_t width = busA.size();
+    const uint64_t mask = width < 64 ? (uint64_t(1) << width) - 1 : UINT64_MAX;
+    bool flagValues[3] = {false, false, false};
+
+    if (op == ARITHMETIC_OP::SHL || op == ARITHMETIC_OP::SHR) {
+        if (bUnknown) return drive(0, UINT64_MAX, flagValues, false);
+        // Undefined bits of A travel with the shift
+        uint64_t value = 0, unknown = 0;
+        if (b < width) {
+            value = op == ARITHMETIC_OP::SHL ? a << b : a >> b;
+            unknown = op == ARITHMETIC_OP::SHL ? aUnknown << b : aUnknown >> b;
+        }
+        return drive(value & mask, unknown & mask, flagValues, true);
+    }
+
+    const WIRE_STATE carryState = carryIn ? carryIn->getState() : WIRE_STATE::LOGIC_LOW;
+    if (aUnknown || bUnknown || carryState == WIRE_STATE::LOGIC_UNDEFINED) return drive(0, UINT64_MAX, flagValues, false);
+    const uint64_t carry = carryState == WIRE_STATE::LOGIC_HIGH;
+    uint64_t value = 0;
+    switch (op) {
+        case ARITHMETIC_OP::ADD: {
+            const uint64_t partial = a + b;
+            value = partial + carry;
+            flagValues[0] = width < 64 ? (value >> width) & 1 : partial < a || value < partial;
+            break;
+        }
+        case ARITHMETIC_OP::SUB:
+            value = a - b - carry;
+            flagValues[0] = a < b || a - b < carry;
+            break;
+        default:
+            flagValues[0] = a == b;
+            flagValues[1] = a < b;
+            flagValues[2] = a > b;
+            break;
+    }
+    drive(value & mask, 0, flagValues, true);
+}
+
+void Arithmetic::drive(uint64_t value, uint64_t unknown, const bool* flagValues, bool defined) {
+    if (!result.empty()) WireBus::drive(result, consecutiveResult, 0, value, unknown);
+    for (size_t i = 0; i < flags.size(); ++i) {
+        if (!flags[i]) continue;
+        flags[i]->setState(!defined ? WIRE_STATE::LOGIC_UNDEFINED : flagValues[i] ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW);
+    }
+}
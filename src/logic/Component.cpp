@@ -1,8 +1,36 @@
 #include "../includes/Component.h"
+#include "../includes/Arena.h"
+#include "../includes/Tokenizer.h"
 
 uint32_t Component::next_uid = 0;
 std::vector<Component*> Component::components;
 
+bool Component::parseType(std::string_view word, COMPONENT& type) {
+    static const struct { const char* keyword; COMPONENT type; } keywords[] = {
+        {"and", COMPONENT::AND}, {"or", COMPONENT::OR}, {"not", COMPONENT::NOT}, {"xor", COMPONENT::XOR},
+        {"nand", COMPONENT::NAND}, {"nor", COMPONENT::NOR}, {"xnor", COMPONENT::XNOR}};
+    for (const auto& keyword : keywords) {
+        if (Tokenizer::equalsLower(word, keyword.keyword)) {
+            type = keyword.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+Component* Component::create(COMPONENT type, std::string name) {
+    switch (type) {
+        case COMPONENT::AND:  return Arena::circuit.create<AND_GATE>(std::move(name));
+        case COMPONENT::OR:   return Arena::circuit.create<OR_GATE>(std::move(name));
+        case COMPONENT::NOT:  return Arena::circuit.create<NOT_GATE>(std::move(name));
+        case COMPONENT::XOR:  return Arena::circuit.create<XOR_GATE>(std::move(name));
+        case COMPONENT::NAND: return Arena::circuit.create<NAND_GATE>(std::move(name));
+        case COMPONENT::NOR:  return Arena::circuit.create<NOR_GATE>(std::move(name));
+        case COMPONENT::XNOR: return Arena::circuit.create<XNOR_GATE>(std::move(name));
+    }
+    return nullptr;
+}
+
 void Component::evaluateComponent() {}
 
 void Component::evaluateSystem() {
@@ -1,4 +1,109 @@
 #include "../includes/FlipFlop.h"
+#include "../includes/Arena.h"
+#include "../includes/Netlist.h"
+#include "../includes/Tokenizer.h"
+#include <unordered_map>
 
-void FlipFlop::tick(){}
-std::vector<FlipFlop*> FlipFlop::flipFlops;
\ No newline at end of file
+std::vector<FlipFlop*> FlipFlop::flipFlops;
+std::vector<ClockDomain*> ClockDomain::domains;
+
+FlipFlop::FlipFlop(std::string name, FLIP_FLOP_TYPE type, std::vector<Wire*> inputs, Wire* output, Wire* clock, EDGE_TYPE edgeType)
+    : type(type), inputs(inputs), output(output), clock(clock), name(name), edgeType(edgeType) {
+    static const char* const typeNames[] = {"D", "SR", "JK", "T"};
+    static const char* const inputNames[][2] = {{"D", ""}, {"S", "R"}, {"J", "K"}, {"T", ""}};
+    auto wireName = [](const Wire* wire) { return wire ? wire->getName() : std::string("-"); };
+    const size_t kind = static_cast<size_t>(type);
+    std::cout << "Creating " << typeNames[kind] << " Flip-Flop: " << name;
+    for (size_t i = 0; i < inputs.size(); ++i) std::cout << " " << inputNames[kind][i] << ": " << wireName(inputs[i]);
+    std::cout << " Q: " << wireName(output) << " Clock: " << wireName(clock) << std::endl;
+    flipFlops.push_back(this);
+}
+
+bool FlipFlop::parseType(std::string_view word, FLIP_FLOP_TYPE& type) {
+    static const struct { const char* keyword; FLIP_FLOP_TYPE type; } keywords[] = {
+        {"dff", FLIP_FLOP_TYPE::D_FLIP_FLOP}, {"srff", FLIP_FLOP_TYPE::SR_FLIP_FLOP},
+        {"jkff", FLIP_FLOP_TYPE::JK_FLIP_FLOP}, {"tff", FLIP_FLOP_TYPE::T_FLIP_FLOP}};
+    for (const auto& keyword : keywords) {
+        if (Tokenizer::equalsLower(word, keyword.keyword)) {
+            type = keyword.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t FlipFlop::inputCount(FLIP_FLOP_TYPE type) {
+    return type == FLIP_FLOP_TYPE::SR_FLIP_FLOP || type == FLIP_FLOP_TYPE::JK_FLIP_FLOP ? 2 : 1;
+}
+
+FlipFlop* FlipFlop::create(FLIP_FLOP_TYPE type, std::string name, Wire* clock, Wire* inputA, Wire* inputB, Wire* output, EDGE_TYPE edgeType) {
+    std::vector<Wire*> inputs{inputA};
+    if (inputCount(type) == 2) inputs.push_back(inputB);
+    return Arena::circuit.create<FlipFlop>(std::move(name), type, std::move(inputs), output, clock, edgeType);
+}
+
+void ClockDomain::build() {
+    domains.clear();
+    // Clock wire and edge -> domain
+    std::unordered_map<uint64_t, ClockDomain*> byClock;
+    for (const FlipFlop* flipFlop : FlipFlop::flipFlops) {
+        if (!flipFlop->getClock() || !flipFlop->getOutput()) continue;
+        const uint64_t key = uint64_t(flipFlop->getClock()->getIndex()) << 1 | (flipFlop->getEdgeType() == EDGE_TYPE::FALLING_EDGE);
+        ClockDomain*& domain = byClock[key];
+        if (!domain) {
+            domain = Arena::circuit.create<ClockDomain>(flipFlop->getClock(), flipFlop->getEdgeType());
+            domains.push_back(domain);
+        }
+        domain->add(flipFlop);
+    }
+}
+
+void ClockDomain::add(const FlipFlop* flipFlop) {
+    const std::vector<Wire*> inputs = flipFlop->getInputs();
+    types.push_back(flipFlop->getType());
+    const uint32_t floating = Netlist::current.floatingWire;
+    inputA.push_back(inputs.size() > 0 && inputs[0] ? inputs[0]->getIndex() : floating);
+    inputB.push_back(inputs.size() > 1 && inputs[1] ? inputs[1]->getIndex() : floating);
+    outputs.push_back(flipFlop->getOutput()->getIndex());
+}
+
+void ClockDomain::evaluate() {
+    const WIRE_STATE current = clock->getState();
+    const bool edge = edgeType == EDGE_TYPE::RISING_EDGE
+        ? previousClock == WIRE_STATE::LOGIC_LOW && current == WIRE_STATE::LOGIC_HIGH
+        : previousClock == WIRE_STATE::LOGIC_HIGH && current == WIRE_STATE::LOGIC_LOW;
+    previousClock = current;
+    if (!edge) return;
+
+    const WireStates& states = Wire::states;
+    constexpr WIRE_STATE HIGH = WIRE_STATE::LOGIC_HIGH, LOW = WIRE_STATE::LOGIC_LOW;
+    for (size_t i = 0; i < types.size(); ++i) {
+        const WIRE_STATE a = states.get(inputA[i]);
+        switch (types[i]) {
+            case FLIP_FLOP_TYPE::D_FLIP_FLOP:
+                pending.emplace_back(outputs[i], a);
+                break;
+            case FLIP_FLOP_TYPE::SR_FLIP_FLOP: {
+                const WIRE_STATE b = states.get(inputB[i]);
+                if (a == HIGH && b == LOW) pending.emplace_back(outputs[i], HIGH);
+                else if (a == LOW && b == HIGH) pending.emplace_back(outputs[i], LOW);
+                break;
+            }
+            case FLIP_FLOP_TYPE::JK_FLIP_FLOP: {
+                const WIRE_STATE b = states.get(inputB[i]);
+                if (a == LOW && b == HIGH) pending.emplace_back(outputs[i], LOW);
+                else if (a == HIGH && b == LOW) pending.emplace_back(outputs[i], HIGH);
+                else if (a == HIGH && b == HIGH) pending.emplace_back(outputs[i], states.get(outputs[i]) == HIGH ? LOW : HIGH);
+                break;
+            }
+            case FLIP_FLOP_TYPE::T_FLIP_FLOP:
+                if (a == HIGH) pending.emplace_back(outputs[i], states.get(outputs[i]) == HIGH ? LOW : HIGH);
+                break;
+        }
+    }
+}
+
+void ClockDomain::commit() {
+    for (const auto& [output, state] : pending) Wire::drive(output, state);
+    pending.clear();
+}
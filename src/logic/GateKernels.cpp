@@ -0,0 +1,244 @@
+#include "../includes/GateKernels.h"
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GATE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace GateKernels {
+
+// Calls run(std::integral_constant<NODE_OP, op>) so each gate type gets its own instantiated inner loop
+// and the switch happens once per batch instead of once per gate.
+template <typename Runner>
+static bool dispatch(NODE_OP op, Runner&& run) {
+    switch (op) {
+        case NODE_OP::AND:  return run(std::integral_constant<NODE_OP, NODE_OP::AND>{});
+        case NODE_OP::OR:   return run(std::integral_constant<NODE_OP, NODE_OP::OR>{});
+        case NODE_OP::NOT:  return run(std::integral_constant<NODE_OP, NODE_OP::NOT>{});
+        case NODE_OP::XOR:  return run(std::integral_constant<NODE_OP, NODE_OP::XOR>{});
+        case NODE_OP::NAND: return run(std::integral_constant<NODE_OP, NODE_OP::NAND>{});
+        case NODE_OP::NOR:  return run(std::integral_constant<NODE_OP, NODE_OP::NOR>{});
+        case NODE_OP::XNOR: return run(std::integral_constant<NODE_OP, NODE_OP::XNOR>{});
+        default: return false;
+    }
+}
+
+// Lanes where the output is high and where it is low, from the lanes where each input is high and low.
+// Lanes in neither are undefined.
+template <NODE_OP OP>
+static inline void gate(uint64_t aHigh, uint64_t aLow, uint64_t bHigh, uint64_t bLow, uint64_t& high, uint64_t& low) {
+    switch (OP) {
+        case NODE_OP::AND:  high = aHigh & bHigh; low = aLow | bLow; break;
+        case NODE_OP::OR:   high = aHigh | bHigh; low = aLow & bLow; break;
+        case NODE_OP::NOT:  high = aLow; low = aHigh; break;
+        case NODE_OP::XOR:  high = (aHigh & bLow) | (aLow & bHigh); low = (aHigh & bHigh) | (aLow & bLow); break;
+        case NODE_OP::NAND: high = aLow | bLow; low = aHigh & bHigh; break;
+        case NODE_OP::NOR:  high = aLow & bLow; low = aHigh | bHigh; break;
+        default:            high = (aHigh & bHigh) | (aLow & bLow); low = (aHigh & bLow) | (aLow & bHigh); break;
+    }
+}
+
+// Words [first, words) of one gate. Shared by every variant for the tail that doesn't fill a register.
+template <NODE_OP OP>
+static inline uint64_t evaluateWords(size_t first, size_t words, const uint64_t* aValue, const uint64_t* aUnknown,
+                                     const uint64_t* bValue, const uint64_t* bUnknown, uint64_t* outValue, uint64_t* outUnknown) {
+    uint64_t changed = 0;
+    for (size_t w = first; w < words; ++w) {
+        uint64_t high, low;
+        gate<OP>(aValue[w] & ~aUnknown[w], ~(aValue[w] | aUnknown[w]), bValue[w] & ~bUnknown[w], ~(bValue[w] | bUnknown[w]), high, low);
+        const uint64_t undefined = ~(high | low);
+        changed |= (high ^ outValue[w]) | (undefined ^ outUnknown[w]);
+        outValue[w] = high;
+        outUnknown[w] = undefined;
+    }
+    return changed;
+}
+
+template <NODE_OP OP>
+static bool runScalar(const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                      uint64_t* value, uint64_t* unknown, size_t words) {
+    uint64_t changed = 0;
+    for (size_t g = 0; g < count; ++g) {
+        const size_t a = inputA[g] * words, b = inputB[g] * words, out = output[g] * words;
+        changed |= evaluateWords<OP>(0, words, value + a, unknown + a, value + b, unknown + b, value + out, unknown + out);
+    }
+    return changed != 0;
+}
+
+bool evaluateScalar(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                    uint64_t* value, uint64_t* unknown, size_t words) {
+    return dispatch(op, [&](auto tag) {
+        return runScalar<decltype(tag)::value>(inputA, inputB, output, count, value, unknown, words);
+    });
+}
+
+#ifdef GATE_KERNELS_X86
+
+template <NODE_OP OP>
+__attribute__((target("sse2"))) static inline void gate128(__m128i aHigh, __m128i aLow, __m128i bHigh, __m128i bLow, __m128i& high, __m128i& low) {
+    switch (OP) {
+        case NODE_OP::AND:  high = _mm_and_si128(aHigh, bHigh); low = _mm_or_si128(aLow, bLow); break;
+        case NODE_OP::OR:   high = _mm_or_si128(aHigh, bHigh); low = _mm_and_si128(aLow, bLow); break;
+        case NODE_OP::NOT:  high = aLow; low = aHigh; break;
+        case NODE_OP::XOR:
+            high = _mm_or_si128(_mm_and_si128(aHigh, bLow), _mm_and_si128(aLow, bHigh));
+            low = _mm_or_si128(_mm_and_si128(aHigh, bHigh), _mm_and_si128(aLow, bLow));
+            break;
+        case NODE_OP::NAND: high = _mm_or_si128(aLow, bLow); low = _mm_and_si128(aHigh, bHigh); break;
+        case NODE_OP::NOR:  high = _mm_and_si128(aLow, bLow); low = _mm_or_si128(aHigh, bHigh); break;
+        default:
+            high = _mm_or_si128(_mm_and_si128(aHigh, bHigh), _mm_and_si128(aLow, bLow));
+            low = _mm_or_si128(_mm_and_si128(aHigh, bLow), _mm_and_si128(aLow, bHigh));
+            break;
+    }
+}
+
+template <NODE_OP OP>
+__attribute__((target("sse2"))) static bool runSSE2(const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                                                    uint64_t* value, uint64_t* unknown, size_t words) {
+    const size_t vectorWords = words & ~size_t(1);
+    const __m128i ones = _mm_set1_epi32(-1);
+    __m128i changed = _mm_setzero_si128();
+    uint64_t tailChanged = 0;
+    for (size_t g = 0; g < count; ++g) {
+        const size_t a = inputA[g] * words, b = inputB[g] * words, out = output[g] * words;
+        for (size_t w = 0; w < vectorWords; w += 2) {
+            __m128i aValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + a + w));
+            __m128i aUnknown = _mm_loadu_si128(reinterpret_cast<const __m128i*>(unknown + a + w));
+            __m128i bValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + b + w));
+            __m128i bUnknown = _mm_loadu_si128(reinterpret_cast<const __m128i*>(unknown + b + w));
+            __m128i oldValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + out + w));
+            __m128i oldUnknown = _mm_loadu_si128(reinterpret_cast<const __m128i*>(unknown + out + w));
+            __m128i high, low;
+            gate128<OP>(_mm_andnot_si128(aUnknown, aValue), _mm_xor_si128(_mm_or_si128(aValue, aUnknown), ones),
+                        _mm_andnot_si128(bUnknown, bValue), _mm_xor_si128(_mm_or_si128(bValue, bUnknown), ones), high, low);
+            const __m128i undefined = _mm_xor_si128(_mm_or_si128(high, low), ones);
+            changed = _mm_or_si128(changed, _mm_or_si128(_mm_xor_si128(high, oldValue), _mm_xor_si128(undefined, oldUnknown)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(value + out + w), high);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(unknown + out + w), undefined);
+        }
+        tailChanged |= evaluateWords<OP>(vectorWords, words, value + a, unknown + a, value + b, unknown + b, value + out, unknown + out);
+    }
+    return tailChanged != 0 || _mm_movemask_epi8(_mm_cmpeq_epi8(changed, _mm_setzero_si128())) != 0xFFFF;
+}
+
+template <NODE_OP OP>
+__attribute__((target("avx2"))) static inline void gate256(__m256i aHigh, __m256i aLow, __m256i bHigh, __m256i bLow, __m256i& high, __m256i& low) {
+    switch (OP) {
+        case NODE_OP::AND:  high = _mm256_and_si256(aHigh, bHigh); low = _mm256_or_si256(aLow, bLow); break;
+        case NODE_OP::OR:   high = _mm256_or_si256(aHigh, bHigh); low = _mm256_and_si256(aLow, bLow); break;
+        case NODE_OP::NOT:  high = aLow; low = aHigh; break;
+        case NODE_OP::XOR:
+            high = _mm256_or_si256(_mm256_and_si256(aHigh, bLow), _mm256_and_si256(aLow, bHigh));
+            low = _mm256_or_si256(_mm256_and_si256(aHigh, bHigh), _mm256_and_si256(aLow, bLow));
+            break;
+        case NODE_OP::NAND: high = _mm256_or_si256(aLow, bLow); low = _mm256_and_si256(aHigh, bHigh); break;
+        case NODE_OP::NOR:  high = _mm256_and_si256(aLow, bLow); low = _mm256_or_si256(aHigh, bHigh); break;
+        default:
+            high = _mm256_or_si256(_mm256_and_si256(aHigh, bHigh), _mm256_and_si256(aLow, bLow));
+            low = _mm256_or_si256(_mm256_and_si256(aHigh, bLow), _mm256_and_si256(aLow, bHigh));
+            break;
+    }
+}
+
+template <NODE_OP OP>
+__attribute__((target("avx2"))) static bool runAVX2(const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                                                    uint64_t* value, uint64_t* unknown, size_t words) {
+    const size_t vectorWords = words & ~size_t(3);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    __m256i changed = _mm256_setzero_si256();
+    uint64_t tailChanged = 0;
+    for (size_t g = 0; g < count; ++g) {
+        const size_t a = inputA[g] * words, b = inputB[g] * words, out = output[g] * words;
+        for (size_t w = 0; w < vectorWords; w += 4) {
+            __m256i aValue = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + a + w));
+            __m256i aUnknown = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(unknown + a + w));
+            __m256i bValue = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + b + w));
+            __m256i bUnknown = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(unknown + b + w));
+            __m256i oldValue = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + out + w));
+            __m256i oldUnknown = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(unknown + out + w));
+            __m256i high, low;
+            gate256<OP>(_mm256_andnot_si256(aUnknown, aValue), _mm256_xor_si256(_mm256_or_si256(aValue, aUnknown), ones),
+                        _mm256_andnot_si256(bUnknown, bValue), _mm256_xor_si256(_mm256_or_si256(bValue, bUnknown), ones), high, low);
+            const __m256i undefined = _mm256_xor_si256(_mm256_or_si256(high, low), ones);
+            changed = _mm256_or_si256(changed, _mm256_or_si256(_mm256_xor_si256(high, oldValue), _mm256_xor_si256(undefined, oldUnknown)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(value + out + w), high);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(unknown + out + w), undefined);
+        }
+        tailChanged |= evaluateWords<OP>(vectorWords, words, value + a, unknown + a, value + b, unknown + b, value + out, unknown + out);
+    }
+    return tailChanged != 0 || !_mm256_testz_si256(changed, changed);
+}
+
+bool evaluateSSE2(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                  uint64_t* value, uint64_t* unknown, size_t words) {
+    return dispatch(op, [&](auto tag) {
+        return runSSE2<decltype(tag)::value>(inputA, inputB, output, count, value, unknown, words);
+    });
+}
+
+bool evaluateAVX2(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                  uint64_t* value, uint64_t* unknown, size_t words) {
+    return dispatch(op, [&](auto tag) {
+        return runAVX2<decltype(tag)::value>(inputA, inputB, output, count, value, unknown, words);
+    });
+}
+
+bool supported(ISA isa) {
+    __builtin_cpu_init();
+    switch (isa) {
+        case ISA::AVX2: return __builtin_cpu_supports("avx2");
+        case ISA::SSE2: return __builtin_cpu_supports("sse2");
+        default:        return true;
+    }
+}
+
+#else
+
+// No x86 SIMD available: the vector entry points are the scalar kernel.
+bool evaluateSSE2(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                  uint64_t* value, uint64_t* unknown, size_t words) {
+    return evaluateScalar(op, inputA, inputB, output, count, value, unknown, words);
+}
+
+bool evaluateAVX2(NODE_OP op, const uint32_t* inputA, const uint32_t* inputB, const uint32_t* output, size_t count,
+                  uint64_t* value, uint64_t* unknown, size_t words) {
+    return evaluateScalar(op, inputA, inputB, output, count, value, unknown, words);
+}
+
+bool supported(ISA isa) {
+    return isa == ISA::SCALAR;
+}
+
+#endif
+
+ISA detect() {
+    static const ISA best = supported(ISA::AVX2) ? ISA::AVX2 : supported(ISA::SSE2) ? ISA::SSE2 : ISA::SCALAR;
+    return best;
+}
+
+const char* name(ISA isa) {
+    switch (isa) {
+        case ISA::AVX2: return "AVX2";
+        case ISA::SSE2: return "SSE2";
+        default:        return "scalar";
+    }
+}
+
+Kernel kernel(ISA isa) {
+    switch (isa) {
+        case ISA::AVX2: return evaluateAVX2;
+        case ISA::SSE2: return evaluateSSE2;
+        default:        return evaluateScalar;
+    }
+}
+
+Kernel select(size_t words) {
+    const ISA best = detect();
+    if (words >= 4 && best == ISA::AVX2) return evaluateAVX2;
+    if (words >= 2 && best != ISA::SCALAR) return evaluateSSE2;
+    return evaluateScalar;
+}
+
+}
@@ -0,0 +1,240 @@
+#include "../includes/MemoryImage.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool endsWith(const std::string& text, const char* suffix) {
+    const size_t length = std::strlen(suffix);
+    if (text.size() < length) return false;
+    for (size_t i = 0; i < length; ++i) {
+        const char c = text[text.size() - length + i];
+        if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != suffix[i]) return false;
+    }
+    return true;
+}
+
+static void error(const std::string& filename, size_t line, const std::string& message) {
+    std::cerr << filename << ':' << line << ": " << message << std::endl;
+}
+
+MemoryImage::FORMAT MemoryImage::formatOf(const std::string& filename, const MappedFile* file) {
+    if (endsWith(filename, ".bin")) return FORMAT::BINARY;
+    if (endsWith(filename, ".hex") || endsWith(filename, ".ihex")) return FORMAT::INTEL_HEX;
+    if (file && file->size() > 0 && file->data()[0] == ':') return FORMAT::INTEL_HEX;
+    return FORMAT::TEXT;
+}
+
+// One word per line, lowest address first. @<address> moves on to another (word) address.
+static bool readText(const std::string& filename, std::string_view text, size_t wordSize, const MemoryImage::Store& store) {
+    std::vector<uint8_t> word(wordSize);
+    uint64_t address = 0;
+    size_t line = 0;
+    for (size_t position = 0; position < text.size();) {
+        size_t end = text.find('\n', position);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view digits = text.substr(position, end - position);
+        position = end + 1;
+        ++line;
+
+        const size_t comment = digits.find("//");
+        if (comment != std::string_view::npos) digits = digits.substr(0, comment);
+        const size_t begin = digits.find_first_not_of(" \t\r");
+        if (begin == std::string_view::npos) continue;
+        digits = digits.substr(begin, digits.find_last_not_of(" \t\r") - begin + 1);
+        const bool jump = digits[0] == '@';
+        if (jump) digits.remove_prefix(1);
+        if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) digits.remove_prefix(2);
+        if (jump) {
+            uint64_t target = 0;
+            for (char c : digits) {
+                const int value = hexDigit(c);
+                if (value < 0 || target >> 60) {
+                    error(filename, line, "invalid address @" + std::string(digits));
+                    return false;
+                }
+                target = target << 4 | static_cast<uint64_t>(value);
+            }
+            address = target * wordSize;
+            continue;
+        }
+
+        // Digits from the right, two per byte. Digits beyond the data width are dropped.
+        std::fill(word.begin(), word.end(), 0);
+        for (size_t digit = 0; digit < digits.size(); ++digit) {
+            const int value = hexDigit(digits[digits.size() - 1 - digit]);
+            if (value < 0) {
+                error(filename, line, "invalid hexadecimal word " + std::string(digits));
+                return false;
+            }
+            if (digit / 2 < wordSize) word[digit / 2] |= static_cast<uint8_t>(value << (digit % 2 * 4));
+        }
+        store(address, word.data(), wordSize);
+        address += wordSize;
+    }
+    return true;
+}
+
+// :LLAAAATT<data>CC records. Data (00), end of file (01), extended segment (02) and linear (04) addresses.
+static bool readIntelHex(const std::string& filename, std::string_view text, const MemoryImage::Store& store) {
+    uint64_t base = 0;
+    size_t line = 0;
+    uint8_t bytes[256 + 5];
+    for (size_t position = 0; position < text.size();) {
+        size_t end = text.find('\n', position);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view record = text.substr(position, end - position);
+        position = end + 1;
+        ++line;
+
+        while (!record.empty() && (record.back() == '\r' || record.back() == ' ')) record.remove_suffix(1);
+        if (record.empty()) continue;
+        if (record[0] != ':' || record.size() < 11 || record.size() % 2 == 0) {
+            error(filename, line, "not an Intel HEX record");
+            return false;
+        }
+        const size_t count = (record.size() - 1) / 2;
+        uint8_t checksum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const int high = hexDigit(record[1 + 2 * i]), low = hexDigit(record[2 + 2 * i]);
+            if (high < 0 || low < 0 || i >= sizeof(bytes)) {
+                error(filename, line, "not an Intel HEX record");
+                return false;
+            }
+            bytes[i] = static_cast<uint8_t>(high << 4 | low);
+            checksum += bytes[i];
+        }
+        const size_t length = bytes[0];
+        // Extended address records carry exactly one 16 bit segment
+        const bool extended = bytes[3] == 0x02 || bytes[3] == 0x04;
+        if (count != length + 5 || (extended && length != 2)) {
+            error(filename, line, "record length does not match");
+            return false;
+        }
+        if (checksum != 0) {
+            error(filename, line, "checksum mismatch");
+            return false;
+        }
+        switch (bytes[3]) {
+            case 0x00:
+                store(base + (static_cast<uint64_t>(bytes[1]) << 8 | bytes[2]), bytes + 4, length);
+                break;
+            case 0x01:
+                return true;
+            case 0x02:
+                base = static_cast<uint64_t>(bytes[4] << 8 | bytes[5]) << 4;
+                break;
+            case 0x04:
+                base = static_cast<uint64_t>(bytes[4] << 8 | bytes[5]) << 16;
+                break;
+            default:
+                break; // start addresses mean nothing to a memory
+        }
+    }
+    return true;
+}
+
+bool MemoryImage::read(const std::string& filename, const MappedFile& file, size_t wordSize, const Store& store) {
+    const std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+    switch (formatOf(filename, &file)) {
+        case FORMAT::INTEL_HEX:
+            return readIntelHex(filename, text, store);
+        case FORMAT::BINARY:
+            store(0, file.data(), file.size());
+            return true;
+        default:
+            return readText(filename, text, wordSize, store);
+    }
+}
+
+bool MemoryImage::write(const std::string& filename, size_t wordSize, const std::vector<Chunk>& chunks) {
+    const FORMAT format = formatOf(filename);
+    std::ofstream out(filename, format == FORMAT::BINARY ? std::ios::binary : std::ios::out);
+    if (!out) {
+        std::cerr << "Cannot write memory file: " << filename << std::endl;
+        return false;
+    }
+    char line[80];
+    if (format == FORMAT::INTEL_HEX) {
+        auto record = [&](uint8_t type, uint64_t address, const uint8_t* bytes, size_t count) {
+            uint8_t sum = static_cast<uint8_t>(count + (address >> 8) + address + type);
+            int length = std::snprintf(line, sizeof(line), ":%02zX%04X%02X", count, static_cast<unsigned>(address & 0xFFFF), type);
+            for (size_t i = 0; i < count; ++i) {
+                length += std::snprintf(line + length, sizeof(line) - length, "%02X", bytes[i]);
+                sum += bytes[i];
+            }
+            std::snprintf(line + length, sizeof(line) - length, "%02X\n", static_cast<uint8_t>(-sum));
+            out << line;
+        };
+        uint64_t upper = 0;
+        for (const Chunk& chunk : chunks) {
+            if (chunk.address + chunk.size > (uint64_t(1) << 32)) {
+                std::cerr << "Cannot write memory file: " << filename << " (Intel HEX only reaches 4 GiB)" << std::endl;
+                return false;
+            }
+            for (size_t offset = 0; offset < chunk.size;) {
+                const uint64_t address = chunk.address + offset;
+                if (address >> 16 != upper) {
+                    upper = address >> 16;
+                    const uint8_t bytes[2] = {static_cast<uint8_t>(upper >> 8), static_cast<uint8_t>(upper)};
+                    record(0x04, 0, bytes, 2);
+                }
+                // Records stop at 64 KiB boundaries, where the next extended address record goes
+                const size_t count = std::min<size_t>({16, chunk.size - offset, 0x10000 - (address & 0xFFFF)});
+                record(0x00, address, chunk.bytes + offset, count);
+                offset += count;
+            }
+        }
+        record(0x01, 0, nullptr, 0);
+    } else {
+        uint64_t position = 0;
+        std::vector<uint8_t> zeros(std::max<size_t>(wordSize, 64 * 1024), 0);
+        auto emit = [&](const uint8_t* bytes, size_t size) {
+            if (format == FORMAT::BINARY) {
+                out.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+                return;
+            }
+            // Whole words, most significant digit first
+            for (size_t word = 0; word + wordSize <= size; word += wordSize) {
+                int length = std::snprintf(line, sizeof(line), "0x");
+                for (size_t byte = wordSize; byte-- > 0;) {
+                    length += std::snprintf(line + length, sizeof(line) - length, "%02X", bytes[word + byte]);
+                    if (length > 64) {
+                        out.write(line, length);
+                        length = 0;
+                    }
+                }
+                out.write(line, length) << '\n';
+            }
+        };
+        for (const Chunk& chunk : chunks) {
+            // Text files jump over gaps instead of spelling them out
+            if (format == FORMAT::TEXT && position != chunk.address) {
+                out << '@' << std::hex << std::uppercase << chunk.address / wordSize << std::dec << '\n';
+                position = chunk.address;
+            }
+            while (position < chunk.address) {
+                const size_t gap = static_cast<size_t>(std::min<uint64_t>(chunk.address - position, zeros.size() / wordSize * wordSize));
+                emit(zeros.data(), gap);
+                position += gap;
+            }
+            emit(chunk.bytes, chunk.size);
+            position = chunk.address + chunk.size;
+        }
+    }
+    out.flush();
+    if (!out) {
+        std::cerr << "Cannot write memory file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,472 @@
+#include "../includes/Module.h"
+#include "../includes/Arena.h"
+#include "../includes/Multiplexer.h"
+#include "../includes/ROM.h"
+#include "../includes/RAM.h"
+#include "../includes/Register.h"
+#include "../includes/ReductionGate.h"
+#include "../includes/WireBus.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+std::unordered_map<std::string, Module*> Module::modules;
+
+// Part of a bus, one wire such as x[3] or a range such as x[7:4]: the bus name and the lowest and highest wire
+static bool busSlice(std::string_view word, std::string_view& name, uint32_t& low, uint32_t& high) {
+    int first, last;
+    if (Tokenizer::busRange(word, name, first, last)) {
+        low = static_cast<uint32_t>(std::min(first, last));
+        high = static_cast<uint32_t>(std::max(first, last));
+        return true;
+    }
+    const size_t open = word.find('[');
+    size_t bit;
+    if (open == std::string_view::npos || open == 0 || word.back() != ']' ||
+        !Tokenizer::number(word.substr(open + 1, word.size() - open - 2), bit) || bit > UINT32_MAX)
+        return false;
+    name = word.substr(0, open);
+    low = high = static_cast<uint32_t>(bit);
+    return true;
+}
+
+// Commands of the design file, which can't be used as module names
+static bool isCommand(std::string_view word) {
+    COMPONENT gate;
+    FLIP_FLOP_TYPE flipFlop;
+    ARITHMETIC_OP arithmetic;
+    for (const char* command : {"wire", "assign", "mux", "demux", "rom", "ram", "reg", "module", "endmodule"}) {
+        if (Tokenizer::equalsLower(word, command)) return true;
+    }
+    return Component::parseType(word, gate) || FlipFlop::parseType(word, flipFlop) || Arithmetic::parseType(word, arithmetic);
+}
+
+Module::Module(const Tokenizer& words) : name(words[1]) {
+    if (name.empty() || isCommand(name)) {
+        words.error(1, name.empty() ? "missing module name" : "module name " + name + " is a command");
+    }
+    for (size_t word = 2; word < words.size(); ++word) {
+        Operand net;
+        const std::string problem = declare(words[word], net);
+        if (!problem.empty()) words.error(word, problem);
+    }
+    ports = nets.size();
+}
+
+std::string Module::where() const {
+    return topLevel ? std::string() : " in module " + name;
+}
+
+std::string Module::declare(std::string_view word, Operand& net) {
+    std::string_view netName = word;
+    int high = 0, low = 0;
+    const bool bus = Tokenizer::busRange(word, netName, high, low);
+    if (word.empty()) return "missing wire name";
+    // Dots are kept for the wires of instances, except at the top level where a flattened design may use them
+    if (!bus && word.find_first_of(topLevel ? "[]" : "[].") != std::string_view::npos) return "invalid wire name " + std::string(word);
+    const uint32_t width = static_cast<uint32_t>(bus ? std::abs(high - low) + 1 : 1);
+    key.assign(netName);
+    if (topLevel) {
+        // A wire with the name of a bus or the other way around. A name declared twice is found when the
+        // wire is created right after (see create()), which saves a lookup in the much larger wire map.
+        if (bus ? Wire::wireMap.count(key) != 0 : WireBus::wireBusMap.count(key) != 0) return key + " is already declared";
+        net = {NO_NET, -1, width, bus};
+        return {};
+    }
+    if (netIndex.count(key)) return key + " is already declared" + where();
+    net = {static_cast<uint32_t>(nets.size()), -1, width, bus};
+    nets.push_back({width, bus});
+    netIndex.emplace(key, net.net);
+    return {};
+}
+
+bool Module::operand(const Tokenizer& words, size_t word, Operand& result) const {
+    const std::string_view text = words[word];
+    std::string_view busName;
+    uint32_t low, high;
+    if (topLevel) {
+        // A wire of a bus is found as part of the bus, so it can be used as either
+        key.assign(text);
+        auto bus = WireBus::wireBusMap.end();
+        if (!text.empty() && text.back() == ']' && busSlice(text, busName, low, high)) {
+            key.assign(busName);
+            bus = WireBus::wireBusMap.find(key);
+            if (bus != WireBus::wireBusMap.end() && high < bus->second.size()) {
+                result = {0, static_cast<int32_t>(low), high - low + 1, true, bus->second.data()};
+                return true;
+            }
+            key.assign(text);
+        }
+        auto single = Wire::wireMap.find(key);
+        if (single != Wire::wireMap.end() && single->second) {
+            result = {0, -1, 1, false, &single->second};
+            return true;
+        }
+        bus = WireBus::wireBusMap.find(key);
+        if (bus != WireBus::wireBusMap.end() && !bus->second.empty()) {
+            result = {0, -1, static_cast<uint32_t>(bus->second.size()), true, bus->second.data()};
+            return true;
+        }
+    } else {
+        auto found = netIndex.find(std::string(text));
+        if (found != netIndex.end()) {
+            result = {found->second, -1, nets[found->second].width, nets[found->second].bus};
+            return true;
+        }
+        if (busSlice(text, busName, low, high)) {
+            found = netIndex.find(std::string(busName));
+            if (found != netIndex.end() && nets[found->second].bus && high < nets[found->second].width) {
+                result = {found->second, static_cast<int32_t>(low), high - low + 1, true};
+                return true;
+            }
+        }
+    }
+    words.error(word, text.empty() ? "missing wire name" : "unknown wire " + std::string(text) + where());
+    return false;
+}
+
+bool Module::wireOperand(const Tokenizer& words, size_t word, Operand& result) const {
+    if (!operand(words, word, result)) return false;
+    if (result.bit < 0 ? result.bus : result.count != 1) {
+        words.error(word, std::string(words[word]) + " is a bus, not a wire");
+        return false;
+    }
+    return true;
+}
+
+bool Module::busOperand(const Tokenizer& words, size_t word, Operand& result) const {
+    if (!operand(words, word, result)) return false;
+    if (!result.bus) {
+        words.error(word, std::string(words[word]) + " is not a bus");
+        return false;
+    }
+    return true;
+}
+
+void Module::addLine(const Tokenizer& words) {
+    auto is = [&](std::string_view lower) { return Tokenizer::equalsLower(words[0], lower); };
+    // The top level reuses one statement, so a line only allocates for what it creates
+    Statement kept;
+    if (topLevel) {
+        std::vector<Operand> operands = std::move(line.operands);
+        operands.clear();
+        line = Statement();
+        line.operands = std::move(operands);
+    }
+    Statement& statement = topLevel ? line : kept;
+    statement.name = std::string(words[1]);
+    Operand operand;
+    auto wires = [&](size_t first, size_t count) {
+        for (size_t word = first; word < first + count; ++word) {
+            if (!wireOperand(words, word, operand)) return false;
+            statement.operands.push_back(operand);
+        }
+        return true;
+    };
+    // - or the end of the line leaves a wire out
+    auto optionalWires = [&](size_t first, size_t count) {
+        for (size_t word = first; word < first + count; ++word) {
+            if (words[word].empty() || words[word] == "-") statement.operands.push_back(Operand{NO_NET});
+            else if (!wires(word, 1)) return false;
+        }
+        return true;
+    };
+    auto buses = [&](size_t first, size_t count) {
+        for (size_t word = first; word < first + count; ++word) {
+            if (!busOperand(words, word, operand)) return false;
+            statement.operands.push_back(operand);
+        }
+        return true;
+    };
+
+    if (is("wire")) {
+        // wire <name> [high|low|clk], or a bus: wire <name>[<high>:<low>] [high|low]
+        // A clock can be followed by its timing: [<period>|<clock>/<divider>] [<phase>|-] [<high>|-]
+        statement.kind = STATEMENT::WIRE;
+        const std::string_view stateWord = words[2];
+        if (Tokenizer::equalsLower(stateWord, "high")) statement.state = WIRE_STATE::LOGIC_HIGH;
+        else if (Tokenizer::equalsLower(stateWord, "low")) statement.state = WIRE_STATE::LOGIC_LOW;
+        std::string_view netName = words[1];
+        int high, low;
+        statement.clock = !Tokenizer::busRange(words[1], netName, high, low) && Tokenizer::equalsLower(stateWord, "clk");
+        // A divided clock's source is a clock declared before
+        auto findClock = [&](std::string_view clockName) -> const ClockTiming* {
+            key.assign(clockName);
+            if (topLevel) {
+                const auto found = Wire::wireMap.find(key);
+                return found != Wire::wireMap.end() && found->second ? found->second->getClockTiming() : nullptr;
+            }
+            const auto found = netIndex.find(key);
+            if (found == netIndex.end()) return nullptr;
+            for (const Statement& declared : statements) {
+                if (declared.kind == STATEMENT::WIRE && declared.clock && declared.net.net == found->second) return &declared.timing;
+            }
+            return nullptr;
+        };
+        if (statement.clock && !ClockTiming::parse(words, 3, findClock, statement.timing)) return;
+        const std::string problem = declare(words[1], statement.net);
+        if (!problem.empty()) {
+            words.error(1, problem);
+            return;
+        }
+        statement.name = std::string(netName);
+    } else if (is("assign")) {
+        // assign <wire|bus> <high|low|wire>
+        statement.kind = STATEMENT::ASSIGN;
+        if (!this->operand(words, 1, operand)) return;
+        statement.operands.push_back(operand);
+        if (Tokenizer::equalsLower(words[2], "high")) {
+            statement.state = WIRE_STATE::LOGIC_HIGH;
+        } else if (Tokenizer::equalsLower(words[2], "low")) {
+            statement.state = WIRE_STATE::LOGIC_LOW;
+        } else if (!wires(2, 1)) {
+            return;
+        }
+    } else if (Component::parseType(words[0], statement.gate)) {
+        // NOT <name> <input> <output>, <gate> <name> <inputs...> <output> where an input can be a bus. See ReductionGate.h
+        statement.kind = STATEMENT::GATE;
+        if (statement.gate == COMPONENT::NOT) {
+            if (!wires(2, 2)) return;
+        } else {
+            const size_t last = words.size() - 1;
+            if (last < 3) {
+                words.error(0, "a gate needs inputs and an output");
+                return;
+            }
+            uint32_t inputWires = 0;
+            for (size_t word = 2; word < last; ++word) {
+                if (!this->operand(words, word, operand)) return;
+                statement.operands.push_back(operand);
+                inputWires += operand.count;
+            }
+            if (!wires(last, 1)) return;
+            if (inputWires < 2) {
+                words.error(2, "a gate needs at least two input wires");
+                return;
+            }
+        }
+    } else if (FlipFlop::parseType(words[0], statement.flipFlop)) {
+        // dff/tff <name> <clk> <input> <output> [rising|falling]
+        // srff/jkff <name> <clk> <inputA> <inputB> <output> [rising|falling]
+        statement.kind = STATEMENT::FLIP_FLOP;
+        const size_t count = FlipFlop::inputCount(statement.flipFlop) + 2;
+        if (!wires(2, count)) return;
+        if (Tokenizer::equalsLower(words[2 + count], "falling")) statement.edge = EDGE_TYPE::FALLING_EDGE;
+    } else if (is("mux") || is("demux")) {
+        // mux <dimensions> <name> <inputs...> <select> <output>, demux <dimensions> <name> <input> <select> <outputs...>
+        // Both commands do the same thing, the dimensions say which one it is.
+        bool demux;
+        if (!Multiplexer::parseDimensions(words[1], statement.ways, demux)) {
+            words.error(1, "unknown dimensions for MUX/DEMUX: " + std::string(words[1]));
+            return;
+        }
+        statement.kind = demux ? STATEMENT::DEMUX : STATEMENT::MUX;
+        statement.name = std::string(words[2]);
+        if (words.size() != 5 + statement.ways) {
+            words.error(0, std::string(words[1]) + " takes " + std::to_string(statement.ways + 2) + " buses");
+            return;
+        }
+        if (!buses(3, statement.ways + 2)) return;
+        // The constructors throw on mismatched buses, which is checked here once instead
+        const size_t selectWord = demux ? 1 : statement.ways;
+        for (size_t bus = 0; bus < statement.operands.size(); ++bus) {
+            const size_t expected = bus == selectWord ? Multiplexer::selectWidth(statement.ways) : statement.operands[0].count;
+            if (statement.operands[bus].count != expected) {
+                words.error(3 + bus, std::string(words[3 + bus]) + " has to be " + std::to_string(expected) + " wires wide");
+                return;
+            }
+        }
+    } else if (is("rom")) {
+        // rom <name> <address bus> <data bus> <memory file>
+        statement.kind = STATEMENT::ROM;
+        if (!buses(2, 2)) return;
+        statement.file = std::string(words[4]);
+    } else if (is("ram")) {
+        // ram <name> <clk> <write enable> <address bus> <data in> <data out> [<preload file>|-] [<dump file>]
+        statement.kind = STATEMENT::RAM;
+        if (!wires(2, 2) || !buses(4, 3)) return;
+        if (statement.operands[2].count > 64) {
+            words.error(4, "RAM addresses can be at most 64 wires wide");
+            return;
+        }
+        if (statement.operands[3].count != statement.operands[4].count) {
+            words.error(6, "data in and data out of RAM " + statement.name + " differ in width");
+            return;
+        }
+        if (words[7] != "-") statement.file = std::string(words[7]);
+        statement.dump = std::string(words[8]);
+    } else if (Arithmetic::parseType(words[0], statement.arithmetic)) {
+        // add/sub <name> <A> <B> <result> [<carry in>|-] [<carry out>], cmp <name> <A> <B> <equal|-> <less|-> <greater|->,
+        // shl/shr <name> <A> <amount> <result>
+        statement.kind = STATEMENT::ARITHMETIC;
+        const bool compare = statement.arithmetic == ARITHMETIC_OP::CMP;
+        if (!buses(2, compare ? 2 : 3)) return;
+        const std::vector<Operand>& operands = statement.operands;
+        const std::string problem = Arithmetic::shapeError(statement.arithmetic, operands[0].count, operands[1].count,
+                                                           compare ? 0 : operands[2].count);
+        if (!problem.empty()) {
+            words.error(2, problem);
+            return;
+        }
+        if (compare && !optionalWires(4, 3)) return;
+        if (!compare && Arithmetic::flagCount(statement.arithmetic) && !optionalWires(5, 2)) return;
+    } else if (is("reg")) {
+        // reg <name> <clk> <enable|-> <D> <Q> [rising|falling]
+        statement.kind = STATEMENT::REGISTER;
+        if (!wires(2, 1) || !optionalWires(3, 1) || !buses(4, 2)) return;
+        if (statement.operands[2].count != statement.operands[3].count) {
+            words.error(5, "D and Q of register " + statement.name + " differ in width");
+            return;
+        }
+        if (Tokenizer::equalsLower(words[6], "falling")) statement.edge = EDGE_TYPE::FALLING_EDGE;
+    } else {
+        // <module> <instance> <connections...>
+        auto module = modules.find(std::string(words[0]));
+        if (module == modules.end()) {
+            words.error(0, "unknown command " + std::string(words[0]));
+            return;
+        }
+        statement.kind = STATEMENT::INSTANCE;
+        statement.module = module->second;
+        if (statement.name.empty()) {
+            words.error(1, "missing instance name");
+            return;
+        }
+        if (words.size() != 2 + statement.module->portCount()) {
+            words.error(0, "module " + statement.module->getName() + " has " + std::to_string(statement.module->portCount()) + " ports");
+            return;
+        }
+        for (size_t port = 0; port < statement.module->portCount(); ++port) {
+            if (!this->operand(words, 2 + port, operand)) return;
+            if (operand.count != statement.module->portWidth(port)) {
+                words.error(2 + port, "port " + std::to_string(port + 1) + " of " + statement.module->getName() + " is " +
+                                          std::to_string(statement.module->portWidth(port)) + " wires wide");
+                return;
+            }
+            statement.operands.push_back(operand);
+        }
+    }
+    if (!topLevel) {
+        statements.push_back(std::move(statement));
+        return;
+    }
+    Frame circuit;
+    if (!create(statement, std::string(), circuit)) {
+        if (statement.kind == STATEMENT::WIRE) words.error(1, statement.name + " is already declared");
+        else if (statement.kind == STATEMENT::ROM) words.error(4, "ROM " + statement.name + " has no memory");
+        else words.error(7, "RAM " + statement.name + " could not be preloaded");
+    }
+}
+
+void Module::instantiate(const std::string& instance, const std::vector<std::vector<Wire*>>& connections) const {
+    const std::string prefix = instance + ".";
+    // Wires of every net of this instance: the connections, then the wires it creates
+    Frame frame(nets.size());
+    std::copy(connections.begin(), connections.begin() + ports, frame.begin());
+    for (const Statement& statement : statements) create(statement, prefix, frame);
+}
+
+bool Module::create(const Statement& statement, const std::string& prefix, Frame& frame) const {
+    auto first = [&](const Operand& operand) {
+        const uint32_t bit = operand.bit < 0 ? 0 : static_cast<uint32_t>(operand.bit);
+        return (topLevel ? operand.wires : frame[operand.net].data()) + bit;
+    };
+    auto wire = [&](const Operand& operand) -> Wire* {
+        return operand.net == NO_NET ? nullptr : *first(operand);
+    };
+    auto bus = [&](const Operand& operand) {
+        return std::vector<Wire*>(first(operand), first(operand) + operand.count);
+    };
+
+    const std::vector<Operand>& operands = statement.operands;
+    switch (statement.kind) {
+        case STATEMENT::WIRE: {
+            const size_t names = statement.net.bus ? WireBus::wireBusMap.size() : Wire::wireMap.size();
+            std::vector<Wire*> created;
+            if (statement.net.bus) {
+                created = Arena::circuit.create<WireBus>(prefix + statement.name, statement.net.count, statement.state)->getWires();
+            } else {
+                Wire* single = Arena::circuit.create<Wire>(prefix + statement.name, statement.state);
+                if (statement.clock) single->setClock(statement.timing);
+                created = {single};
+            }
+            if (!topLevel) frame[statement.net.net] = std::move(created);
+            // Inside a module the names were checked when it was defined
+            return !topLevel || (statement.net.bus ? WireBus::wireBusMap.size() : Wire::wireMap.size()) > names;
+        }
+        case STATEMENT::GATE: {
+            if (statement.gate == COMPONENT::NOT) {
+                Component* component = Component::create(statement.gate, prefix + statement.name);
+                component->setInput(wire(operands[0]), nullptr);
+                component->setOutput(wire(operands[1]));
+                break;
+            }
+            std::vector<Wire*> inputs;
+            for (size_t input = 0; input + 1 < operands.size(); ++input) {
+                inputs.insert(inputs.end(), first(operands[input]), first(operands[input]) + operands[input].count);
+            }
+            ReductionGate::create(statement.gate, prefix + statement.name, std::move(inputs), wire(operands.back()));
+            break;
+        }
+        case STATEMENT::FLIP_FLOP: {
+            const size_t inputs = FlipFlop::inputCount(statement.flipFlop);
+            FlipFlop::create(statement.flipFlop, prefix + statement.name, wire(operands[0]), wire(operands[1]),
+                             inputs == 2 ? wire(operands[2]) : nullptr, wire(operands[1 + inputs]), statement.edge);
+            break;
+        }
+        case STATEMENT::MUX: {
+            std::vector<std::vector<Wire*>> inputs;
+            for (size_t way = 0; way < statement.ways; ++way) inputs.push_back(bus(operands[way]));
+            Arena::circuit.create<Multiplexer>(statement.ways, prefix + statement.name, std::move(inputs), bus(operands[statement.ways]),
+                                               bus(operands[statement.ways + 1]));
+            break;
+        }
+        case STATEMENT::DEMUX: {
+            std::vector<std::vector<Wire*>> outputs;
+            for (size_t way = 0; way < statement.ways; ++way) outputs.push_back(bus(operands[2 + way]));
+            Arena::circuit.create<Demultiplexer>(statement.ways, prefix + statement.name, bus(operands[0]), bus(operands[1]), std::move(outputs));
+            break;
+        }
+        case STATEMENT::ROM: {
+            ROM* rom = Arena::circuit.create<ROM>(prefix + statement.name, bus(operands[0]), bus(operands[1]), statement.file);
+            return !ROM::roms.empty() && ROM::roms.back() == rom;
+        }
+        case STATEMENT::RAM: {
+            RAM* ram = Arena::circuit.create<RAM>(prefix + statement.name, wire(operands[0]), wire(operands[1]), bus(operands[2]),
+                                                  bus(operands[3]), bus(operands[4]), statement.file, statement.dump);
+            return !RAM::rams.empty() && RAM::rams.back() == ram;
+        }
+        case STATEMENT::ARITHMETIC: {
+            const bool compare = statement.arithmetic == ARITHMETIC_OP::CMP;
+            std::vector<Wire*> flags;
+            Wire* carryIn = nullptr;
+            if (compare) {
+                for (size_t flag = 2; flag < 5; ++flag) flags.push_back(wire(operands[flag]));
+            } else if (operands.size() > 3) {
+                carryIn = wire(operands[3]);
+                flags.push_back(wire(operands[4]));
+            }
+            Arena::circuit.create<Arithmetic>(statement.arithmetic, prefix + statement.name, bus(operands[0]), bus(operands[1]), carryIn,
+                                              compare ? std::vector<Wire*>() : bus(operands[2]), flags);
+            break;
+        }
+        case STATEMENT::REGISTER:
+            Arena::circuit.create<Register>(prefix + statement.name, wire(operands[0]), wire(operands[1]), bus(operands[2]), bus(operands[3]),
+                                            statement.edge);
+            break;
+        case STATEMENT::ASSIGN: {
+            // This is combinational logic, so the state is the one the wire has while the design is read
+            const WIRE_STATE state = operands.size() > 1 ? wire(operands[1])->getState() : statement.state;
+            for (Wire* target : bus(operands[0])) target->setState(state);
+            break;
+        }
+        case STATEMENT::INSTANCE: {
+            std::vector<std::vector<Wire*>> ports;
+            ports.reserve(operands.size());
+            for (const Operand& operand : operands) ports.push_back(bus(operand));
+            statement.module->instantiate(prefix + statement.name, ports);
+            break;
+        }
+    }
+    return true;
+}
@@ -1,25 +1,74 @@
 #include "../includes/Multiplexer.h"
 #include "../includes/Wire.h"
+#include <charconv>
 #include <iostream>
 
 std::vector<Multiplexer*> Multiplexer::multiplexers;
 std::vector<Demultiplexer*> Demultiplexer::demultiplexers;
 
+bool Multiplexer::parseDimensions(std::string_view word, size_t& ways, bool& demux) {
+    const size_t x = word.find_first_of("xX");
+    if (x == std::string_view::npos) return false;
+    size_t inputs, outputs;
+    const char* end = word.data() + word.size();
+    auto parsed = std::from_chars(word.data(), word.data() + x, inputs);
+    if (parsed.ec != std::errc() || parsed.ptr != word.data() + x) return false;
+    parsed = std::from_chars(word.data() + x + 1, end, outputs);
+    if (parsed.ec != std::errc() || parsed.ptr != end) return false;
+    demux = inputs == 1;
+    ways = demux ? outputs : inputs;
+    // A select of up to 63 wires is read in one word
+    return (inputs == 1) != (outputs == 1) && ways >= 2 && ways <= (size_t(1) << 62);
+}
+
+size_t Multiplexer::selectWidth(size_t ways) {
+    size_t width = 1;
+    while ((size_t(1) << width) < ways) ++width;
+    return width;
+}
+
+// Inputs a select could be pointing at: index itself, plus every combination of the undefined select wires,
+// skipping those past the last of ways. Calls visit(index) for each, the one known index when nothing is undefined.
+// Never more than ways calls: with many undefined wires it is cheaper to walk the inputs than the combinations.
+template <typename Visit>
+static void forEachSelected(uint64_t known, uint64_t undefined, size_t ways, Visit&& visit) {
+    const int undefinedWires = __builtin_popcountll(undefined);
+    if (undefinedWires < 63 && (uint64_t(1) << undefinedWires) <= ways) {
+        uint64_t subset = 0;
+        do {
+            if ((known | subset) < ways) visit(known | subset);
+            subset = (subset - undefined) & undefined;
+        } while (subset);
+        return;
+    }
+    for (uint64_t candidate = 0; candidate < ways; ++candidate) {
+        if ((candidate & ~undefined) == known) visit(candidate);
+    }
+}
+
 void Multiplexer::tick() {
     if (select.empty() || inputBuses.empty()) {
         std::cerr << "Multiplexer called with empty select or input buses." << std::endl;
         return;
     }
-    int index = 0;
-    for (size_t i = 0; i < select.size(); ++i) {
-        if (select[i]->isLogicHigh()) {
-            index |= (1 << i);
-        }
-    }
-    if (index < inputBuses.size()) {
-        for (size_t i = 0; i < outBus.size(); ++i) {
-            outBus[i]->setState(inputBuses[index][i]->getState());
-        }
+    uint64_t index, undefined;
+    WireBus::read(select, consecutiveSelect, 0, index, undefined);
+    for (size_t first = 0; first < outBus.size(); first += 64) {
+        // With undefined select wires, output bits the candidate inputs agree on stay defined
+        uint64_t high = 0, low = 0, unknown = 0;
+        bool selected = false;
+        forEachSelected(index, undefined, inputBuses.size(), [&](uint64_t candidate) {
+            uint64_t value, inputUnknown;
+            WireBus::read(inputBuses[candidate], consecutiveInputs[candidate], first, value, inputUnknown);
+            high |= value;
+            low |= ~value & ~inputUnknown;
+            unknown |= inputUnknown;
+            selected = true;
+        });
+        // Selecting past the last input keeps the output as it is
+        if (!selected) return;
+        unknown |= high & low;
+        WireBus::drive(outBus, consecutiveOutput, first, high & ~unknown, unknown);
     }
 }
 
@@ -28,15 +77,21 @@ void Demultiplexer::tick() {
         std::cerr << "Demultiplexer called with empty select or output buses." << std::endl;
         return;
     }
-    int index = 0;
-    for (size_t i = 0; i < select.size(); ++i) {
-        if (select[i]->isLogicHigh()) {
-            index |= (1 << i);
+    uint64_t index, undefined;
+    WireBus::read(select, consecutiveSelect, 0, index, undefined);
+    forEachSelected(index, undefined, outputBuses.size(), [&](uint64_t candidate) {
+        const std::vector<Wire*>& output = outputBuses[candidate];
+        for (size_t first = 0; first < output.size(); first += 64) {
+            uint64_t value, unknown;
+            WireBus::read(input, consecutiveInput, first, value, unknown);
+            if (undefined) {
+                // The output may or may not be the selected one: bits where it differs from the input become undefined
+                uint64_t outputValue, outputUnknown;
+                WireBus::read(output, consecutiveOutputs[candidate], first, outputValue, outputUnknown);
+                unknown |= outputUnknown | (value ^ outputValue);
+                value &= ~unknown;
+            }
+            WireBus::drive(output, consecutiveOutputs[candidate], first, value, unknown);
         }
-    }
-    if (index < outputBuses.size()) {
-        for (size_t i = 0; i < outputBuses[index].size(); ++i) {
-            outputBuses[index][i]->setState(input[i]->getState());
-        }
-    }
-}
\ No newline at end of file
+    });
+}
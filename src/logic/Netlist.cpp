@@ -0,0 +1,378 @@
+#include "../includes/Netlist.h"
+#include "../includes/Arithmetic.h"
+#include "../includes/Component.h"
+#include "../includes/FlipFlop.h"
+#include "../includes/Multiplexer.h"
+#include "../includes/ROM.h"
+#include "../includes/RAM.h"
+#include "../includes/ReductionGate.h"
+#include "../includes/Register.h"
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+Netlist Netlist::current;
+
+namespace {
+
+// Temporary per-node description used while compiling, in file order.
+struct PendingNode {
+    NODE_OP op;
+    Schedulable* block;
+    uint32_t inputA;
+    uint32_t inputB;
+    uint32_t output;
+    std::vector<uint32_t> inputs;
+    std::vector<uint32_t> outputs;
+};
+
+uint32_t wireIndex(const Wire* wire, uint32_t floating) {
+    return wire ? wire->getIndex() : floating;
+}
+
+void appendBus(std::vector<uint32_t>& target, const std::vector<Wire*>& bus) {
+    for (Wire* wire : bus) {
+        if (wire) target.push_back(wire->getIndex());
+    }
+}
+
+// Turns per-item lists into CSR arrays (start offsets + flat values).
+template <typename T>
+void buildCSR(size_t keyCount, const std::vector<std::pair<uint32_t, T>>& pairs, std::vector<uint32_t>& start, std::vector<T>& values) {
+    start.assign(keyCount + 1, 0);
+    for (const auto& pair : pairs) {
+        ++start[pair.first + 1];
+    }
+    std::partial_sum(start.begin(), start.end(), start.begin());
+    values.resize(pairs.size());
+    std::vector<uint32_t> cursor(start.begin(), start.end() - 1);
+    for (const auto& pair : pairs) {
+        values[cursor[pair.first]++] = pair.second;
+    }
+}
+
+}
+
+void Netlist::clear() {
+    op.clear();
+    inputA.clear();
+    inputB.clear();
+    output.clear();
+    block.clear();
+    level.clear();
+    loop.clear();
+    levelStart.clear();
+    cyclicLevel.clear();
+    loopNodeStart.clear();
+    loopNodes.clear();
+    loopWireStart.clear();
+    loopWires.clear();
+    fanoutStart.clear();
+    fanout.clear();
+    laterDriverStart.clear();
+    laterDrivers.clear();
+    clockFanoutStart.clear();
+    clockFanout.clear();
+    floatingWire = NO_WIRE;
+}
+
+void Netlist::compile() {
+    clear();
+    floatingWire = Wire::states.push_back(WIRE_STATE::LOGIC_UNDEFINED);
+    const size_t wireCount = Wire::states.size();
+
+    // Collect nodes in file order
+    std::vector<PendingNode> nodes;
+    nodes.reserve(Component::components.size() + Multiplexer::multiplexers.size() + Demultiplexer::demultiplexers.size() + ROM::roms.size() +
+                  RAM::rams.size() + Arithmetic::units.size() + ReductionGate::gates.size());
+    for (Component* component : Component::components) {
+        if (!component->getOutput()) {
+            std::cerr << "Component " << component->getName() << " has no output wire. Skipping." << std::endl;
+            continue;
+        }
+        PendingNode node{static_cast<NODE_OP>(component->getComponentType()), nullptr,
+                         wireIndex(component->getInputA(), floatingWire), wireIndex(component->getInputB(), floatingWire),
+                         component->getOutput()->getIndex(), {}, {}};
+        node.inputs = {node.inputA, node.inputB};
+        node.outputs = {node.output};
+        nodes.push_back(std::move(node));
+    }
+    for (Multiplexer* mux : Multiplexer::multiplexers) {
+        PendingNode node{NODE_OP::BLOCK, mux, floatingWire, floatingWire, floatingWire, {}, {}};
+        for (const auto& bus : mux->getInputBuses()) appendBus(node.inputs, bus);
+        appendBus(node.inputs, mux->getSelect());
+        appendBus(node.outputs, mux->getOutputBus());
+        nodes.push_back(std::move(node));
+    }
+    for (Demultiplexer* demux : Demultiplexer::demultiplexers) {
+        PendingNode node{NODE_OP::BLOCK, demux, floatingWire, floatingWire, floatingWire, {}, {}};
+        appendBus(node.inputs, demux->getInput());
+        appendBus(node.inputs, demux->getSelect());
+        for (const auto& bus : demux->getOutputBuses()) appendBus(node.outputs, bus);
+        nodes.push_back(std::move(node));
+    }
+    for (ROM* rom : ROM::roms) {
+        PendingNode node{NODE_OP::BLOCK, rom, floatingWire, floatingWire, floatingWire, {}, {}};
+        appendBus(node.inputs, rom->getAddressBus());
+        appendBus(node.outputs, rom->getOutputBus());
+        nodes.push_back(std::move(node));
+    }
+    // Only the read port of a RAM is combinational. Writes come from its clock port below.
+    for (RAM* ram : RAM::rams) {
+        PendingNode node{NODE_OP::BLOCK, ram, floatingWire, floatingWire, floatingWire, {}, {}};
+        appendBus(node.inputs, ram->getAddressBus());
+        appendBus(node.outputs, ram->getDataOut());
+        nodes.push_back(std::move(node));
+    }
+    // A whole adder, comparator or shifter is one node
+    for (Arithmetic* unit : Arithmetic::units) {
+        PendingNode node{NODE_OP::BLOCK, unit, floatingWire, floatingWire, floatingWire, {}, {}};
+        appendBus(node.inputs, unit->getBusA());
+        appendBus(node.inputs, unit->getBusB());
+        appendBus(node.inputs, {unit->getCarryIn()});
+        appendBus(node.outputs, unit->getResult());
+        appendBus(node.outputs, unit->getFlags());
+        nodes.push_back(std::move(node));
+    }
+    for (ReductionGate* gate : ReductionGate::gates) {
+        PendingNode node{NODE_OP::BLOCK, gate, floatingWire, floatingWire, floatingWire, {}, {}};
+        appendBus(node.inputs, gate->getInputs());
+        node.outputs = {gate->getOutput()->getIndex()};
+        nodes.push_back(std::move(node));
+    }
+    const uint32_t nodeTotal = static_cast<uint32_t>(nodes.size());
+
+    // Wire -> driving nodes
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (uint32_t n = 0; n < nodeTotal; ++n) {
+        for (uint32_t wire : nodes[n].outputs) pairs.emplace_back(wire, n);
+    }
+    std::vector<uint32_t> driverStart, drivers;
+    buildCSR(wireCount, pairs, driverStart, drivers);
+
+    // Node -> nodes reading one of its outputs
+    pairs.clear();
+    for (uint32_t n = 0; n < nodeTotal; ++n) {
+        for (uint32_t wire : nodes[n].inputs) {
+            for (uint32_t d = driverStart[wire]; d < driverStart[wire + 1]; ++d) pairs.emplace_back(drivers[d], n);
+        }
+    }
+    // Several drivers on one wire: the last one in the file wins, so keep them in file order across levels.
+    // This also guarantees a wire has at most one driver per level. The simulators re-run the later drivers
+    // whenever an earlier one changes the wire (see laterDrivers).
+    for (uint32_t wire = 0; wire < wireCount; ++wire) {
+        for (uint32_t d = driverStart[wire] + 1; d < driverStart[wire + 1]; ++d) pairs.emplace_back(drivers[d - 1], drivers[d]);
+    }
+    std::vector<uint32_t> successorStart, successors;
+    buildCSR(nodeTotal, pairs, successorStart, successors);
+
+    // Strongly connected components, Tarjan's algorithm with an explicit stack. Components are found
+    // downstream first, so counting them backwards is a topological order of the condensed graph.
+    constexpr uint32_t UNVISITED = UINT32_MAX;
+    std::vector<uint32_t> component(nodeTotal), visitIndex(nodeTotal, UNVISITED), lowLink(nodeTotal);
+    std::vector<uint8_t> onStack(nodeTotal, 0);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> path; // node, next successor to look at
+    uint32_t visited = 0, componentTotal = 0;
+    for (uint32_t root = 0; root < nodeTotal; ++root) {
+        if (visitIndex[root] != UNVISITED) continue;
+        visitIndex[root] = lowLink[root] = visited++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        path.emplace_back(root, successorStart[root]);
+        while (!path.empty()) {
+            const uint32_t n = path.back().first;
+            const uint32_t s = path.back().second;
+            if (s < successorStart[n + 1]) {
+                ++path.back().second;
+                const uint32_t next = successors[s];
+                if (visitIndex[next] == UNVISITED) {
+                    visitIndex[next] = lowLink[next] = visited++;
+                    stack.push_back(next);
+                    onStack[next] = 1;
+                    path.emplace_back(next, successorStart[next]);
+                } else if (onStack[next]) {
+                    lowLink[n] = std::min(lowLink[n], visitIndex[next]);
+                }
+                continue;
+            }
+            if (lowLink[n] == visitIndex[n]) {
+                uint32_t member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = 0;
+                    component[member] = componentTotal;
+                } while (member != n);
+                ++componentTotal;
+            }
+            path.pop_back();
+            if (!path.empty()) lowLink[path.back().first] = std::min(lowLink[path.back().first], lowLink[n]);
+        }
+    }
+
+    // A component is a loop if it has several nodes, or one node reading its own output
+    std::vector<uint32_t> componentSize(componentTotal, 0);
+    std::vector<uint8_t> cyclic(componentTotal, 0);
+    pairs.clear();
+    for (uint32_t n = 0; n < nodeTotal; ++n) {
+        ++componentSize[component[n]];
+        pairs.emplace_back(component[n], n);
+        for (uint32_t s = successorStart[n]; s < successorStart[n + 1]; ++s) {
+            if (successors[s] == n) cyclic[component[n]] = 1;
+        }
+    }
+    for (uint32_t c = 0; c < componentTotal; ++c) {
+        if (componentSize[c] > 1) cyclic[c] = 1;
+    }
+    std::vector<uint32_t> memberStart, members;
+    buildCSR(componentTotal, pairs, memberStart, members);
+
+    // Longest path depth of every component. Components only fed by primary inputs, flip-flops or constants are
+    // depth 0.
+    std::vector<uint32_t> depth(componentTotal, 0);
+    uint32_t maxDepth = 0;
+    for (uint32_t c = componentTotal; c-- > 0;) {
+        maxDepth = std::max(maxDepth, depth[c]);
+        for (uint32_t m = memberStart[c]; m < memberStart[c + 1]; ++m) {
+            const uint32_t n = members[m];
+            for (uint32_t s = successorStart[n]; s < successorStart[n + 1]; ++s) {
+                const uint32_t next = component[successors[s]];
+                if (next != c) depth[next] = std::max(depth[next], depth[c] + 1);
+            }
+        }
+    }
+
+    // Each depth becomes a level of plain nodes followed by a cyclic level of the loops at that depth.
+    // Either can be missing, so designs without loops keep one level per depth.
+    std::vector<uint8_t> hasPlain(maxDepth + 1, 0), hasLoop(maxDepth + 1, 0);
+    for (uint32_t c = 0; c < componentTotal; ++c) (cyclic[c] ? hasLoop : hasPlain)[depth[c]] = 1;
+    std::vector<uint32_t> plainLevel(maxDepth + 1), loopLevel(maxDepth + 1);
+    for (uint32_t d = 0, next = 0; d <= maxDepth; ++d) {
+        if (hasPlain[d]) {
+            plainLevel[d] = next++;
+            cyclicLevel.push_back(0);
+        }
+        if (hasLoop[d]) {
+            loopLevel[d] = next++;
+            cyclicLevel.push_back(1);
+        }
+    }
+    if (nodeTotal == 0) cyclicLevel.assign(1, 0);
+    std::vector<uint32_t> nodeLevel(nodeTotal);
+    uint32_t loopNodeTotal = 0, loopTotal = 0;
+    for (uint32_t c = 0; c < componentTotal; ++c) {
+        if (cyclic[c]) {
+            loopNodeTotal += componentSize[c];
+            ++loopTotal;
+        }
+    }
+    for (uint32_t n = 0; n < nodeTotal; ++n) {
+        const uint32_t c = component[n];
+        nodeLevel[n] = cyclic[c] ? loopLevel[depth[c]] : plainLevel[depth[c]];
+    }
+    if (loopTotal > 0) std::cout << loopNodeTotal << " nodes form " << loopTotal << " combinational loops." << std::endl;
+
+    // Order nodes by level, then group gates of the same type inside a level so they form runs the
+    // batch kernels (GateKernels.h) can process together. Nodes in a level are independent, so this is safe.
+    // Cyclic levels keep every loop together, in file order.
+    std::vector<uint32_t> order(nodeTotal);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+        if (nodeLevel[x] != nodeLevel[y]) return nodeLevel[x] < nodeLevel[y];
+        if (cyclicLevel[nodeLevel[x]]) return component[x] > component[y];
+        return nodes[x].op < nodes[y].op;
+    });
+
+    op.reserve(nodeTotal);
+    inputA.reserve(nodeTotal);
+    inputB.reserve(nodeTotal);
+    output.reserve(nodeTotal);
+    block.reserve(nodeTotal);
+    level.reserve(nodeTotal);
+    loop.reserve(nodeTotal);
+    levelStart.assign(cyclicLevel.size() + 1, 0);
+    pairs.clear();
+    std::vector<std::pair<uint32_t, uint32_t>> loopNodePairs, loopWirePairs;
+    uint32_t loopCounter = 0;
+    for (uint32_t n : order) {
+        const PendingNode& node = nodes[n];
+        uint32_t index = static_cast<uint32_t>(op.size());
+        op.push_back(node.op);
+        inputA.push_back(node.inputA);
+        inputB.push_back(node.inputB);
+        output.push_back(node.output);
+        block.push_back(node.block);
+        level.push_back(nodeLevel[n]);
+        ++levelStart[nodeLevel[n] + 1];
+        if (cyclic[component[n]]) {
+            if (index == 0 || component[order[index - 1]] != component[n]) ++loopCounter;
+            const uint32_t k = loopCounter - 1;
+            loop.push_back(k);
+            loopNodePairs.emplace_back(k, index);
+            for (uint32_t wire : node.outputs) loopWirePairs.emplace_back(k, wire);
+        } else {
+            loop.push_back(NO_LOOP);
+        }
+        for (size_t i = 0; i < node.inputs.size(); ++i) {
+            uint32_t wire = node.inputs[i];
+            // A node reading the same wire twice only needs to be woken once
+            if (std::find(node.inputs.begin(), node.inputs.begin() + i, wire) == node.inputs.begin() + i)
+                pairs.emplace_back(wire, index);
+        }
+    }
+    if (loopCounter > 0) {
+        buildCSR(loopCounter, loopNodePairs, loopNodeStart, loopNodes);
+        std::sort(loopWirePairs.begin(), loopWirePairs.end());
+        loopWirePairs.erase(std::unique(loopWirePairs.begin(), loopWirePairs.end()), loopWirePairs.end());
+        buildCSR(loopCounter, loopWirePairs, loopWireStart, loopWires);
+    }
+    std::partial_sum(levelStart.begin(), levelStart.end(), levelStart.begin());
+    buildCSR(wireCount, pairs, fanoutStart, fanout);
+
+    std::vector<uint32_t> compiledIndex(nodeTotal);
+    for (uint32_t index = 0; index < nodeTotal; ++index) compiledIndex[order[index]] = index;
+    pairs.clear();
+    for (uint32_t wire = 0; wire < wireCount; ++wire) {
+        for (uint32_t d = driverStart[wire] + 1; d < driverStart[wire + 1]; ++d) pairs.emplace_back(wire, compiledIndex[drivers[d]]);
+    }
+    buildCSR(wireCount, pairs, laterDriverStart, laterDrivers);
+
+    // Flip-flops (as clock domains), RAM writes and registers are woken by their clock only. Data inputs are
+    // sampled on the edge.
+    ClockDomain::build();
+    std::vector<std::pair<uint32_t, Schedulable*>> clockPairs;
+    for (ClockDomain* domain : ClockDomain::domains) clockPairs.emplace_back(domain->getClock()->getIndex(), domain);
+    for (RAM* ram : RAM::rams) {
+        if (ram->getClock()) clockPairs.emplace_back(ram->getClock()->getIndex(), ram->clockPort());
+    }
+    for (Register* reg : Register::registers) clockPairs.emplace_back(reg->getClock()->getIndex(), reg);
+    buildCSR(wireCount, clockPairs, clockFanoutStart, clockFanout);
+
+    std::cout << "Netlist compiled: " << nodeTotal << " nodes in " << levelCount() << " levels." << std::endl;
+}
+
+void Netlist::reportOscillation(uint32_t k, size_t passes, const std::vector<uint32_t>& wires) const {
+    std::cerr << "Combinational loop " << k << " (" << loopSize(k) << " nodes) did not settle after " << passes
+              << " passes. Oscillating wires:";
+    const size_t shown = std::min<size_t>(wires.size(), 16);
+    for (size_t i = 0; i < shown; ++i) std::cerr << " " << Wire::wires[wires[i]]->getName();
+    if (wires.size() > shown) std::cerr << " and " << wires.size() - shown << " more";
+    std::cerr << std::endl;
+}
+
+void Netlist::reportLoops(const std::vector<LoopStatistics>& statistics) const {
+    const uint32_t shown = static_cast<uint32_t>(std::min<size_t>(statistics.size(), 16));
+    for (uint32_t k = 0; k < shown; ++k) {
+        const LoopStatistics& loopStatistics = statistics[k];
+        std::cout << "Loop " << k << " (" << loopSize(k) << " nodes, drives " << Wire::wires[loopWires[loopWireStart[k]]]->getName()
+                  << "): woken in " << loopStatistics.settles << " settles";
+        if (loopStatistics.settles > 0) {
+            std::cout << ", " << static_cast<double>(loopStatistics.passes) / loopStatistics.settles << " passes on average, "
+                      << loopStatistics.mostPasses << " at most";
+        }
+        if (loopStatistics.oscillations > 0) std::cout << ", oscillated in " << loopStatistics.oscillations;
+        std::cout << "." << std::endl;
+    }
+    if (statistics.size() > shown) std::cout << "... and " << statistics.size() - shown << " more loops." << std::endl;
+}
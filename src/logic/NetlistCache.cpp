@@ -0,0 +1,686 @@
+#include "../includes/NetlistCache.h"
+#include "../includes/Arena.h"
+#include "../includes/Arithmetic.h"
+#include "../includes/Component.h"
+#include "../includes/FlipFlop.h"
+#include "../includes/MappedFile.h"
+#include "../includes/Multiplexer.h"
+#include "../includes/Netlist.h"
+#include "../includes/ROM.h"
+#include "../includes/RAM.h"
+#include "../includes/ReductionGate.h"
+#include "../includes/Register.h"
+#include "../includes/Scheduler.h"
+#include "../includes/Wire.h"
+#include "../includes/WireBus.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+bool NetlistCache::enabled = true;
+
+namespace {
+
+constexpr char MAGIC[8] = {'L', 'S', 'I', 'M', 'B', 'I', 'N', '\0'};
+constexpr uint32_t VERSION = 10;
+constexpr uint32_t NO_WIRE = Netlist::NO_WIRE;
+
+// Netlist::block entries: the kind in the top four bits, the index into its registry below.
+// Netlist::clockFanout entries are ClockDomain indices, or BLOCK_RAM for the write port of a RAM and BLOCK_REGISTER for a register.
+constexpr uint32_t BLOCK_MUX = 0, BLOCK_DEMUX = 1, BLOCK_ROM = 2, BLOCK_RAM = 3, BLOCK_ARITHMETIC = 4, BLOCK_REGISTER = 5, BLOCK_GATE = 6,
+                   NO_BLOCK = UINT32_MAX;
+constexpr uint32_t KIND_SHIFT = 28, INDEX_MASK = (1u << KIND_SHIFT) - 1;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t designSize;
+    uint64_t designHash;
+};
+
+// Slice of the string table
+struct Name {
+    uint32_t offset, length;
+};
+// Wires with consecutive handles, which every bus has
+struct Range {
+    uint32_t first, width;
+};
+
+// In handle order. Width 0 is a single wire, anything else a bus declaring that many wires.
+struct WireRecord {
+    Name name;
+    uint32_t width;
+};
+struct ComponentRecord {
+    Name name;
+    uint32_t type, inputA, inputB, output;
+};
+struct FlipFlopRecord {
+    Name name;
+    uint32_t type, edge, clock, inputA, inputB, output;
+};
+// Takes ways + 2 entries of the range pool: mux inputs, select and output, or demux input, select and outputs
+struct BlockRecord {
+    Name name;
+    uint32_t ways;
+};
+// imageOffset is MAPPED_IMAGE for a binary file, which is mapped again instead of stored
+struct RomRecord {
+    Name name, file;
+    Range address, data;
+    uint64_t fileHash, imageOffset, imageSize;
+};
+// The preload file is read again when the circuit is rebuilt, its hash is part of the key like a ROM file's
+struct RamRecord {
+    Name name, preload, dump;
+    uint32_t clock, writeEnable;
+    Range address, dataIn, dataOut;
+    uint64_t preloadHash;
+};
+// CMP has no result, its range is empty. Missing carry in and flags are NO_WIRE.
+struct ArithmeticRecord {
+    Name name;
+    uint32_t op, carryIn;
+    Range a, b, result;
+    uint32_t flags[3];
+};
+struct RegisterRecord {
+    Name name;
+    uint32_t edge, clock, enable;
+    Range inputD, outputQ;
+};
+// Takes inputCount entries of the gate input pool
+struct GateRecord {
+    Name name;
+    uint32_t type, output, inputCount;
+};
+struct NetlistRecord {
+    uint32_t loopCount, floatingWire;
+};
+constexpr uint64_t MAPPED_IMAGE = UINT64_MAX;
+
+// Not cryptographic, only has to notice edits. Eight bytes per step, so hashing a large design costs little next to mapping it.
+uint64_t contentHash(const uint8_t* data, size_t size) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+    auto mix = [&](uint64_t word) {
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    };
+    size_t at = 0;
+    for (uint64_t word; at + 8 <= size; at += 8) {
+        std::memcpy(&word, data + at, 8);
+        mix(word);
+    }
+    uint64_t tail = 0;
+    if (at < size) std::memcpy(&tail, data + at, size - at);
+    mix(tail);
+    return hash;
+}
+
+// Missing and empty files hash the same, as no contents
+uint64_t fileHash(const std::string& path) {
+    MappedFile file;
+    return file.open(path) ? contentHash(file.data(), file.size()) : contentHash(nullptr, 0);
+}
+
+// Binary ROM images can be far larger than the design, so they are keyed by size and modification time
+// rather than read in full
+uint64_t fileStamp(const std::string& path) {
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error) return contentHash(nullptr, 0);
+    const uint64_t time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    const uint64_t stamp[2] = {size, time};
+    return contentHash(reinterpret_cast<const uint8_t*>(stamp), sizeof(stamp));
+}
+
+class Writer {
+public:
+    std::string bytes;
+
+    template <typename T>
+    void put(const T& value) {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    // Count, elements, then padding so the next section stays 8-byte aligned
+    template <typename T>
+    void putArray(const std::vector<T>& values) {
+        put<uint64_t>(values.size());
+        bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        bytes.append((8 - bytes.size() % 8) % 8, '\0');
+    }
+};
+
+// Array inside the mapped file
+template <typename T>
+struct Span {
+    const T* data = nullptr;
+    size_t count = 0;
+
+    const T* begin() const {
+        return data;
+    }
+    const T* end() const {
+        return data + count;
+    }
+    const T& operator[](size_t i) const {
+        return data[i];
+    }
+};
+
+// Reads what Writer wrote, checking every size against the end of the file
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (size - at < sizeof(T)) return false;
+        std::memcpy(&value, data + at, sizeof(T));
+        at += sizeof(T);
+        return true;
+    }
+    template <typename T>
+    bool getArray(Span<T>& span) {
+        uint64_t count;
+        if (!get(count) || count > (size - at) / sizeof(T)) return false;
+        // The mapping is page aligned and every array starts 8-byte aligned, so elements can be used in place
+        span.data = reinterpret_cast<const T*>(data + at);
+        span.count = static_cast<size_t>(count);
+        at += span.count * sizeof(T);
+        at = std::min(size, at + (8 - at % 8) % 8);
+        return true;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t at = 0;
+};
+
+// CSR starts begin at 0, never go down and end at the size of the array they index. Empty without entries.
+bool validStarts(Span<uint32_t> starts, size_t size) {
+    if (starts.count == 0) return size == 0;
+    if (starts[0] != 0 || starts[starts.count - 1] != size) return false;
+    for (size_t i = 1; i < starts.count; ++i) {
+        if (starts[i] < starts[i - 1]) return false;
+    }
+    return true;
+}
+
+bool validIndices(Span<uint32_t> indices, size_t size) {
+    return std::all_of(indices.begin(), indices.end(), [&](uint32_t index) { return index < size; });
+}
+
+}
+
+std::string NetlistCache::pathFor(const std::string& designFile) {
+    return std::filesystem::path(designFile).replace_extension(".lsimb").string();
+}
+
+bool NetlistCache::save(const std::string& designFile) {
+    if (!enabled) return false;
+    MappedFile design;
+    if (!design.open(designFile)) return false;
+
+    std::string strings;
+    auto name = [&](const std::string& text) {
+        Name slice{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size())};
+        strings += text;
+        return slice;
+    };
+    auto handle = [](const Wire* wire) { return wire ? wire->getIndex() : NO_WIRE; };
+    // Buses the parser made are always consecutive wires. Anything else can't be stored as a range.
+    bool storable = true;
+    auto range = [&](const std::vector<Wire*>& bus) {
+        Range slice{bus.empty() ? NO_WIRE : handle(bus[0]), static_cast<uint32_t>(bus.size())};
+        for (size_t i = 0; i < bus.size(); ++i) {
+            if (!bus[i] || bus[i]->getIndex() != slice.first + i) storable = false;
+        }
+        return slice;
+    };
+
+    // Wires in handle order, with the wires of a bus declared as the bus again
+    std::unordered_map<uint32_t, std::pair<const std::string*, uint32_t>> busAt;
+    for (const auto& [busName, busWires] : WireBus::wireBusMap) {
+        const Range slice = range(busWires);
+        if (slice.width) busAt[slice.first] = {&busName, slice.width};
+    }
+    std::vector<WireRecord> wires;
+    for (uint32_t index = 0; index < Wire::wires.size();) {
+        auto bus = busAt.find(index);
+        if (bus != busAt.end()) {
+            wires.push_back({name(*bus->second.first), bus->second.second});
+            index += bus->second.second;
+        } else {
+            wires.push_back({name(Wire::wires[index]->getName()), 0});
+            ++index;
+        }
+    }
+
+    std::vector<ComponentRecord> components;
+    components.reserve(Component::components.size());
+    for (const Component* component : Component::components) {
+        components.push_back({name(component->getName()), static_cast<uint32_t>(component->getComponentType()),
+                              handle(component->getInputA()), handle(component->getInputB()), handle(component->getOutput())});
+    }
+    std::vector<FlipFlopRecord> flipFlops;
+    for (const FlipFlop* flipFlop : FlipFlop::flipFlops) {
+        const std::vector<Wire*> inputs = flipFlop->getInputs();
+        flipFlops.push_back({name(flipFlop->getName()), static_cast<uint32_t>(flipFlop->getType()), static_cast<uint32_t>(flipFlop->getEdgeType()),
+                             handle(flipFlop->getClock()), inputs.size() > 0 ? handle(inputs[0]) : NO_WIRE,
+                             inputs.size() > 1 ? handle(inputs[1]) : NO_WIRE, handle(flipFlop->getOutput())});
+    }
+
+    // Domains are rebuilt from the flip-flops on load, in the same order
+    std::unordered_map<const Schedulable*, uint32_t> domainIndex;
+    for (uint32_t i = 0; i < ClockDomain::domains.size(); ++i) domainIndex[ClockDomain::domains[i]] = i;
+
+    std::vector<BlockRecord> multiplexers, demultiplexers;
+    std::vector<Range> ranges;
+    std::unordered_map<const Schedulable*, uint32_t> blockCode;
+    for (const Multiplexer* mux : Multiplexer::multiplexers) {
+        blockCode[mux] = BLOCK_MUX << KIND_SHIFT | static_cast<uint32_t>(multiplexers.size());
+        multiplexers.push_back({name(mux->getName()), static_cast<uint32_t>(mux->getInputBuses().size())});
+        for (const auto& bus : mux->getInputBuses()) ranges.push_back(range(bus));
+        ranges.push_back(range(mux->getSelect()));
+        ranges.push_back(range(mux->getOutputBus()));
+    }
+    for (const Demultiplexer* demux : Demultiplexer::demultiplexers) {
+        blockCode[demux] = BLOCK_DEMUX << KIND_SHIFT | static_cast<uint32_t>(demultiplexers.size());
+        demultiplexers.push_back({name(demux->getName()), static_cast<uint32_t>(demux->getOutputBuses().size())});
+        ranges.push_back(range(demux->getInput()));
+        ranges.push_back(range(demux->getSelect()));
+        for (const auto& bus : demux->getOutputBuses()) ranges.push_back(range(bus));
+    }
+    std::vector<RomRecord> roms;
+    std::vector<uint8_t> images;
+    for (const ROM* rom : ROM::roms) {
+        blockCode[rom] = BLOCK_ROM << KIND_SHIFT | static_cast<uint32_t>(roms.size());
+        if (rom->isMapped()) {
+            roms.push_back({name(rom->getName()), name(rom->getFilename()), range(rom->getAddressBus()), range(rom->getOutputBus()),
+                            fileStamp(rom->getFilename()), MAPPED_IMAGE, 0});
+            continue;
+        }
+        roms.push_back({name(rom->getName()), name(rom->getFilename()), range(rom->getAddressBus()), range(rom->getOutputBus()),
+                        fileHash(rom->getFilename()), images.size(), rom->imageSize()});
+        images.insert(images.end(), rom->image(), rom->image() + rom->imageSize());
+    }
+    std::vector<RamRecord> rams;
+    std::unordered_map<const Schedulable*, uint32_t> clockCode;
+    for (RAM* ram : RAM::rams) {
+        blockCode[ram] = BLOCK_RAM << KIND_SHIFT | static_cast<uint32_t>(rams.size());
+        clockCode[ram->clockPort()] = BLOCK_RAM << KIND_SHIFT | static_cast<uint32_t>(rams.size());
+        rams.push_back({name(ram->getName()), name(ram->getPreloadFile()), name(ram->getDumpFile()), handle(ram->getClock()),
+                        handle(ram->getWriteEnable()), range(ram->getAddressBus()), range(ram->getDataIn()), range(ram->getDataOut()),
+                        ram->getPreloadFile().empty() ? 0 : fileHash(ram->getPreloadFile())});
+    }
+    std::vector<ArithmeticRecord> arithmetics;
+    for (const Arithmetic* unit : Arithmetic::units) {
+        blockCode[unit] = BLOCK_ARITHMETIC << KIND_SHIFT | static_cast<uint32_t>(arithmetics.size());
+        ArithmeticRecord record{name(unit->getName()), static_cast<uint32_t>(unit->getOp()), handle(unit->getCarryIn()),
+                                range(unit->getBusA()), range(unit->getBusB()), range(unit->getResult()), {NO_WIRE, NO_WIRE, NO_WIRE}};
+        for (size_t i = 0; i < unit->getFlags().size(); ++i) record.flags[i] = handle(unit->getFlags()[i]);
+        arithmetics.push_back(record);
+    }
+    std::vector<RegisterRecord> registers;
+    for (const Register* reg : Register::registers) {
+        clockCode[reg] = BLOCK_REGISTER << KIND_SHIFT | static_cast<uint32_t>(registers.size());
+        registers.push_back({name(reg->getName()), static_cast<uint32_t>(reg->getEdgeType()), handle(reg->getClock()), handle(reg->getEnable()),
+                             range(reg->getInputD()), range(reg->getOutputQ())});
+    }
+    std::vector<GateRecord> gates;
+    std::vector<uint32_t> gateInputs;
+    for (const ReductionGate* gate : ReductionGate::gates) {
+        blockCode[gate] = BLOCK_GATE << KIND_SHIFT | static_cast<uint32_t>(gates.size());
+        gates.push_back({name(gate->getName()), static_cast<uint32_t>(gate->getType()), handle(gate->getOutput()),
+                         static_cast<uint32_t>(gate->getInputs().size())});
+        for (const Wire* input : gate->getInputs()) gateInputs.push_back(handle(input));
+    }
+    if (!storable) return false;
+
+    const Netlist& netlist = Netlist::current;
+    std::vector<uint32_t> blocks, clockFanout;
+    blocks.reserve(netlist.block.size());
+    for (const Schedulable* block : netlist.block) blocks.push_back(block ? blockCode.at(block) : NO_BLOCK);
+    clockFanout.reserve(netlist.clockFanout.size());
+    for (const Schedulable* clocked : netlist.clockFanout) {
+        auto domain = domainIndex.find(clocked);
+        clockFanout.push_back(domain != domainIndex.end() ? domain->second : clockCode.at(clocked));
+    }
+
+    Writer out;
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.designSize = design.size();
+    header.designHash = contentHash(design.data(), design.size());
+    out.put(header);
+    out.putArray(std::vector<char>(strings.begin(), strings.end()));
+    out.putArray(wires);
+    out.putArray(Wire::clocks);
+    out.putArray(Wire::clockTimings);
+    out.put<uint64_t>(Wire::states.size());
+    out.putArray(Wire::states.packed());
+    out.putArray(components);
+    out.putArray(flipFlops);
+    out.putArray(multiplexers);
+    out.putArray(demultiplexers);
+    out.putArray(ranges);
+    out.putArray(roms);
+    out.putArray(images);
+    out.putArray(rams);
+    out.putArray(arithmetics);
+    out.putArray(registers);
+    out.putArray(gates);
+    out.putArray(gateInputs);
+    out.putArray(netlist.op);
+    out.putArray(netlist.inputA);
+    out.putArray(netlist.inputB);
+    out.putArray(netlist.output);
+    out.putArray(netlist.level);
+    out.putArray(netlist.levelStart);
+    out.putArray(netlist.cyclicLevel);
+    out.putArray(netlist.loop);
+    out.putArray(netlist.loopNodeStart);
+    out.putArray(netlist.loopNodes);
+    out.putArray(netlist.loopWireStart);
+    out.putArray(netlist.loopWires);
+    out.putArray(netlist.fanoutStart);
+    out.putArray(netlist.fanout);
+    out.putArray(netlist.laterDriverStart);
+    out.putArray(netlist.laterDrivers);
+    out.putArray(netlist.clockFanoutStart);
+    out.putArray(clockFanout);
+    out.putArray(blocks);
+    out.put(NetlistRecord{static_cast<uint32_t>(netlist.loopCount()), netlist.floatingWire});
+
+    // Written aside and renamed, so a run that reads the cache never sees half of it
+    const std::string path = pathFor(designFile), temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(out.bytes.data(), static_cast<std::streamsize>(out.bytes.size()));
+        if (!file) {
+            std::cerr << "Cannot write netlist cache: " << path << std::endl;
+            std::filesystem::remove(temporary);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "Cannot write netlist cache: " << path << " (" << error.message() << ")" << std::endl;
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::cout << "Netlist cache written to " << path << std::endl;
+    return true;
+}
+
+bool NetlistCache::load(const std::string& designFile) {
+    if (!enabled) return false;
+    const std::string path = pathFor(designFile);
+    MappedFile cache, design;
+    if (!cache.open(path) || !design.open(designFile)) return false;
+
+    Reader in(cache.data(), cache.size());
+    Header header;
+    if (!in.get(header) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.designSize != design.size() || header.designHash != contentHash(design.data(), design.size()))
+        return false;
+
+    Span<char> strings;
+    Span<WireRecord> wires;
+    Span<uint32_t> clocks;
+    Span<ClockTiming> clockTimings;
+    uint64_t stateCount;
+    Span<uint64_t> states;
+    Span<ComponentRecord> components;
+    Span<FlipFlopRecord> flipFlops;
+    Span<BlockRecord> multiplexers, demultiplexers;
+    Span<Range> ranges;
+    Span<RomRecord> roms;
+    Span<uint8_t> images;
+    Span<RamRecord> rams;
+    Span<ArithmeticRecord> arithmetics;
+    Span<RegisterRecord> registers;
+    Span<GateRecord> gates;
+    Span<uint32_t> gateInputs;
+    Span<NODE_OP> op;
+    Span<uint32_t> inputA, inputB, output, level, levelStart, fanoutStart, fanout, laterDriverStart, laterDrivers, clockFanoutStart, clockFanout, blocks;
+    Span<uint8_t> cyclicLevel;
+    Span<uint32_t> loop, loopNodeStart, loopNodes, loopWireStart, loopWires;
+    NetlistRecord netlistRecord;
+    if (!in.getArray(strings) || !in.getArray(wires) || !in.getArray(clocks) || !in.getArray(clockTimings) || !in.get(stateCount) || !in.getArray(states) ||
+        !in.getArray(components) || !in.getArray(flipFlops) || !in.getArray(multiplexers) || !in.getArray(demultiplexers) ||
+        !in.getArray(ranges) || !in.getArray(roms) || !in.getArray(images) || !in.getArray(rams) || !in.getArray(arithmetics) ||
+        !in.getArray(registers) || !in.getArray(gates) || !in.getArray(gateInputs) || !in.getArray(op) ||
+        !in.getArray(inputA) || !in.getArray(inputB) || !in.getArray(output) || !in.getArray(level) || !in.getArray(levelStart) ||
+        !in.getArray(cyclicLevel) || !in.getArray(loop) || !in.getArray(loopNodeStart) || !in.getArray(loopNodes) ||
+        !in.getArray(loopWireStart) || !in.getArray(loopWires) || !in.getArray(fanoutStart) || !in.getArray(fanout) ||
+        !in.getArray(laterDriverStart) || !in.getArray(laterDrivers) ||
+        !in.getArray(clockFanoutStart) || !in.getArray(clockFanout) || !in.getArray(blocks) ||
+        !in.get(netlistRecord))
+        return false;
+
+    bool valid = true;
+    auto text = [&](Name slice) {
+        if (slice.offset > strings.count || slice.length > strings.count - slice.offset) {
+            valid = false;
+            return std::string();
+        }
+        return std::string(strings.data + slice.offset, slice.length);
+    };
+    // The ROM and RAM preload files are part of the key: nothing is built if one of them changed
+    for (const RomRecord& rom : roms) {
+        const std::string file = text(rom.file);
+        if (!valid) return false;
+        if (rom.imageOffset == MAPPED_IMAGE) {
+            if (fileStamp(file) != rom.fileHash) return false;
+        } else if (fileHash(file) != rom.fileHash || rom.imageOffset > images.count || rom.imageSize > images.count - rom.imageOffset) {
+            return false;
+        }
+    }
+    for (const RamRecord& ram : rams) {
+        const std::string file = text(ram.preload);
+        if (!valid || (!file.empty() && fileHash(file) != ram.preloadHash)) return false;
+    }
+    const size_t nodeCount = op.count;
+    if (stateCount == 0 || states.count != (stateCount + WireStates::WIRES_PER_WORD - 1) / WireStates::WIRES_PER_WORD ||
+        inputA.count != nodeCount || inputB.count != nodeCount || output.count != nodeCount || level.count != nodeCount ||
+        blocks.count != nodeCount || levelStart.count == 0 || fanoutStart.count != stateCount + 1 ||
+        laterDriverStart.count != stateCount + 1 || clockFanoutStart.count != stateCount + 1 || netlistRecord.floatingWire != stateCount - 1)
+        return false;
+    const size_t loopCount = netlistRecord.loopCount, loopStarts = loopCount == 0 ? 0 : loopCount + 1;
+    if (cyclicLevel.count != levelStart.count - 1 || loop.count != nodeCount || loopNodeStart.count != loopStarts ||
+        loopWireStart.count != loopStarts)
+        return false;
+
+    // The kernel indexes with these without checking, so a damaged cache has to fail here rather than read out of bounds
+    if (!validStarts(levelStart, nodeCount) || !validStarts(fanoutStart, fanout.count) ||
+        !validStarts(laterDriverStart, laterDrivers.count) || !validStarts(clockFanoutStart, clockFanout.count) ||
+        !validStarts(loopNodeStart, loopNodes.count) || !validStarts(loopWireStart, loopWires.count) ||
+        !validIndices(fanout, nodeCount) || !validIndices(laterDrivers, nodeCount) || !validIndices(loopNodes, nodeCount) ||
+        !validIndices(inputA, stateCount) || !validIndices(inputB, stateCount) || !validIndices(output, stateCount) ||
+        !validIndices(loopWires, stateCount))
+        return false;
+    for (size_t node = 0; node < nodeCount; ++node) {
+        if (op[node] > NODE_OP::BLOCK || level[node] >= cyclicLevel.count || node < levelStart[level[node]] ||
+            node >= levelStart[level[node] + 1] || (loop[node] != Netlist::NO_LOOP && loop[node] >= loopCount))
+            return false;
+    }
+    // Every loop has nodes and drives wires, the loop report names its first one
+    for (size_t k = 0; k < loopCount; ++k) {
+        if (loopNodeStart[k] == loopNodeStart[k + 1] || loopWireStart[k] == loopWireStart[k + 1]) return false;
+    }
+
+    // Every count is known up front, so the registries are sized once
+    Wire::wireMap.reserve(stateCount);
+    Wire::wires.reserve(stateCount);
+    Component::components.reserve(components.count);
+    FlipFlop::flipFlops.reserve(flipFlops.count);
+
+    // Wires first: they take the same handles as when the design was parsed, in declaration order
+    size_t declared = 0;
+    for (const WireRecord& record : wires) {
+        const std::string wireName = text(record.name);
+        // A damaged width would otherwise declare billions of wires before the total below is checked
+        declared += record.width ? record.width : 1;
+        if (!valid || wireName.empty() || declared > stateCount - 1) return false;
+        if (record.width) Arena::circuit.create<WireBus>(wireName, static_cast<int>(record.width));
+        else Arena::circuit.create<Wire>(wireName);
+    }
+    if (Wire::wires.size() != stateCount - 1) return false;
+    Wire::states.assign(states.data, stateCount);
+    if (clockTimings.count != clocks.count) return false;
+    for (size_t i = 0; i < clocks.count; ++i) {
+        if (clocks[i] >= Wire::wires.size()) return false;
+        Wire::wires[clocks[i]]->setClock(clockTimings[i]);
+    }
+
+    auto wire = [&](uint32_t index) -> Wire* {
+        if (index == NO_WIRE) return nullptr;
+        if (index >= Wire::wires.size()) valid = false;
+        return valid ? Wire::wires[index] : nullptr;
+    };
+    auto bus = [&](Range slice) {
+        std::vector<Wire*> busWires;
+        if (slice.width == 0 || slice.first >= Wire::wires.size() || slice.width > Wire::wires.size() - slice.first) valid = false;
+        else busWires.assign(Wire::wires.begin() + slice.first, Wire::wires.begin() + slice.first + slice.width);
+        return busWires;
+    };
+    // Multiplexers and demultiplexers take their buses from the range pool in order
+    size_t nextRange = 0;
+    auto nextBus = [&]() { return bus(nextRange < ranges.count ? ranges[nextRange++] : Range{NO_WIRE, 0}); };
+
+    for (const ComponentRecord& record : components) {
+        if (record.type > static_cast<uint32_t>(COMPONENT::XNOR)) return false;
+        Component* component = Component::create(static_cast<COMPONENT>(record.type), text(record.name));
+        component->setInput(wire(record.inputA), wire(record.inputB));
+        component->setOutput(wire(record.output));
+    }
+    for (const FlipFlopRecord& record : flipFlops) {
+        if (record.type > static_cast<uint32_t>(FLIP_FLOP_TYPE::T_FLIP_FLOP)) return false;
+        FlipFlop::create(static_cast<FLIP_FLOP_TYPE>(record.type), text(record.name), wire(record.clock), wire(record.inputA),
+                         wire(record.inputB), wire(record.output), static_cast<EDGE_TYPE>(record.edge));
+    }
+    if (!valid) return false;
+
+    // The buses are checked before each block is created, since the constructors throw on bad shapes
+    for (const BlockRecord& record : multiplexers) {
+        std::vector<std::vector<Wire*>> inputs;
+        for (uint32_t way = 0; way < record.ways; ++way) inputs.push_back(nextBus());
+        std::vector<Wire*> select = nextBus(), out = nextBus();
+        if (!valid || record.ways == 0) return false;
+        Arena::circuit.create<Multiplexer>(record.ways, text(record.name), std::move(inputs), std::move(select), std::move(out));
+    }
+    for (const BlockRecord& record : demultiplexers) {
+        std::vector<Wire*> input = nextBus(), select = nextBus();
+        std::vector<std::vector<Wire*>> outputs;
+        for (uint32_t way = 0; way < record.ways; ++way) outputs.push_back(nextBus());
+        if (!valid || record.ways == 0) return false;
+        Arena::circuit.create<Demultiplexer>(record.ways, text(record.name), std::move(input), std::move(select), std::move(outputs));
+    }
+    for (const RomRecord& record : roms) {
+        std::vector<Wire*> addressBus = bus(record.address), dataBus = bus(record.data);
+        if (!valid) return false;
+        if (record.imageOffset == MAPPED_IMAGE) Arena::circuit.create<ROM>(text(record.name), addressBus, dataBus, text(record.file));
+        else Arena::circuit.create<ROM>(text(record.name), addressBus, dataBus, text(record.file), images.data + record.imageOffset, record.imageSize);
+    }
+    if (ROM::roms.size() != roms.count) return false;
+    for (const RamRecord& record : rams) {
+        Wire* clock = wire(record.clock);
+        Wire* writeEnable = wire(record.writeEnable);
+        std::vector<Wire*> addressBus = bus(record.address), dataIn = bus(record.dataIn), dataOut = bus(record.dataOut);
+        if (!valid || !clock || !writeEnable) return false;
+        Arena::circuit.create<RAM>(text(record.name), clock, writeEnable, addressBus, dataIn, dataOut, text(record.preload), text(record.dump));
+    }
+    if (RAM::rams.size() != rams.count) return false;
+    for (const ArithmeticRecord& record : arithmetics) {
+        if (record.op > static_cast<uint32_t>(ARITHMETIC_OP::SHR)) return false;
+        const ARITHMETIC_OP arithmeticOp = static_cast<ARITHMETIC_OP>(record.op);
+        std::vector<Wire*> a = bus(record.a), b = bus(record.b);
+        std::vector<Wire*> result = record.result.width ? bus(record.result) : std::vector<Wire*>();
+        std::vector<Wire*> flags;
+        for (size_t i = 0; i < Arithmetic::flagCount(arithmeticOp); ++i) flags.push_back(wire(record.flags[i]));
+        Wire* carryIn = wire(record.carryIn);
+        if (!valid || !Arithmetic::shapeError(arithmeticOp, a.size(), b.size(), result.size()).empty()) return false;
+        Arena::circuit.create<Arithmetic>(arithmeticOp, text(record.name), a, b, carryIn, result, flags);
+    }
+    for (const RegisterRecord& record : registers) {
+        Wire* clock = wire(record.clock);
+        Wire* enable = wire(record.enable);
+        std::vector<Wire*> inputD = bus(record.inputD), outputQ = bus(record.outputQ);
+        if (!valid || !clock || inputD.size() != outputQ.size()) return false;
+        Arena::circuit.create<Register>(text(record.name), clock, enable, inputD, outputQ, static_cast<EDGE_TYPE>(record.edge));
+    }
+    size_t nextInput = 0;
+    for (const GateRecord& record : gates) {
+        if (record.type > static_cast<uint32_t>(COMPONENT::XNOR) || record.type == static_cast<uint32_t>(COMPONENT::NOT) || record.inputCount < 3 ||
+            record.inputCount > gateInputs.count - nextInput)
+            return false;
+        std::vector<Wire*> inputs;
+        inputs.reserve(record.inputCount);
+        for (uint32_t i = 0; i < record.inputCount; ++i) inputs.push_back(wire(gateInputs[nextInput++]));
+        Wire* gateOutput = wire(record.output);
+        if (!valid || !gateOutput || std::find(inputs.begin(), inputs.end(), nullptr) != inputs.end()) return false;
+        Arena::circuit.create<ReductionGate>(static_cast<COMPONENT>(record.type), text(record.name), std::move(inputs), gateOutput);
+    }
+
+    // The compiled netlist, with blocks and clocked elements turned back into pointers
+    Netlist& netlist = Netlist::current;
+    netlist.op.assign(op.begin(), op.end());
+    netlist.inputA.assign(inputA.begin(), inputA.end());
+    netlist.inputB.assign(inputB.begin(), inputB.end());
+    netlist.output.assign(output.begin(), output.end());
+    netlist.level.assign(level.begin(), level.end());
+    netlist.levelStart.assign(levelStart.begin(), levelStart.end());
+    netlist.cyclicLevel.assign(cyclicLevel.begin(), cyclicLevel.end());
+    netlist.loop.assign(loop.begin(), loop.end());
+    netlist.loopNodeStart.assign(loopNodeStart.begin(), loopNodeStart.end());
+    netlist.loopNodes.assign(loopNodes.begin(), loopNodes.end());
+    netlist.loopWireStart.assign(loopWireStart.begin(), loopWireStart.end());
+    netlist.loopWires.assign(loopWires.begin(), loopWires.end());
+    netlist.fanoutStart.assign(fanoutStart.begin(), fanoutStart.end());
+    netlist.fanout.assign(fanout.begin(), fanout.end());
+    netlist.laterDriverStart.assign(laterDriverStart.begin(), laterDriverStart.end());
+    netlist.laterDrivers.assign(laterDrivers.begin(), laterDrivers.end());
+    netlist.clockFanoutStart.assign(clockFanoutStart.begin(), clockFanoutStart.end());
+    netlist.floatingWire = netlistRecord.floatingWire;
+    netlist.block.reserve(nodeCount);
+    for (uint32_t code : blocks) {
+        const uint32_t kind = code >> KIND_SHIFT, index = code & INDEX_MASK;
+        Schedulable* block = nullptr;
+        if (code == NO_BLOCK) {
+        } else if (kind == BLOCK_MUX && index < Multiplexer::multiplexers.size()) block = Multiplexer::multiplexers[index];
+        else if (kind == BLOCK_DEMUX && index < Demultiplexer::demultiplexers.size()) block = Demultiplexer::demultiplexers[index];
+        else if (kind == BLOCK_ROM && index < ROM::roms.size()) block = ROM::roms[index];
+        else if (kind == BLOCK_RAM && index < RAM::rams.size()) block = RAM::rams[index];
+        else if (kind == BLOCK_ARITHMETIC && index < Arithmetic::units.size()) block = Arithmetic::units[index];
+        else if (kind == BLOCK_GATE && index < ReductionGate::gates.size()) block = ReductionGate::gates[index];
+        else return false;
+        // Only BLOCK nodes are evaluated through their block
+        if ((block != nullptr) != (op[netlist.block.size()] == NODE_OP::BLOCK)) return false;
+        netlist.block.push_back(block);
+    }
+    ClockDomain::build();
+    netlist.clockFanout.reserve(clockFanout.count);
+    for (uint32_t code : clockFanout) {
+        const uint32_t kind = code >> KIND_SHIFT, index = code & INDEX_MASK;
+        if (kind == BLOCK_RAM && index < RAM::rams.size()) netlist.clockFanout.push_back(RAM::rams[index]->clockPort());
+        else if (kind == BLOCK_REGISTER && index < Register::registers.size()) netlist.clockFanout.push_back(Register::registers[index]);
+        else if (code < ClockDomain::domains.size()) netlist.clockFanout.push_back(ClockDomain::domains[code]);
+        else return false;
+    }
+
+    std::cout << "Netlist loaded from " << path << ": " << netlist.nodeCount() << " nodes in " << netlist.levelCount() << " levels." << std::endl;
+    Scheduler::prepare();
+    return true;
+}
@@ -0,0 +1,657 @@
+#include "../includes/PatternSimulator.h"
+#include "../includes/FlipFlop.h"
+#include "../includes/Multiplexer.h"
+#include "../includes/ROM.h"
+#include "../includes/RAM.h"
+#include "../includes/Register.h"
+#include "../includes/ReductionGate.h"
+#include <algorithm>
+#include <iostream>
+
+static constexpr uint64_t ALL_LANES = ~0ull;
+
+// Same cap the event-driven kernel uses for oscillating loops (MAX_LOOP_PASSES)
+static constexpr size_t MAX_FEEDBACK_PASSES = 64;
+
+static uint32_t handle(const Wire* wire, uint32_t missing) {
+    return wire ? wire->getIndex() : missing;
+}
+
+static std::vector<uint32_t> indices(const std::vector<Wire*>& bus, uint32_t floating) {
+    std::vector<uint32_t> result;
+    result.reserve(bus.size());
+    for (Wire* wire : bus) {
+        result.push_back(wire ? wire->getIndex() : floating);
+    }
+    return result;
+}
+
+PatternSimulator::PatternSimulator(const Netlist& netlist, size_t lanes)
+    : netlist(netlist),
+      words(std::max<size_t>(1, (std::min(lanes, MAX_LANES) + LANES_PER_WORD - 1) / LANES_PER_WORD)),
+      kernel(GateKernels::select(words)) {
+    const size_t wireCount = Wire::states.size();
+    value.assign(wireCount * words, 0);
+    unknown.assign(wireCount * words, 0);
+    // Start every lane from the elaborated initial state
+    for (uint32_t w = 0; w < wireCount; ++w) {
+        WIRE_STATE state = Wire::states[w];
+        std::fill_n(value.begin() + at(w, 0), words, state == WIRE_STATE::LOGIC_HIGH ? ALL_LANES : 0);
+        std::fill_n(unknown.begin() + at(w, 0), words, state == WIRE_STATE::LOGIC_UNDEFINED ? ALL_LANES : 0);
+    }
+
+    const uint32_t floating = netlist.floatingWire;
+    blockRefs.resize(netlist.nodeCount());
+    for (uint32_t n = 0; n < netlist.nodeCount(); ++n) {
+        if (netlist.op[n] != NODE_OP::BLOCK) continue;
+        Schedulable* block = netlist.block[n];
+        if (auto* mux = dynamic_cast<Multiplexer*>(block)) {
+            MuxProgram program{mux, {}, indices(mux->getSelect(), floating), indices(mux->getOutputBus(), floating)};
+            for (const auto& bus : mux->getInputBuses()) program.inputs.push_back(indices(bus, floating));
+            blockRefs[n] = {BLOCK_KIND::MUX, static_cast<uint32_t>(muxes.size())};
+            muxes.push_back(std::move(program));
+        } else if (auto* demux = dynamic_cast<Demultiplexer*>(block)) {
+            DemuxProgram program{demux, indices(demux->getInput(), floating), indices(demux->getSelect(), floating), {}};
+            for (const auto& bus : demux->getOutputBuses()) program.outputs.push_back(indices(bus, floating));
+            blockRefs[n] = {BLOCK_KIND::DEMUX, static_cast<uint32_t>(demuxes.size())};
+            demuxes.push_back(std::move(program));
+        } else if (auto* rom = dynamic_cast<ROM*>(block)) {
+            blockRefs[n] = {BLOCK_KIND::ROM, static_cast<uint32_t>(roms.size())};
+            roms.push_back({rom, indices(rom->getAddressBus(), floating), indices(rom->getOutputBus(), floating)});
+        } else if (auto* ram = dynamic_cast<RAM*>(block)) {
+            blockRefs[n] = {BLOCK_KIND::RAM, static_cast<uint32_t>(rams.size())};
+            RamProgram program{ram, ram->getClock()->getIndex(), ram->getWriteEnable()->getIndex(), indices(ram->getAddressBus(), floating),
+                               indices(ram->getDataIn(), floating), indices(ram->getDataOut(), floating), std::vector<uint64_t>(words, 0),
+                               std::vector<uint64_t>(words, 0), {}};
+            program.lanes.reserve(laneCount());
+            for (size_t lane = 0; lane < laneCount(); ++lane) program.lanes.emplace_back(ram->getMemory().wordBytes());
+            rams.push_back(std::move(program));
+        } else if (auto* unit = dynamic_cast<Arithmetic*>(block)) {
+            blockRefs[n] = {BLOCK_KIND::ARITHMETIC, static_cast<uint32_t>(arithmetics.size())};
+            ArithmeticProgram program{unit, indices(unit->getBusA(), floating), indices(unit->getBusB(), floating),
+                                      handle(unit->getCarryIn(), Netlist::NO_WIRE), indices(unit->getResult(), floating), {}};
+            for (const Wire* flag : unit->getFlags()) program.flags.push_back(handle(flag, Netlist::NO_WIRE));
+            arithmetics.push_back(std::move(program));
+        } else if (auto* gate = dynamic_cast<ReductionGate*>(block)) {
+            blockRefs[n] = {BLOCK_KIND::GATE, static_cast<uint32_t>(gates.size())};
+            gates.push_back({gate, indices(gate->getInputs(), floating), gate->getOutput()->getIndex()});
+        }
+    }
+
+    // Split the level-ordered nodes into runs of one gate type, and the runs into segments: one per loop, and
+    // one per stretch of acyclic levels. Runs never cross the border of a segment.
+    for (uint32_t n = 0; n < netlist.nodeCount(); ++n) {
+        const uint32_t loop = netlist.loop[n];
+        const bool border = segments.empty() || segments.back().loop != loop;
+        if (border) segments.push_back({runs.size(), runs.size(), loop});
+        NODE_OP op = netlist.op[n];
+        if (op != NODE_OP::BLOCK && !border && runs.back().op == op) {
+            ++runs.back().count;
+        } else {
+            runs.push_back({op, n, 1});
+        }
+        segments.back().lastRun = runs.size();
+    }
+    loopStatistics.resize(netlist.loopCount());
+
+    for (const ClockDomain* domain : ClockDomain::domains) {
+        const size_t cells = domain->size() * words;
+        domains.push_back({domain, domain->getClock()->getIndex(), std::vector<uint64_t>(words, 0), std::vector<uint64_t>(words, 0),
+                           std::vector<uint64_t>(cells, 0), std::vector<uint64_t>(cells, 0), std::vector<uint64_t>(cells, 0)});
+    }
+    // In registry order, like the clock fanout of the event-driven kernel
+    for (Register* reg : Register::registers) {
+        const size_t cells = reg->getOutputQ().size() * words;
+        registers.push_back({reg, reg->getClock()->getIndex(), handle(reg->getEnable(), Netlist::NO_WIRE), indices(reg->getInputD(), floating),
+                             indices(reg->getOutputQ(), floating), std::vector<uint64_t>(words, 0), std::vector<uint64_t>(words, 0),
+                             std::vector<uint64_t>(words, 0), std::vector<uint64_t>(cells, 0), std::vector<uint64_t>(cells, 0)});
+    }
+
+    tracedWires = Wire::wires.size();
+}
+
+bool PatternSimulator::assign(uint32_t wire, size_t word, uint64_t mask, uint64_t newValue, uint64_t newUnknown) {
+    const size_t i = at(wire, word);
+    uint64_t nextUnknown = (unknown[i] & ~mask) | (newUnknown & mask);
+    uint64_t nextValue = ((value[i] & ~mask) | (newValue & mask)) & ~nextUnknown;
+    bool changed = nextValue != value[i] || nextUnknown != unknown[i];
+    value[i] = nextValue;
+    unknown[i] = nextUnknown;
+    return changed;
+}
+
+void PatternSimulator::setWire(uint32_t wire, size_t firstLane, size_t lastLane, WIRE_STATE state) {
+    lastLane = std::min(lastLane, laneCount() - 1);
+    for (size_t word = firstLane / LANES_PER_WORD; word <= lastLane / LANES_PER_WORD && firstLane <= lastLane; ++word) {
+        const size_t wordFirst = word * LANES_PER_WORD;
+        const size_t low = std::max(firstLane, wordFirst) - wordFirst;
+        const size_t high = std::min(lastLane, wordFirst + LANES_PER_WORD - 1) - wordFirst;
+        const uint64_t mask = (high - low == 63 ? ALL_LANES : ((1ull << (high - low + 1)) - 1)) << low;
+        assign(wire, word, mask,
+               state == WIRE_STATE::LOGIC_HIGH ? ALL_LANES : 0,
+               state == WIRE_STATE::LOGIC_UNDEFINED ? ALL_LANES : 0);
+    }
+}
+
+bool PatternSimulator::evaluateBlock(uint32_t n) {
+    const BlockRef ref = blockRefs[n];
+    bool changed = false;
+    for (size_t word = 0; word < words; ++word) {
+        switch (ref.kind) {
+            case BLOCK_KIND::MUX:   changed |= evaluateMux(muxes[ref.index], word);     break;
+            case BLOCK_KIND::DEMUX: changed |= evaluateDemux(demuxes[ref.index], word); break;
+            case BLOCK_KIND::ROM:   changed |= evaluateRom(roms[ref.index], word);      break;
+            case BLOCK_KIND::RAM:   changed |= evaluateRam(rams[ref.index], word);      break;
+            case BLOCK_KIND::GATE:  changed |= evaluateGate(gates[ref.index], word);    break;
+            case BLOCK_KIND::ARITHMETIC: {
+                const ArithmeticProgram& program = arithmetics[ref.index];
+                const ARITHMETIC_OP op = program.unit->getOp();
+                changed |= op == ARITHMETIC_OP::SHL || op == ARITHMETIC_OP::SHR ? evaluateShift(program, word) : evaluateArithmetic(program, word);
+                break;
+            }
+        }
+    }
+    return changed;
+}
+
+bool PatternSimulator::evaluateRuns(size_t first, size_t last) {
+    bool changed = false;
+    for (size_t r = first; r < last; ++r) {
+        const Run& run = runs[r];
+        if (run.op == NODE_OP::BLOCK) {
+            changed |= evaluateBlock(run.start);
+        } else {
+            changed |= kernel(run.op, &netlist.inputA[run.start], &netlist.inputB[run.start], &netlist.output[run.start],
+                              run.count, value.data(), unknown.data(), words);
+        }
+    }
+    return changed;
+}
+
+bool PatternSimulator::evaluateNodes() {
+    bool changed = false;
+    for (const Segment& segment : segments) {
+        changed |= segment.loop != Netlist::NO_LOOP ? settleLoop(segment) : evaluateRuns(segment.firstRun, segment.lastRun);
+    }
+    return changed;
+}
+
+bool PatternSimulator::settleLoop(const Segment& segment) {
+    bool changed = false, passChanged = true;
+    size_t passes = 0;
+    // A second round only follows a restart, the event-driven kernel gives up at the same point
+    for (size_t round = 0; round < 2 && passChanged; ++round) {
+        if (round == 1 && !restartLoop(segment)) break;
+        for (size_t pass = 0; pass < MAX_FEEDBACK_PASSES && passChanged; ++pass, ++passes) {
+            passChanged = evaluateRuns(segment.firstRun, segment.lastRun);
+            changed |= passChanged;
+        }
+        passes += round == 0 && passChanged; // the pass restartLoop() looks at
+    }
+    LoopStatistics& statistics = loopStatistics[segment.loop];
+    ++statistics.settles;
+    statistics.passes += passes;
+    statistics.mostPasses = std::max(statistics.mostPasses, passes);
+    return changed;
+}
+
+bool PatternSimulator::restartLoop(const Segment& segment) {
+    const uint32_t k = segment.loop;
+    const uint32_t firstWire = netlist.loopWireStart[k], lastWire = netlist.loopWireStart[k + 1];
+
+    // One more pass shows which wires keep changing, and in which lanes
+    std::vector<uint64_t> before;
+    before.reserve(2 * (lastWire - firstWire) * words);
+    for (uint32_t w = firstWire; w < lastWire; ++w) {
+        const size_t first = at(netlist.loopWires[w], 0);
+        before.insert(before.end(), value.begin() + first, value.begin() + first + words);
+        before.insert(before.end(), unknown.begin() + first, unknown.begin() + first + words);
+    }
+    evaluateRuns(segment.firstRun, segment.lastRun);
+
+    std::vector<uint64_t> oscillating(words, 0);
+    std::vector<uint32_t> wires;
+    for (uint32_t w = firstWire; w < lastWire; ++w) {
+        const uint32_t wire = netlist.loopWires[w];
+        const uint64_t* old = &before[2 * (w - firstWire) * words];
+        uint64_t lanes = 0;
+        for (size_t word = 0; word < words; ++word) {
+            const uint64_t moved = (old[word] ^ value[at(wire, word)]) | (old[words + word] ^ unknown[at(wire, word)]);
+            oscillating[word] |= moved;
+            lanes |= moved;
+        }
+        if (lanes) wires.push_back(wire);
+    }
+    if (wires.empty()) return false;
+    if (loopStatistics[k].oscillations++ == 0) netlist.reportOscillation(k, MAX_FEEDBACK_PASSES, wires);
+    // Restart from undefined in the lanes where it oscillates, like the event-driven kernel does
+    for (uint32_t w = firstWire; w < lastWire; ++w) {
+        for (size_t word = 0; word < words; ++word) assign(netlist.loopWires[w], word, oscillating[word], 0, ALL_LANES);
+    }
+    return true;
+}
+
+uint64_t PatternSimulator::selectMatch(const std::vector<uint32_t>& select, size_t index, size_t word) const {
+    // Lanes whose defined select wires agree with index
+    uint64_t match = ALL_LANES;
+    for (size_t bit = 0; bit < select.size(); ++bit) {
+        match &= ((index >> bit) & 1) ? ~low(select[bit], word) : ~high(select[bit], word);
+    }
+    return match;
+}
+
+uint64_t PatternSimulator::undefinedLanes(const std::vector<uint32_t>& bus, size_t word) const {
+    uint64_t lanes = 0;
+    for (uint32_t wire : bus) lanes |= unknown[at(wire, word)];
+    return lanes;
+}
+
+bool PatternSimulator::evaluateMux(const MuxProgram& program, size_t word) {
+    if (program.select.empty() || program.inputs.empty()) return false;
+    // Only the inputs some lane selects are read for every output bit
+    std::vector<std::pair<size_t, uint64_t>> matches;
+    uint64_t covered = 0;
+    for (size_t i = 0; i < program.inputs.size(); ++i) {
+        const uint64_t match = selectMatch(program.select, i, word);
+        if (match) matches.emplace_back(i, match);
+        covered |= match;
+    }
+    bool changed = false;
+    for (size_t bit = 0; bit < program.outputs.size(); ++bit) {
+        // Lanes with undefined select wires merge every input they could be pointing at
+        uint64_t newHigh = 0, newLow = 0, newUnknown = 0;
+        for (const auto& [i, match] : matches) {
+            const uint32_t source = program.inputs[i][bit];
+            newHigh |= match & high(source, word);
+            newLow |= match & low(source, word);
+            newUnknown |= match & unknown[at(source, word)];
+        }
+        newUnknown |= newHigh & newLow;
+        // Lanes selecting past the last input keep their old value
+        changed |= assign(program.outputs[bit], word, covered, newHigh & ~newUnknown, newUnknown);
+    }
+    return changed;
+}
+
+bool PatternSimulator::evaluateDemux(const DemuxProgram& program, size_t word) {
+    if (program.select.empty() || program.outputs.empty()) return false;
+    const uint64_t maybe = undefinedLanes(program.select, word);
+    bool changed = false;
+    for (size_t i = 0; i < program.outputs.size(); ++i) {
+        uint64_t match = selectMatch(program.select, i, word);
+        if (!match) continue;
+        for (size_t bit = 0; bit < program.outputs[i].size(); ++bit) {
+            const uint32_t output = program.outputs[i][bit];
+            const size_t source = at(program.input[bit], word), target = at(output, word);
+            // Lanes that may or may not select this output keep only the bits it shares with the input
+            const uint64_t mixed = maybe & (unknown[source] | unknown[target] | (value[source] ^ value[target]));
+            changed |= assign(output, word, match, value[source] & ~mixed, unknown[source] | mixed);
+        }
+    }
+    return changed;
+}
+
+uint64_t PatternSimulator::laneAddress(const std::vector<uint32_t>& address, size_t word, size_t lane) const {
+    uint64_t result = 0;
+    for (size_t bit = 0; bit < address.size(); ++bit) {
+        if ((high(address[bit], word) >> lane) & 1) result |= bit < 64 ? 1ull << bit : UINT64_MAX;
+    }
+    return result;
+}
+
+bool PatternSimulator::evaluateRom(const RomProgram& program, size_t word) {
+    // Addresses differ per lane, so this one is a gather. Lanes with an undefined address read an undefined word.
+    const uint64_t undefined = undefinedLanes(program.address, word);
+    std::vector<uint64_t> newValue(program.outputs.size(), 0);
+    uint64_t covered = undefined;
+    for (size_t lane = 0; lane < LANES_PER_WORD; ++lane) {
+        if ((undefined >> lane) & 1) continue;
+        const uint8_t* data = program.rom->word(laneAddress(program.address, word, lane));
+        if (!data) continue;
+        covered |= 1ull << lane;
+        for (size_t bit = 0; bit < program.outputs.size(); ++bit) {
+            if ((data[bit / 8] >> (bit % 8)) & 1) newValue[bit] |= 1ull << lane;
+        }
+    }
+    bool changed = false;
+    for (size_t bit = 0; bit < program.outputs.size(); ++bit) {
+        changed |= assign(program.outputs[bit], word, covered, newValue[bit], undefined);
+    }
+    return changed;
+}
+
+bool PatternSimulator::evaluateRam(const RamProgram& program, size_t word) {
+    const uint64_t undefined = undefinedLanes(program.address, word);
+    std::vector<uint64_t> newValue(program.dataOut.size(), 0);
+    for (size_t lane = 0; lane < LANES_PER_WORD; ++lane) {
+        if ((undefined >> lane) & 1) continue;
+        const uint64_t address = laneAddress(program.address, word, lane);
+        const uint8_t* data = program.lanes[word * LANES_PER_WORD + lane].find(address);
+        if (!data) data = program.ram->getMemory().find(address);
+        if (!data) continue;
+        for (size_t bit = 0; bit < program.dataOut.size(); ++bit) {
+            if ((data[bit / 8] >> (bit % 8)) & 1) newValue[bit] |= 1ull << lane;
+        }
+    }
+    bool changed = false;
+    for (size_t bit = 0; bit < program.dataOut.size(); ++bit) {
+        changed |= assign(program.dataOut[bit], word, ALL_LANES, newValue[bit], undefined);
+    }
+    return changed;
+}
+
+bool PatternSimulator::evaluateArithmetic(const ArithmeticProgram& program, size_t word) {
+    const ARITHMETIC_OP op = program.unit->getOp();
+    const bool hasCarry = program.carryIn != Netlist::NO_WIRE;
+    const uint64_t undefined = undefinedLanes(program.a, word) | undefinedLanes(program.b, word) |
+                               (hasCarry ? unknown[at(program.carryIn, word)] : 0);
+    bool changed = false;
+    auto flag = [&](size_t i, uint64_t lanes) {
+        if (i < program.flags.size() && program.flags[i] != Netlist::NO_WIRE)
+            changed |= assign(program.flags[i], word, ALL_LANES, lanes & ~undefined, undefined);
+    };
+
+    if (op == ARITHMETIC_OP::CMP) {
+        // From the most significant wire down, the first one that differs decides
+        uint64_t equal = ALL_LANES, less = 0, greater = 0;
+        for (size_t bit = program.a.size(); bit-- > 0;) {
+            const uint64_t x = high(program.a[bit], word), y = high(program.b[bit], word);
+            less |= equal & ~x & y;
+            greater |= equal & x & ~y;
+            equal &= ~(x ^ y);
+        }
+        flag(0, equal);
+        flag(1, less);
+        flag(2, greater);
+        return changed;
+    }
+
+    // A - B - borrow is A + ~B + ~borrow, with the borrow out the inverted carry
+    const bool subtract = op == ARITHMETIC_OP::SUB;
+    uint64_t carry = hasCarry ? high(program.carryIn, word) : 0;
+    if (subtract) carry = ~carry;
+    for (size_t bit = 0; bit < program.a.size(); ++bit) {
+        const uint64_t x = high(program.a[bit], word);
+        const uint64_t y = subtract ? ~high(program.b[bit], word) : high(program.b[bit], word);
+        const uint64_t sum = x ^ y ^ carry;
+        carry = (x & y) | (carry & (x ^ y));
+        changed |= assign(program.result[bit], word, ALL_LANES, sum & ~undefined, undefined);
+    }
+    flag(0, subtract ? ~carry : carry);
+    return changed;
+}
+
+bool PatternSimulator::evaluateShift(const ArithmeticProgram& program, size_t word) {
+    const size_t width = program.a.size();
+    std::vector<uint64_t> shiftedValue(width), shiftedUnknown(width);
+    for (size_t bit = 0; bit < width; ++bit) {
+        shiftedValue[bit] = value[at(program.a[bit], word)];
+        shiftedUnknown[bit] = unknown[at(program.a[bit], word)];
+    }
+    // Barrel shifter: amount wire k shifts by 2^k in the lanes where it is high. Undefined bits move along.
+    const bool left = program.unit->getOp() == ARITHMETIC_OP::SHL;
+    uint64_t cleared = 0;
+    for (size_t k = 0; k < program.b.size(); ++k) {
+        const uint64_t shift = high(program.b[k], word);
+        if (k >= 64 || (uint64_t(1) << k) >= width) {
+            cleared |= shift;
+            continue;
+        }
+        const size_t distance = size_t(1) << k;
+        for (size_t step = 0; step < width; ++step) {
+            // Left shifts read lower wires, so go from the top down. Right shifts the other way.
+            const size_t bit = left ? width - 1 - step : step;
+            const bool inside = left ? bit >= distance : bit + distance < width;
+            const uint64_t fromValue = inside ? shiftedValue[left ? bit - distance : bit + distance] : 0;
+            const uint64_t fromUnknown = inside ? shiftedUnknown[left ? bit - distance : bit + distance] : 0;
+            shiftedValue[bit] = (shiftedValue[bit] & ~shift) | (fromValue & shift);
+            shiftedUnknown[bit] = (shiftedUnknown[bit] & ~shift) | (fromUnknown & shift);
+        }
+    }
+    const uint64_t undefined = undefinedLanes(program.b, word);
+    bool changed = false;
+    for (size_t bit = 0; bit < width; ++bit) {
+        const uint64_t newUnknown = (shiftedUnknown[bit] & ~cleared) | undefined;
+        changed |= assign(program.result[bit], word, ALL_LANES, shiftedValue[bit] & ~cleared & ~newUnknown, newUnknown);
+    }
+    return changed;
+}
+
+bool PatternSimulator::evaluateGate(const GateProgram& program, size_t word) {
+    const COMPONENT type = program.gate->getType();
+    uint64_t newHigh, newLow;
+    if (type == COMPONENT::XOR || type == COMPONENT::XNOR) {
+        uint64_t parity = 0, undefined = 0;
+        for (uint32_t input : program.inputs) {
+            parity ^= value[at(input, word)];
+            undefined |= unknown[at(input, word)];
+            if (undefined == ALL_LANES) break;
+        }
+        newHigh = parity & ~undefined;
+        newLow = ~parity & ~undefined;
+    } else {
+        // Reduce towards the controlling value, until every lane has seen one
+        const bool controlHigh = type == COMPONENT::OR || type == COMPONENT::NOR;
+        uint64_t controlled = 0, undefined = 0;
+        for (uint32_t input : program.inputs) {
+            controlled |= controlHigh ? high(input, word) : low(input, word);
+            undefined |= unknown[at(input, word)];
+            if (controlled == ALL_LANES) break;
+        }
+        const uint64_t other = ~controlled & ~undefined;
+        newHigh = controlHigh ? controlled : other;
+        newLow = controlHigh ? other : controlled;
+    }
+    if (type == COMPONENT::NAND || type == COMPONENT::NOR || type == COMPONENT::XNOR) std::swap(newHigh, newLow);
+    return assign(program.output, word, ALL_LANES, newHigh, ~(newHigh | newLow));
+}
+
+void PatternSimulator::tickDomain(DomainProgram& program, size_t word, uint64_t lanes) {
+    const size_t clock = at(program.clock, word);
+    uint64_t& previousValue = program.previousValue[word];
+    uint64_t& previousUnknown = program.previousUnknown[word];
+    const uint64_t previousHigh = previousValue & ~previousUnknown;
+    const uint64_t previousLow = ~previousValue & ~previousUnknown;
+    uint64_t edge = program.domain->getEdgeType() == EDGE_TYPE::RISING_EDGE
+        ? previousLow & high(program.clock, word)
+        : previousHigh & low(program.clock, word);
+    edge &= lanes;
+    previousValue = (previousValue & ~lanes) | (value[clock] & lanes);
+    previousUnknown = (previousUnknown & ~lanes) | (unknown[clock] & lanes);
+    if (!edge) return;
+
+    // Sample only, Q is written by commitDomain() once every clocked element has sampled
+    const ClockDomain& domain = *program.domain;
+    const auto& types = domain.getTypes();
+    const auto& inputA = domain.getInputA();
+    const auto& inputB = domain.getInputB();
+    const auto& outputs = domain.getOutputs();
+    for (size_t i = 0; i < types.size(); ++i) {
+        const size_t cell = i * words + word;
+        const uint32_t a = inputA[i];
+        const uint64_t qHigh = high(outputs[i], word);
+        uint64_t load = 0, nextValue = 0, nextUnknown = 0;
+        switch (types[i]) {
+            case FLIP_FLOP_TYPE::D_FLIP_FLOP:
+                load = edge;
+                nextValue = value[at(a, word)];
+                nextUnknown = unknown[at(a, word)];
+                break;
+            case FLIP_FLOP_TYPE::SR_FLIP_FLOP: {
+                const uint64_t set = edge & high(a, word) & low(inputB[i], word);
+                load = set | (edge & low(a, word) & high(inputB[i], word));
+                nextValue = set;
+                break;
+            }
+            case FLIP_FLOP_TYPE::JK_FLIP_FLOP: {
+                const uint64_t set = edge & high(a, word) & low(inputB[i], word);
+                const uint64_t toggle = edge & high(a, word) & high(inputB[i], word);
+                load = set | toggle | (edge & low(a, word) & high(inputB[i], word));
+                nextValue = set | (toggle & ~qHigh);
+                break;
+            }
+            case FLIP_FLOP_TYPE::T_FLIP_FLOP:
+                load = edge & high(a, word);
+                nextValue = ~qHigh;
+                break;
+        }
+        program.load[cell] = load;
+        program.nextValue[cell] = nextValue;
+        program.nextUnknown[cell] = nextUnknown;
+    }
+}
+
+void PatternSimulator::commitDomain(DomainProgram& program) {
+    const auto& outputs = program.domain->getOutputs();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        for (size_t word = 0; word < words; ++word) {
+            uint64_t& load = program.load[i * words + word];
+            if (!load) continue;
+            assign(outputs[i], word, load, program.nextValue[i * words + word], program.nextUnknown[i * words + word]);
+            load = 0;
+        }
+    }
+}
+
+void PatternSimulator::tickRam(RamProgram& program, size_t word, uint64_t lanes) {
+    const size_t clock = at(program.clock, word);
+    uint64_t& previousValue = program.previousValue[word];
+    uint64_t& previousUnknown = program.previousUnknown[word];
+    const uint64_t rising = ~previousValue & ~previousUnknown & high(program.clock, word) & lanes;
+    previousValue = (previousValue & ~lanes) | (value[clock] & lanes);
+    previousUnknown = (previousUnknown & ~lanes) | (unknown[clock] & lanes);
+
+    const uint64_t writing = rising & high(program.writeEnable, word) & ~undefinedLanes(program.address, word);
+    const SparseMemory& shared = program.ram->getMemory();
+    for (size_t lane = 0; lane < LANES_PER_WORD; ++lane) {
+        if (!((writing >> lane) & 1)) continue;
+        SparseMemory& memory = program.lanes[word * LANES_PER_WORD + lane];
+        const uint64_t address = laneAddress(program.address, word, lane);
+        memory.addPage(address / SparseMemory::PAGE_WORDS, shared.page(address / SparseMemory::PAGE_WORDS));
+        uint8_t* stored = memory.write(address);
+        std::fill_n(stored, memory.wordBytes(), 0);
+        for (size_t bit = 0; bit < program.dataIn.size(); ++bit) {
+            if ((high(program.dataIn[bit], word) >> lane) & 1) stored[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+        }
+    }
+}
+
+void PatternSimulator::tickRegister(RegisterProgram& program, size_t word, uint64_t lanes) {
+    const size_t clock = at(program.clock, word);
+    uint64_t& previousValue = program.previousValue[word];
+    uint64_t& previousUnknown = program.previousUnknown[word];
+    const uint64_t previousHigh = previousValue & ~previousUnknown;
+    const uint64_t previousLow = ~previousValue & ~previousUnknown;
+    uint64_t edge = program.reg->getEdgeType() == EDGE_TYPE::RISING_EDGE
+        ? previousLow & high(program.clock, word)
+        : previousHigh & low(program.clock, word);
+    edge &= lanes;
+    previousValue = (previousValue & ~lanes) | (value[clock] & lanes);
+    previousUnknown = (previousUnknown & ~lanes) | (unknown[clock] & lanes);
+
+    const bool hasEnable = program.enable != Netlist::NO_WIRE;
+    const uint64_t loading = edge & (hasEnable ? high(program.enable, word) : ALL_LANES);
+    const uint64_t maybe = hasEnable ? edge & unknown[at(program.enable, word)] : 0;
+    program.load[word] = loading | maybe;
+    if (!loading && !maybe) return;
+    // Sample only, Q is written by commitRegister()
+    for (size_t bit = 0; bit < program.outputQ.size(); ++bit) {
+        const size_t d = at(program.inputD[bit], word), q = at(program.outputQ[bit], word);
+        // Lanes with an undefined enable keep only the bits D and Q agree on
+        const uint64_t mixed = maybe & (unknown[d] | unknown[q] | (value[d] ^ value[q]));
+        program.nextValue[bit * words + word] = (loading & value[d]) | (maybe & value[q] & ~mixed);
+        program.nextUnknown[bit * words + word] = (loading & unknown[d]) | mixed;
+    }
+}
+
+void PatternSimulator::commitRegister(RegisterProgram& program) {
+    for (size_t word = 0; word < words; ++word) {
+        if (!program.load[word]) continue;
+        for (size_t bit = 0; bit < program.outputQ.size(); ++bit) {
+            assign(program.outputQ[bit], word, program.load[word], program.nextValue[bit * words + word], program.nextUnknown[bit * words + word]);
+        }
+        program.load[word] = 0;
+    }
+}
+
+void PatternSimulator::dumpRams(size_t lane) const {
+    for (const RamProgram& program : rams) program.ram->dump(program.lanes[std::min(lane, program.lanes.size() - 1)]);
+}
+
+void PatternSimulator::settle() {
+    // Clock domains first, then RAM write ports, then registers, the order the event-driven kernel wakes them in
+    const size_t ramsStart = domains.size(), registersStart = ramsStart + rams.size();
+    const size_t clocked = registersStart + registers.size();
+    std::vector<uint64_t> triggered(clocked * words);
+    const size_t limit = MAX_FEEDBACK_PASSES * (clocked + 1);
+    for (size_t delta = 0; delta < limit; ++delta) {
+        evaluateNodes();
+
+        // Like the event-driven kernel, flip-flops run in a delta after the combinational logic,
+        // and only in lanes whose clock moved since they last looked at it.
+        bool any = false;
+        for (size_t i = 0; i < clocked; ++i) {
+            uint32_t clock;
+            const std::vector<uint64_t>* previousValue;
+            const std::vector<uint64_t>* previousUnknown;
+            if (i < ramsStart) {
+                clock = domains[i].clock;
+                previousValue = &domains[i].previousValue;
+                previousUnknown = &domains[i].previousUnknown;
+            } else if (i < registersStart) {
+                clock = rams[i - ramsStart].clock;
+                previousValue = &rams[i - ramsStart].previousValue;
+                previousUnknown = &rams[i - ramsStart].previousUnknown;
+            } else {
+                clock = registers[i - registersStart].clock;
+                previousValue = &registers[i - registersStart].previousValue;
+                previousUnknown = &registers[i - registersStart].previousUnknown;
+            }
+            for (size_t word = 0; word < words; ++word) {
+                const size_t state = at(clock, word);
+                uint64_t lanes = firstSettle ? ALL_LANES
+                    : (value[state] ^ (*previousValue)[word]) | (unknown[state] ^ (*previousUnknown)[word]);
+                triggered[i * words + word] = lanes;
+                any |= lanes != 0;
+            }
+        }
+        firstSettle = false;
+        if (!any) return;
+
+        // Everything samples, then everything writes
+        for (size_t i = 0; i < clocked; ++i) {
+            for (size_t word = 0; word < words; ++word) {
+                const uint64_t lanes = triggered[i * words + word];
+                if (!lanes) continue;
+                if (i < ramsStart) tickDomain(domains[i], word, lanes);
+                else if (i < registersStart) tickRam(rams[i - ramsStart], word, lanes);
+                else tickRegister(registers[i - registersStart], word, lanes);
+            }
+        }
+        for (DomainProgram& program : domains) commitDomain(program);
+        for (RegisterProgram& program : registers) commitRegister(program);
+    }
+    std::cerr << "Flip-flops did not settle in every lane. Possible clock loop." << std::endl;
+}
+
+void PatternSimulator::record() {
+    // Named wires come first in the state array, so this is a straight copy of the front of both planes
+    traceValue.insert(traceValue.end(), value.begin(), value.begin() + tracedWires * words);
+    traceUnknown.insert(traceUnknown.end(), unknown.begin(), unknown.begin() + tracedWires * words);
+    ++cycles;
+}
+
+std::unordered_map<std::string, std::vector<WIRE_STATE>> PatternSimulator::laneWaveform(size_t lane) const {
+    std::unordered_map<std::string, std::vector<WIRE_STATE>> result;
+    const size_t word = lane / LANES_PER_WORD, bit = lane % LANES_PER_WORD;
+    const size_t stride = tracedWires * words;
+    for (uint32_t w = 0; w < tracedWires; ++w) {
+        std::vector<WIRE_STATE>& states = result[Wire::wires[w]->getName()];
+        states.reserve(cycles);
+        for (size_t cycle = 0; cycle < cycles; ++cycle) {
+            const size_t i = cycle * stride + at(w, word);
+            states.push_back(laneState(traceValue[i], traceUnknown[i], bit));
+        }
+    }
+    return result;
+}
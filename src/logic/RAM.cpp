@@ -0,0 +1,125 @@
+#include "../includes/RAM.h"
+#include "../includes/MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+std::vector<RAM*> RAM::rams;
+
+void SparseMemory::store(uint64_t address, const uint8_t* bytes, size_t count) {
+    const size_t size = pageBytes();
+    while (count > 0) {
+        const size_t offset = static_cast<size_t>(address % size);
+        const size_t take = std::min(count, size - offset);
+        std::memcpy(addPage(address / size) + offset, bytes, take);
+        address += take;
+        bytes += take;
+        count -= take;
+    }
+}
+
+uint8_t* SparseMemory::addPage(uint64_t index, const uint8_t* initial) {
+    std::unique_ptr<uint8_t[]>& stored = pages[index];
+    if (!stored) {
+        stored.reset(new uint8_t[pageBytes()]);
+        if (initial) std::memcpy(stored.get(), initial, pageBytes());
+        else std::memset(stored.get(), 0, pageBytes());
+    }
+    return stored.get();
+}
+
+std::vector<MemoryImage::Chunk> SparseMemory::chunks() const {
+    std::vector<MemoryImage::Chunk> result;
+    result.reserve(pages.size());
+    for (const auto& [index, bytes] : pages) result.push_back({index * pageBytes(), bytes.get(), pageBytes()});
+    std::sort(result.begin(), result.end(), [](const MemoryImage::Chunk& a, const MemoryImage::Chunk& b) { return a.address < b.address; });
+    return result;
+}
+
+RAM::RAM(std::string name, Wire* clock, Wire* writeEnable, const std::vector<Wire*>& addressBus, const std::vector<Wire*>& dataIn,
+         const std::vector<Wire*>& dataOut, const std::string preloadFile, const std::string dumpFile)
+    : name(name), clock(clock), writeEnable(writeEnable), addressBus(addressBus), dataIn(dataIn), dataOut(dataOut),
+      preloadFile(preloadFile), dumpFile(dumpFile), memory(std::max<size_t>(1, (dataOut.size() + 7) / 8)) {
+    std::cout << "Creating RAM: " << name << " with " << addressBus.size() << " address and " << dataOut.size() << " data wires" << std::endl;
+    if (!preloadFile.empty()) {
+        MappedFile file;
+        if (!file.open(preloadFile)) {
+            std::cerr << "Error opening memory file: " << preloadFile << std::endl;
+            return;
+        }
+        if (!MemoryImage::read(preloadFile, file, memory.wordBytes(), [&](uint64_t address, const uint8_t* bytes, size_t count) {
+                memory.store(address, bytes, count);
+            }))
+            return;
+        std::cout << "RAM " << name << " preloaded with " << memory.pageCount() << " pages from " << preloadFile << std::endl;
+    }
+    consecutiveAddress = WireBus::consecutive(addressBus);
+    consecutiveDataIn = WireBus::consecutive(dataIn);
+    consecutiveDataOut = WireBus::consecutive(dataOut);
+    rams.push_back(this);
+}
+
+void RAM::tick() {
+    bool defined;
+    const uint64_t address = WireBus::value(addressBus, consecutiveAddress, defined);
+    if (!defined) {
+        for (size_t first = 0; first < dataOut.size(); first += 64) WireBus::drive(dataOut, consecutiveDataOut, first, 0, UINT64_MAX);
+        stale = true;
+        return;
+    }
+    if (address == lastAddress && !stale) return;
+    lastAddress = address;
+    stale = false;
+
+    const uint8_t* stored = memory.find(address);
+    for (size_t first = 0; first < dataOut.size(); first += 64) {
+        WireBus::drive(dataOut, consecutiveDataOut, first, stored ? MemoryImage::bits(stored, memory.wordBytes(), first) : 0, 0);
+    }
+}
+
+void RAM::clockChanged() {
+    const WIRE_STATE current = clock->getState();
+    const bool rising = previousClock == WIRE_STATE::LOGIC_LOW && current == WIRE_STATE::LOGIC_HIGH;
+    previousClock = current;
+    if (!rising || !writeEnable->isLogicHigh()) return;
+
+    // There is no telling which word an undefined address would write, so none is
+    bool defined;
+    const uint64_t address = WireBus::value(addressBus, consecutiveAddress, defined);
+    if (!defined) return;
+    uint8_t* stored = memory.write(address);
+    std::memset(stored, 0, memory.wordBytes());
+    for (size_t first = 0; first < dataIn.size(); first += 64) {
+        uint64_t value, unknown;
+        WireBus::read(dataIn, consecutiveDataIn, first, value, unknown);
+        MemoryImage::setBits(stored, memory.wordBytes(), first, value);
+    }
+    // Show the new word if it's the one being read, once the write port commits
+    if (address == lastAddress) written = true;
+}
+
+void RAM::showWritten() {
+    if (!written) return;
+    written = false;
+    stale = true;
+    tick();
+}
+
+bool RAM::dump() const {
+    if (dumpFile.empty()) return true;
+    std::cout << "RAM " << name << " dumped to " << dumpFile << std::endl;
+    return MemoryImage::write(dumpFile, memory.wordBytes(), memory.chunks());
+}
+
+bool RAM::dump(const SparseMemory& overlay) const {
+    if (dumpFile.empty()) return true;
+    std::map<uint64_t, MemoryImage::Chunk> merged;
+    for (const MemoryImage::Chunk& chunk : memory.chunks()) merged[chunk.address] = chunk;
+    for (const MemoryImage::Chunk& chunk : overlay.chunks()) merged[chunk.address] = chunk;
+    std::vector<MemoryImage::Chunk> chunks;
+    chunks.reserve(merged.size());
+    for (const auto& [address, chunk] : merged) chunks.push_back(chunk);
+    std::cout << "RAM " << name << " dumped to " << dumpFile << std::endl;
+    return MemoryImage::write(dumpFile, memory.wordBytes(), chunks);
+}
@@ -1,3 +1,72 @@
 #include "../includes/ROM.h"
+#include <cstring>
+#include <iostream>
 
-std::vector<ROM*> ROM::roms;
\ No newline at end of file
+std::vector<ROM*> ROM::roms;
+
+ROM::ROM(std::string name, const std::vector<Wire*>& addressBus, const std::vector<Wire*>& outputBus, const std::string filename)
+    : addressBus(addressBus), outputBus(outputBus), name(name), filename(filename), wordSize((outputBus.size() + 7) / 8) {
+    if (wordSize == 0) wordSize = 1;
+    if (!load()) return;
+    prepare();
+    std::cout << "ROM " << name << " loaded with " << depth() << " entries from " << filename << std::endl;
+}
+
+ROM::ROM(std::string name, const std::vector<Wire*>& addressBus, const std::vector<Wire*>& outputBus, const std::string filename,
+         const uint8_t* image, size_t imageSize)
+    : addressBus(addressBus), outputBus(outputBus), name(name), filename(filename), wordSize((outputBus.size() + 7) / 8) {
+    if (wordSize == 0) wordSize = 1;
+    memory.assign(image, image + imageSize);
+    data = memory.data();
+    size = memory.size();
+    prepare();
+    std::cout << "ROM " << name << " loaded with " << depth() << " entries from " << filename << std::endl;
+}
+
+void ROM::prepare() {
+    consecutiveAddress = WireBus::consecutive(addressBus);
+    consecutiveOutput = WireBus::consecutive(outputBus);
+    roms.push_back(this);
+}
+
+bool ROM::load() {
+    if (!mapped.open(filename)) {
+        std::cerr << "Error opening memory file: " << filename << std::endl;
+        return false;
+    }
+    if (MemoryImage::formatOf(filename, &mapped) == MemoryImage::FORMAT::BINARY) {
+        // Used in place: pages are only read from disk when an address on them is
+        data = mapped.data();
+        size = mapped.size() - mapped.size() % wordSize;
+        return true;
+    }
+    const bool loaded = MemoryImage::read(filename, mapped, wordSize, [&](uint64_t address, const uint8_t* bytes, size_t count) {
+        if (memory.size() < address + count) memory.resize(address + count, 0);
+        std::memcpy(memory.data() + address, bytes, count);
+    });
+    memory.resize((memory.size() + wordSize - 1) / wordSize * wordSize, 0);
+    // Text formats are parsed into memory, the mapping is no longer needed
+    mapped.close();
+    data = memory.data();
+    size = memory.size();
+    return loaded;
+}
+
+void ROM::tick() {
+    bool defined;
+    const uint64_t address = WireBus::value(addressBus, consecutiveAddress, defined);
+    if (!defined) {
+        // Could be any word
+        for (size_t first = 0; first < outputBus.size(); first += 64) WireBus::drive(outputBus, consecutiveOutput, first, 0, UINT64_MAX);
+        lastAddress = UINT64_MAX;
+        return;
+    }
+    if (address == lastAddress) return;
+    lastAddress = address;
+
+    const uint8_t* stored = word(address);
+    if (!stored) return;
+    for (size_t first = 0; first < outputBus.size(); first += 64) {
+        WireBus::drive(outputBus, consecutiveOutput, first, MemoryImage::bits(stored, wordSize, first), 0);
+    }
+}
@@ -0,0 +1,58 @@
+#include "../includes/ReductionGate.h"
+#include <algorithm>
+#include <iostream>
+
+std::vector<ReductionGate*> ReductionGate::gates;
+
+bool ReductionGate::create(COMPONENT type, const std::string& name, std::vector<Wire*> inputs, Wire* output) {
+    if (inputs.size() < 2 || type == COMPONENT::NOT) return false;
+    if (inputs.size() == 2) {
+        Component* component = Component::create(type, name);
+        component->setInput(inputs[0], inputs[1]);
+        component->setOutput(output);
+    } else {
+        Arena::circuit.create<ReductionGate>(type, name, std::move(inputs), output);
+    }
+    return true;
+}
+
+ReductionGate::ReductionGate(COMPONENT type, std::string name, std::vector<Wire*> inputs, Wire* output)
+    : type(type), name(name), inputs(std::move(inputs)), output(output) {
+    std::cout << "Creating " << Component::typeName(type) << " Gate: " << name << " with " << this->inputs.size() << " inputs" << std::endl;
+    if (this->inputs.size() < 2 || !output || type == COMPONENT::NOT) {
+        throw std::invalid_argument("A reduction gate needs an output and at least two inputs.");
+    }
+    consecutiveInputs = WireBus::consecutive(this->inputs);
+    gates.push_back(this);
+}
+
+void ReductionGate::tick() {
+    // AND and NAND look for a low input, OR and NOR for a high one
+    const bool parity = type == COMPONENT::XOR || type == COMPONENT::XNOR;
+    const bool controlHigh = type == COMPONENT::OR || type == COMPONENT::NOR;
+    const bool inverted = type == COMPONENT::NAND || type == COMPONENT::NOR || type == COMPONENT::XNOR;
+    bool result = parity ? false : !controlHigh, undefined = false;
+    for (size_t first = 0; first < inputs.size(); first += 64) {
+        const size_t count = std::min<size_t>(64, inputs.size() - first);
+        const uint64_t mask = count < 64 ? (uint64_t(1) << count) - 1 : UINT64_MAX;
+        uint64_t value, unknown;
+        WireBus::read(inputs, consecutiveInputs, first, value, unknown);
+        if (parity) {
+            if (unknown) {
+                undefined = true;
+                break;
+            }
+            result ^= __builtin_popcountll(value) & 1;
+            continue;
+        }
+        // A controlling input decides the output even if others are undefined
+        const uint64_t controlling = (controlHigh ? value : ~value & ~unknown) & mask;
+        if (controlling) {
+            result = controlHigh;
+            undefined = false;
+            break;
+        }
+        undefined |= unknown != 0;
+    }
+    output->setState(undefined ? WIRE_STATE::LOGIC_UNDEFINED : result != inverted ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW);
+}
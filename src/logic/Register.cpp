@@ -0,0 +1,49 @@
+#include "../includes/Register.h"
+#include <iostream>
+
+std::vector<Register*> Register::registers;
+
+Register::Register(std::string name, Wire* clock, Wire* enable, const std::vector<Wire*>& inputD, const std::vector<Wire*>& outputQ,
+                   EDGE_TYPE edgeType)
+    : name(name), clock(clock), enable(enable), inputD(inputD), outputQ(outputQ), edgeType(edgeType) {
+    std::cout << "Creating Register: " << name << " with " << outputQ.size() << " wires" << std::endl;
+    if (!clock || inputD.empty() || inputD.size() != outputQ.size()) {
+        throw std::invalid_argument("Register needs a clock and D and Q buses of the same width.");
+    }
+    consecutiveD = WireBus::consecutive(inputD);
+    consecutiveQ = WireBus::consecutive(outputQ);
+    next.resize(2 * ((outputQ.size() + 63) / 64));
+    registers.push_back(this);
+}
+
+void Register::tick() {
+    const WIRE_STATE current = clock->getState();
+    const bool edge = edgeType == EDGE_TYPE::RISING_EDGE
+        ? previousClock == WIRE_STATE::LOGIC_LOW && current == WIRE_STATE::LOGIC_HIGH
+        : previousClock == WIRE_STATE::LOGIC_HIGH && current == WIRE_STATE::LOGIC_LOW;
+    previousClock = current;
+    if (!edge) return;
+    const WIRE_STATE enabled = enable ? enable->getState() : WIRE_STATE::LOGIC_HIGH;
+    if (enabled == WIRE_STATE::LOGIC_LOW) return;
+
+    for (size_t first = 0, chunk = 0; first < outputQ.size(); first += 64, chunk += 2) {
+        uint64_t& value = next[chunk];
+        uint64_t& unknown = next[chunk + 1];
+        WireBus::read(inputD, consecutiveD, first, value, unknown);
+        if (enabled == WIRE_STATE::LOGIC_UNDEFINED) {
+            uint64_t held, heldUnknown;
+            WireBus::read(outputQ, consecutiveQ, first, held, heldUnknown);
+            unknown |= heldUnknown | (value ^ held);
+            value &= ~unknown;
+        }
+    }
+    loaded = true;
+}
+
+void Register::commit() {
+    if (!loaded) return;
+    loaded = false;
+    for (size_t first = 0, chunk = 0; first < outputQ.size(); first += 64, chunk += 2) {
+        WireBus::drive(outputQ, consecutiveQ, first, next[chunk], next[chunk + 1]);
+    }
+}
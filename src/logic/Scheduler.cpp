@@ -0,0 +1,251 @@
+#include "../includes/Scheduler.h"
+#include "../includes/Netlist.h"
+#include "../includes/FlipFlop.h"
+#include "../includes/RAM.h"
+#include "../includes/Register.h"
+#include "../includes/ThreadPool.h"
+#include <algorithm>
+#include <iostream>
+
+std::vector<std::vector<uint32_t>> Scheduler::levelBuckets;
+std::vector<uint8_t> Scheduler::dirty;
+size_t Scheduler::lowestDirtyLevel = 0;
+size_t Scheduler::currentLevel = Scheduler::NO_LEVEL;
+std::vector<Schedulable*> Scheduler::sequentialQueue;
+size_t Scheduler::evaluations = 0;
+std::vector<LoopStatistics> Scheduler::loopStatistics;
+std::unique_ptr<ThreadPool> Scheduler::pool;
+std::vector<std::vector<uint32_t>> Scheduler::chunkChanges;
+thread_local std::vector<uint32_t>* Scheduler::deferredChanges = nullptr;
+
+// Upper bound on passes over a combinational loop in a single settle() before we assume it is oscillating.
+static constexpr size_t MAX_LOOP_PASSES = 64;
+
+// Nodes per chunk when a level is evaluated in parallel. Narrower levels aren't worth waking the pool for.
+static constexpr size_t PARALLEL_CHUNK = 256;
+
+void Scheduler::wireChanged(uint32_t wire) {
+    if (deferredChanges) {
+        deferredChanges->push_back(wire);
+        return;
+    }
+    const Netlist& netlist = Netlist::current;
+    if (wire + 1 >= netlist.fanoutStart.size()) return; // Not compiled yet (elaboration)
+
+    for (uint32_t i = netlist.fanoutStart[wire]; i < netlist.fanoutStart[wire + 1]; ++i) {
+        uint32_t node = netlist.fanout[i];
+        if (dirty[node]) continue;
+        dirty[node] = 1;
+        uint32_t nodeLevel = netlist.level[node];
+        levelBuckets[nodeLevel].push_back(node);
+        if (nodeLevel < lowestDirtyLevel) lowestDirtyLevel = nodeLevel;
+    }
+    // Drivers further down the file sit on higher levels (see Netlist::laterDrivers) and get the last word again
+    if (currentLevel != NO_LEVEL) {
+        for (uint32_t i = netlist.laterDriverStart[wire]; i < netlist.laterDriverStart[wire + 1]; ++i) {
+            uint32_t node = netlist.laterDrivers[i];
+            uint32_t nodeLevel = netlist.level[node];
+            if (dirty[node] || nodeLevel <= currentLevel) continue;
+            dirty[node] = 1;
+            levelBuckets[nodeLevel].push_back(node);
+        }
+    }
+    for (uint32_t i = netlist.clockFanoutStart[wire]; i < netlist.clockFanoutStart[wire + 1]; ++i) {
+        schedule(netlist.clockFanout[i]);
+    }
+}
+
+void Scheduler::schedule(Schedulable* node) {
+    if (node->queued) return;
+    node->queued = true;
+    sequentialQueue.push_back(node);
+}
+
+void Scheduler::prepare() {
+    const Netlist& netlist = Netlist::current;
+    levelBuckets.assign(netlist.levelCount(), {});
+    dirty.assign(netlist.nodeCount(), 0);
+    lowestDirtyLevel = levelBuckets.size();
+    loopStatistics.assign(netlist.loopCount(), {});
+}
+
+void Scheduler::scheduleAll() {
+    const Netlist& netlist = Netlist::current;
+    for (size_t level = 0; level < netlist.levelCount(); ++level) {
+        auto& bucket = levelBuckets[level];
+        for (uint32_t node = netlist.levelStart[level]; node < netlist.levelStart[level + 1]; ++node) {
+            if (!dirty[node]) {
+                dirty[node] = 1;
+                bucket.push_back(node);
+            }
+        }
+    }
+    lowestDirtyLevel = 0;
+    for (ClockDomain* domain : ClockDomain::domains) {
+        schedule(domain);
+    }
+    for (RAM* ram : RAM::rams) {
+        schedule(ram->clockPort());
+    }
+    for (Register* reg : Register::registers) {
+        schedule(reg);
+    }
+}
+
+void Scheduler::settle() {
+    Netlist& netlist = Netlist::current;
+    size_t settleEvaluations = 0;
+    std::vector<Schedulable*> triggered;
+
+    while (lowestDirtyLevel < levelBuckets.size() || !sequentialQueue.empty()) {
+        // Evaluating level L can only dirty levels above L, so one ascending pass is enough.
+        // Cyclic levels are the exception: they can refill themselves.
+        for (size_t level = lowestDirtyLevel; level < levelBuckets.size(); ++level) {
+            auto& bucket = levelBuckets[level];
+            currentLevel = level;
+            if (netlist.cyclicLevel[level]) {
+                settleEvaluations += settleLoops(bucket);
+                continue;
+            }
+            settleEvaluations += bucket.size();
+            if (pool && bucket.size() >= 2 * PARALLEL_CHUNK) {
+                evaluateLevel(bucket);
+                continue;
+            }
+            for (uint32_t node : bucket) {
+                dirty[node] = 0;
+                netlist.evaluateNode(node);
+            }
+            bucket.clear();
+        }
+        lowestDirtyLevel = levelBuckets.size();
+        currentLevel = NO_LEVEL;
+
+        // Flip-flops triggered by this delta: all of them sample, then all of them write.
+        // Anything they trigger in turn runs in the next delta.
+        triggered.swap(sequentialQueue);
+        for (Schedulable* node : triggered) {
+            node->queued = false;
+            node->evaluate();
+            ++settleEvaluations;
+        }
+        for (Schedulable* node : triggered) node->commit();
+        triggered.clear();
+    }
+    evaluations += settleEvaluations;
+}
+
+size_t Scheduler::settleLoops(std::vector<uint32_t>& bucket) {
+    Netlist& netlist = Netlist::current;
+    size_t settleEvaluations = 0;
+    // Loops of one level don't feed each other, so each woken loop is settled once, in the order they woke up.
+    // Its other nodes come by again with nothing left to do.
+    std::vector<uint32_t> settled;
+    for (size_t i = 0; i < bucket.size(); ++i) {
+        dirty[bucket[i]] = 0;
+        const uint32_t k = netlist.loop[bucket[i]];
+        if (std::find(settled.begin(), settled.end(), k) != settled.end()) continue;
+        settled.push_back(k);
+        const size_t passes = settleLoop(k);
+        settleEvaluations += passes * netlist.loopSize(k);
+
+        LoopStatistics& statistics = loopStatistics[k];
+        ++statistics.settles;
+        statistics.passes += passes;
+        statistics.mostPasses = std::max(statistics.mostPasses, passes);
+    }
+    bucket.clear();
+    return settleEvaluations;
+}
+
+bool Scheduler::loopPass(uint32_t k) {
+    Netlist& netlist = Netlist::current;
+    const uint32_t first = netlist.loopNodeStart[k], last = netlist.loopNodeStart[k + 1];
+    for (uint32_t m = first; m < last; ++m) {
+        dirty[netlist.loopNodes[m]] = 0;
+        netlist.evaluateNode(netlist.loopNodes[m]);
+    }
+    // A node woken again read a wire that changed after it ran
+    for (uint32_t m = first; m < last; ++m) {
+        if (dirty[netlist.loopNodes[m]]) return true;
+    }
+    return false;
+}
+
+size_t Scheduler::settleLoop(uint32_t k) {
+    Netlist& netlist = Netlist::current;
+    WireStates& states = Wire::states;
+    size_t passes = 0;
+    bool unsettled = true;
+    for (size_t pass = 0; pass < MAX_LOOP_PASSES && unsettled; ++pass, ++passes) unsettled = loopPass(k);
+    if (!unsettled) return passes;
+
+    // One more pass shows which wires keep changing
+    const uint32_t firstWire = netlist.loopWireStart[k], lastWire = netlist.loopWireStart[k + 1];
+    std::vector<WIRE_STATE> before;
+    for (uint32_t w = firstWire; w < lastWire; ++w) before.push_back(states.get(netlist.loopWires[w]));
+    loopPass(k);
+    ++passes;
+    std::vector<uint32_t> changed;
+    for (uint32_t w = firstWire; w < lastWire; ++w) {
+        if (states.get(netlist.loopWires[w]) != before[w - firstWire]) changed.push_back(netlist.loopWires[w]);
+    }
+    if (changed.empty()) return passes; // Settled just in time
+
+    // Reported once per run, the statistics count the rest
+    if (loopStatistics[k].oscillations++ == 0) netlist.reportOscillation(k, MAX_LOOP_PASSES, changed);
+    // Restart with all its wires undefined. The wires that really oscillate stay undefined, and a loop that
+    // doesn't settle from there either is left as it is.
+    for (uint32_t w = firstWire; w < lastWire; ++w) {
+        if (states.set(netlist.loopWires[w], WIRE_STATE::LOGIC_UNDEFINED)) wireChanged(netlist.loopWires[w]);
+    }
+    unsettled = true;
+    for (size_t pass = 0; pass < MAX_LOOP_PASSES && unsettled; ++pass, ++passes) unsettled = loopPass(k);
+    return passes;
+}
+
+void Scheduler::evaluateLevel(std::vector<uint32_t>& bucket) {
+    Netlist& netlist = Netlist::current;
+    const size_t chunks = (bucket.size() + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+    if (chunkChanges.size() < chunks) chunkChanges.resize(chunks);
+
+    Wire::states.concurrent = true;
+    pool->run(chunks, [&](size_t chunk) {
+        std::vector<uint32_t>& changes = chunkChanges[chunk];
+        changes.clear();
+        deferredChanges = &changes;
+        const size_t end = std::min(bucket.size(), (chunk + 1) * PARALLEL_CHUNK);
+        for (size_t i = chunk * PARALLEL_CHUNK; i < end; ++i) {
+            dirty[bucket[i]] = 0;
+            netlist.evaluateNode(bucket[i]);
+        }
+        deferredChanges = nullptr;
+    });
+    Wire::states.concurrent = false;
+
+    // Replay in bucket order, exactly as the serial loop would have called wireChanged()
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        for (uint32_t wire : chunkChanges[chunk]) wireChanged(wire);
+    }
+    bucket.clear();
+}
+
+void Scheduler::setThreads(size_t threads) {
+    if (threads == getThreads()) return;
+    pool.reset(threads > 1 ? new ThreadPool(threads) : nullptr);
+    std::cout << "Simulation threads: " << getThreads() << std::endl;
+}
+
+size_t Scheduler::getThreads() {
+    return pool ? pool->size() : 1;
+}
+
+void Scheduler::clear() {
+    levelBuckets.clear();
+    dirty.clear();
+    lowestDirtyLevel = 0;
+    currentLevel = NO_LEVEL;
+    sequentialQueue.clear();
+    evaluations = 0;
+    loopStatistics.clear();
+}
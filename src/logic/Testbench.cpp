@@ -0,0 +1,117 @@
+#include "../includes/Testbench.h"
+#include "../includes/PatternSimulator.h"
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+// Cycle of an @<cycle>... word. The number ends at the lane selector or the end of the word.
+static bool parseCycle(std::string_view word, size_t& cycle, std::string_view& rest) {
+    if (word.size() < 2 || word[0] != '@') return false;
+    const char* end = word.data() + word.size();
+    auto [last, error] = std::from_chars(word.data() + 1, end, cycle);
+    if (error != std::errc() || last == word.data() + 1) return false;
+    rest = word.substr(last - word.data());
+    return rest.empty() || rest[0] == '[';
+}
+
+// True if the @ cycles of the file never go down, so it can be streamed
+static bool cyclesAscending(std::ifstream& file) {
+    std::string line;
+    Tokenizer words;
+    size_t previous = 0, cycle;
+    std::string_view rest;
+    while (std::getline(file, line)) {
+        words.reset(line);
+        if (!words.nextLine() || !parseCycle(words[0], cycle, rest)) continue;
+        if (cycle < previous) return false;
+        previous = cycle;
+    }
+    return true;
+}
+
+Testbench::Testbench(const std::string& path) : words({}, path) {
+    if (path.empty()) return;
+    file.open(path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open testbench file: " << path << std::endl;
+        return;
+    }
+    streaming = cyclesAscending(file);
+    file.clear();
+    file.seekg(0);
+    if (streaming) {
+        hasLookahead = read(lookahead);
+        return;
+    }
+    Stimulus stimulus;
+    while (read(stimulus)) sorted.push_back(stimulus);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Stimulus& a, const Stimulus& b) { return a.cycle < b.cycle; });
+    file.close();
+}
+
+const std::vector<Testbench::Stimulus>& Testbench::at(size_t cycle) {
+    current.clear();
+    if (streaming) {
+        // Stimuli of cycles that were never asked for are dropped
+        while (hasLookahead && lookahead.cycle <= cycle) {
+            if (lookahead.cycle == cycle) current.push_back(lookahead);
+            hasLookahead = read(lookahead);
+        }
+    } else {
+        for (; next < sorted.size() && sorted[next].cycle <= cycle; ++next) {
+            if (sorted[next].cycle == cycle) current.push_back(sorted[next]);
+        }
+    }
+    return current;
+}
+
+bool Testbench::read(Stimulus& stimulus) {
+    while (std::getline(file, line)) {
+        words.reset(line, ++lineNumber);
+        if (!words.nextLine() || words[0][0] != '@') continue;
+
+        std::string_view lanes;
+        if (!parseCycle(words[0], stimulus.cycle, lanes)) {
+            words.error(0, "invalid cycle " + std::string(words[0]));
+            continue;
+        }
+        // Optional lane selector for pattern-parallel runs: @<cycle>[<lane>] or @<cycle>[<high>:<low>]
+        stimulus.firstLane = 0;
+        stimulus.lastLane = INT_MAX;
+        if (!lanes.empty()) {
+            int high = -1, low;
+            const char* end = lanes.data() + lanes.size();
+            auto parsed = std::from_chars(lanes.data() + 1, end, high);
+            low = high;
+            if (parsed.ec == std::errc() && parsed.ptr < end && *parsed.ptr == ':') parsed = std::from_chars(parsed.ptr + 1, end, low);
+            if (high < low) std::swap(high, low);
+            // The selector has to end with ] and the word with it
+            if (parsed.ec != std::errc() || parsed.ptr + 1 != end || *parsed.ptr != ']' || low < 0 ||
+                high >= static_cast<int>(PatternSimulator::MAX_LANES)) {
+                words.error(0, "invalid lane selector " + std::string(words[0]));
+                continue;
+            }
+            stimulus.firstLane = low;
+            stimulus.lastLane = high;
+        }
+
+        if (!Tokenizer::equalsLower(words[1], "set")) {
+            words.error(1, "unknown testbench command " + std::string(words[1]));
+            continue;
+        }
+        if (!Tokenizer::equalsLower(words[3], "high") && !Tokenizer::equalsLower(words[3], "low")) {
+            words.error(3, "invalid state for wire " + std::string(words[2]));
+            continue;
+        }
+        wireName.assign(words[2]);
+        auto wire = Wire::wireMap.find(wireName);
+        if (wire == Wire::wireMap.end() || !wire->second) {
+            words.error(2, "unknown wire " + wireName);
+            continue;
+        }
+        stimulus.wire = wire->second->getIndex();
+        stimulus.state = Tokenizer::equalsLower(words[3], "high") ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW;
+        return true;
+    }
+    return false;
+}
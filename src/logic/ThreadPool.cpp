@@ -0,0 +1,72 @@
+#include "../includes/ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) : slices(std::max<size_t>(1, threads)) {
+    for (size_t participant = 1; participant < slices.size(); ++participant) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, participant);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t chunks, const std::function<void(size_t)>& job) {
+    if (chunks == 0) return;
+    if (workers.empty() || chunks == 1) {
+        for (size_t chunk = 0; chunk < chunks; ++chunk) job(chunk);
+        return;
+    }
+
+    const size_t participants = slices.size();
+    for (size_t p = 0; p < participants; ++p) {
+        slices[p].next.store(chunks * p / participants, std::memory_order_relaxed);
+        slices[p].end = chunks * (p + 1) / participants;
+    }
+    busy.store(workers.size(), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &job;
+        ++generation;
+    }
+    wake.notify_all();
+
+    work(0);
+    while (busy.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    task = nullptr;
+}
+
+void ThreadPool::work(size_t participant) {
+    const size_t participants = slices.size();
+    // Own slice first, then steal from the others in turn
+    for (size_t i = 0; i < participants; ++i) {
+        Slice& slice = slices[(participant + i) % participants];
+        for (size_t chunk = slice.next.fetch_add(1, std::memory_order_relaxed); chunk < slice.end;
+             chunk = slice.next.fetch_add(1, std::memory_order_relaxed)) {
+            (*task)(chunk);
+        }
+    }
+}
+
+void ThreadPool::workerLoop(size_t participant) {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        work(participant);
+        busy.fetch_sub(1, std::memory_order_release);
+    }
+}
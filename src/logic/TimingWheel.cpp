@@ -0,0 +1,44 @@
+#include "../includes/TimingWheel.h"
+
+TimingWheel::TimingWheel(const std::vector<ClockTiming>& timings) : timings(timings), slots(SLOTS) {
+    for (uint32_t clock = 0; clock < timings.size(); ++clock) schedule(0, clock);
+}
+
+size_t TimingWheel::next() const {
+    // Walk the bitmap from now's bucket around to the one before it
+    const size_t start = now % SLOTS;
+    for (size_t scanned = 0; scanned < SLOTS;) {
+        const size_t slot = (start + scanned) % SLOTS;
+        const uint64_t bits = occupied[slot / 64] >> (slot % 64);
+        if (bits) return now + scanned + static_cast<size_t>(__builtin_ctzll(bits));
+        scanned += 64 - slot % 64;
+    }
+    // Everything in the heap is beyond the wheel, so it only matters once the wheel is empty
+    return later.empty() ? SIZE_MAX : later.top().first;
+}
+
+const std::vector<uint32_t>& TimingWheel::advance(size_t cycle) {
+    now = cycle;
+    while (!later.empty() && later.top().first < now + SLOTS) {
+        schedule(later.top().first, later.top().second);
+        later.pop();
+    }
+    const size_t slot = cycle % SLOTS;
+    due.clear();
+    if (occupied[slot / 64] >> (slot % 64) & 1) {
+        due.swap(slots[slot]);
+        occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+    for (uint32_t clock : due) schedule(timings[clock].nextEdge(cycle), clock);
+    return due;
+}
+
+void TimingWheel::schedule(size_t cycle, uint32_t clock) {
+    if (cycle >= now + SLOTS) {
+        later.emplace(cycle, clock);
+        return;
+    }
+    const size_t slot = cycle % SLOTS;
+    slots[slot].push_back(clock);
+    occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+}
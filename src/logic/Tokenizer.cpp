@@ -0,0 +1,70 @@
+#include "../includes/Tokenizer.h"
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static bool isNameCharacter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool Tokenizer::nextLine() {
+    words.clear();
+    while (position < text.size()) {
+        const char* start = text.data() + position;
+        const char* end = static_cast<const char*>(std::memchr(start, '\n', text.size() - position));
+        const size_t length = end ? static_cast<size_t>(end - start) : text.size() - position;
+        lineText = text.substr(position, length);
+        position += length + 1;
+        ++lineNumber;
+
+        for (size_t at = 0; at < length;) {
+            while (at < length && isSpace(start[at])) ++at;
+            if (at >= length || (start[at] == '/' && at + 1 < length && start[at + 1] == '/')) break;
+            const size_t first = at;
+            while (at < length && !isSpace(start[at])) ++at;
+            words.push_back(lineText.substr(first, at - first));
+        }
+        if (!words.empty()) return true;
+    }
+    return false;
+}
+
+size_t Tokenizer::column(size_t word) const {
+    if (word < words.size()) return static_cast<size_t>(words[word].data() - lineText.data()) + 1;
+    return lineText.size() + 1;
+}
+
+void Tokenizer::error(size_t word, const std::string& message) const {
+    ++errorCount;
+    std::cerr << source << ':' << lineNumber << ':' << column(word) << ": " << message << std::endl;
+}
+
+bool Tokenizer::equalsLower(std::string_view word, std::string_view lower) {
+    if (word.size() != lower.size()) return false;
+    for (size_t i = 0; i < word.size(); ++i) {
+        const char c = word[i] >= 'A' && word[i] <= 'Z' ? static_cast<char>(word[i] - 'A' + 'a') : word[i];
+        if (c != lower[i]) return false;
+    }
+    return true;
+}
+
+bool Tokenizer::busRange(std::string_view word, std::string_view& name, int& high, int& low) {
+    size_t at = 0;
+    while (at < word.size() && isNameCharacter(word[at])) ++at;
+    if (at == 0 || at >= word.size() || word[at] != '[' || word.back() != ']') return false;
+    name = word.substr(0, at);
+    const char* end = word.data() + word.size() - 1;
+    auto parsed = std::from_chars(word.data() + at + 1, end, high);
+    if (parsed.ec != std::errc() || parsed.ptr >= end || *parsed.ptr != ':') return false;
+    parsed = std::from_chars(parsed.ptr + 1, end, low);
+    return parsed.ec == std::errc() && parsed.ptr == end && high >= 0 && low >= 0;
+}
+
+bool Tokenizer::number(std::string_view word, size_t& value) {
+    auto parsed = std::from_chars(word.data(), word.data() + word.size(), value);
+    return parsed.ec == std::errc() && parsed.ptr == word.data() + word.size() && !word.empty();
+}
@@ -0,0 +1,157 @@
+#include "../includes/VcdWriter.h"
+#include "../includes/WireBus.h"
+#include <algorithm>
+#include <iostream>
+
+// VCD identifiers are short strings over the printable characters '!' to '~'
+static std::string identifier(size_t index) {
+    std::string id;
+    do {
+        id += static_cast<char>('!' + index % 94);
+        index /= 94;
+    } while (index > 0);
+    return id;
+}
+
+static char stateChar(WIRE_STATE state) {
+    switch (state) {
+        case WIRE_STATE::LOGIC_LOW:  return '0';
+        case WIRE_STATE::LOGIC_HIGH: return '1';
+        default:                     return 'x';
+    }
+}
+
+VcdWriter::VcdWriter(const std::string& path, const std::string& scope) : path(path), scope(scope) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot open VCD file for writing: " << path << std::endl;
+    }
+    buffer.reserve(BUFFER_SIZE);
+}
+
+VcdWriter::~VcdWriter() {
+    if (file) {
+        flush();
+        std::fclose(file);
+    }
+}
+
+void VcdWriter::begin(size_t) {
+    if (!file) return;
+    const size_t wireCount = Wire::wires.size();
+    signals.clear();
+    signalOf.assign(wireCount, UINT32_MAX);
+
+    // Buses first, in name order so the file is stable between runs
+    std::vector<std::string> busNames;
+    for (const auto& bus : WireBus::wireBusMap) {
+        if (!bus.second.empty()) busNames.push_back(bus.first);
+    }
+    std::sort(busNames.begin(), busNames.end());
+    for (const std::string& name : busNames) {
+        Signal signal{name, identifier(signals.size()), {}};
+        for (Wire* wire : WireBus::wireBusMap[name]) {
+            if (!wire || wire->getIndex() >= wireCount || signalOf[wire->getIndex()] != UINT32_MAX) {
+                signal.wires.clear();
+                break;
+            }
+            signal.wires.push_back(wire->getIndex());
+        }
+        if (signal.wires.empty()) continue;
+        for (uint32_t wire : signal.wires) signalOf[wire] = static_cast<uint32_t>(signals.size());
+        signals.push_back(std::move(signal));
+    }
+    for (uint32_t wire = 0; wire < wireCount; ++wire) {
+        if (signalOf[wire] != UINT32_MAX) continue;
+        signalOf[wire] = static_cast<uint32_t>(signals.size());
+        signals.push_back({Wire::wires[wire]->getName(), identifier(signals.size()), {wire}});
+    }
+
+    dirty.assign(signals.size(), 0);
+    changed.clear();
+    first = true;
+    writeHeader();
+}
+
+void VcdWriter::writeHeader() {
+    buffer += "$version Digital Logic Simulator $end\n";
+    buffer += "$timescale 1ns $end\n";
+    buffer += "$scope module " + scope + " $end\n";
+    for (const Signal& signal : signals) {
+        buffer += "$var wire " + std::to_string(signal.wires.size()) + " " + signal.id + " " + signal.name;
+        if (signal.wires.size() > 1) buffer += " [" + std::to_string(signal.wires.size() - 1) + ":0]";
+        buffer += " $end\n";
+    }
+    buffer += "$upscope $end\n$enddefinitions $end\n";
+}
+
+void VcdWriter::writeValue(const Signal& signal) {
+    if (signal.wires.size() == 1) {
+        buffer += stateChar(Wire::states.get(signal.wires[0]));
+    } else {
+        buffer += 'b';
+        for (size_t bit = signal.wires.size(); bit-- > 0;) {
+            buffer += stateChar(Wire::states.get(signal.wires[bit]));
+        }
+        buffer += ' ';
+    }
+    buffer += signal.id;
+    buffer += '\n';
+}
+
+void VcdWriter::sample(size_t cycle) {
+    if (!file) return;
+    const std::vector<uint64_t>& packed = Wire::states.packed();
+
+    if (first) {
+        buffer += "#" + std::to_string(cycle) + "\n$dumpvars\n";
+        for (const Signal& signal : signals) writeValue(signal);
+        buffer += "$end\n";
+        previous = packed;
+        first = false;
+    } else {
+        // Compare whole words of the packed store, then only look at the wires inside words that differ
+        for (size_t word = 0; word < previous.size(); ++word) {
+            uint64_t difference = packed[word] ^ previous[word];
+            while (difference) {
+                uint32_t bit = static_cast<uint32_t>(__builtin_ctzll(difference));
+                uint32_t wire = static_cast<uint32_t>(word * WireStates::WIRES_PER_WORD + bit / 2);
+                difference &= ~(3ull << (bit & ~1u));
+                if (wire >= signalOf.size()) continue;
+                uint32_t signal = signalOf[wire];
+                if (!dirty[signal]) {
+                    dirty[signal] = 1;
+                    changed.push_back(signal);
+                }
+            }
+            previous[word] = packed[word];
+        }
+        if (!changed.empty()) {
+            // Signals in declaration order, which keeps the output deterministic
+            std::sort(changed.begin(), changed.end());
+            buffer += "#" + std::to_string(cycle) + "\n";
+            for (uint32_t signal : changed) {
+                writeValue(signals[signal]);
+                dirty[signal] = 0;
+                if (buffer.size() >= BUFFER_SIZE - 4096) flush();
+            }
+            changed.clear();
+        }
+    }
+    if (buffer.size() >= BUFFER_SIZE - 4096) flush();
+}
+
+void VcdWriter::end(size_t cycles) {
+    if (!file) return;
+    // Closing timestamp so viewers show how long the last values held
+    buffer += "#" + std::to_string(cycles) + "\n";
+    flush();
+    std::fflush(file);
+}
+
+void VcdWriter::flush() {
+    if (!buffer.empty() && std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+        std::cerr << "Error writing VCD file: " << path << std::endl;
+    }
+    buffer.clear();
+}
@@ -0,0 +1,136 @@
+#include "../includes/WaveformQuery.h"
+#include <algorithm>
+#include <charconv>
+#include <sstream>
+
+// Entries of a wire or a bus, bit 0 first
+static std::vector<size_t> signalBits(const WaveformStore& waveform, const std::string& name) {
+    const size_t entry = waveform.find(name);
+    if (entry != SIZE_MAX) return {entry};
+    return waveform.busEntries(name);
+}
+
+// Decimal, or hex after 0x. A leading zero is still decimal, and from_chars refuses a sign.
+static bool parseNumber(const std::string& text, uint64_t& value) {
+    const bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+    const char* first = text.data() + (hex ? 2 : 0);
+    const char* end = text.data() + text.size();
+    const auto [last, error] = std::from_chars(first, end, value, hex ? 16 : 10);
+    return error == std::errc() && last == end;
+}
+
+std::string waveformValueAt(const WaveformStore& waveform, const std::vector<size_t>& bits, size_t cycle) {
+    std::string binary;
+    uint64_t value = 0;
+    bool defined = true;
+    for (size_t bit = bits.size(); bit-- > 0;) {
+        const WIRE_STATE state = waveform.at(bits[bit], cycle);
+        binary += state == WIRE_STATE::LOGIC_HIGH ? '1' : state == WIRE_STATE::LOGIC_LOW ? '0' : 'X';
+        if (state == WIRE_STATE::LOGIC_UNDEFINED || bit >= 64) defined = false;
+        else value |= uint64_t(state == WIRE_STATE::LOGIC_HIGH) << bit;
+    }
+    if (bits.size() == 1 || !defined) return binary;
+    std::ostringstream hex;
+    hex << "0x" << std::hex << std::uppercase << value;
+    return hex.str();
+}
+
+WaveformQueryResult runWaveformQuery(const WaveformStore& waveform, const std::string& query) {
+    WaveformQueryResult result;
+    std::istringstream in(query);
+    std::vector<std::string> words;
+    for (std::string word; in >> word;) words.push_back(word);
+    if (words.empty()) {
+        result.text = "empty query";
+        return result;
+    }
+    const std::string& command = words[0];
+
+    // Optional "<keyword> <cycle>" at the end of the query
+    auto trailingCycle = [&](const char* keyword, size_t& cycle) -> bool {
+        if (words.size() >= 2 && words[words.size() - 2] == keyword) {
+            uint64_t value;
+            if (!parseNumber(words.back(), value)) return false;
+            cycle = static_cast<size_t>(value);
+            words.resize(words.size() - 2);
+        }
+        return true;
+    };
+    auto fail = [&](const std::string& text) {
+        result.text = text;
+        return result;
+    };
+    auto lookup = [&](const std::string& name, std::vector<size_t>& bits) -> bool {
+        bits = signalBits(waveform, name);
+        return !bits.empty();
+    };
+    std::vector<size_t> bits;
+
+    if (command == "next" || command == "prev") {
+        const bool next = command == "next";
+        size_t cycle = next ? 0 : waveform.cycles();
+        if (!trailingCycle(next ? "after" : "before", cycle)) return fail("bad cycle number");
+        WaveformStore::EDGE edge = WaveformStore::EDGE::ANY;
+        size_t word = 1;
+        if (words.size() == 3 && (words[1] == "rising" || words[1] == "falling")) {
+            edge = words[1] == "rising" ? WaveformStore::EDGE::RISING : WaveformStore::EDGE::FALLING;
+            word = 2;
+        }
+        if (words.size() != word + 1) return fail("usage: " + command + " [rising|falling] <signal> [" + (next ? "after" : "before") + " <cycle>]");
+        if (!lookup(words[word], bits)) return fail("no signal " + words[word]);
+        if (bits.size() > 1 && edge != WaveformStore::EDGE::ANY) return fail("rising and falling need a single wire");
+        // A bus changes whenever any of its bits does
+        size_t found = SIZE_MAX;
+        for (size_t bit : bits) {
+            const size_t at = next ? waveform.nextEdge(bit, cycle, edge) : waveform.previousEdge(bit, cycle, edge);
+            if (at != SIZE_MAX && (found == SIZE_MAX || (next ? at < found : at > found))) found = at;
+        }
+        if (found == SIZE_MAX) return fail("no edge " + std::string(next ? "after" : "before") + " cycle " + std::to_string(cycle));
+        result.cycle = found;
+        result.text = "edge at cycle " + std::to_string(found) + ", now " + waveformValueAt(waveform, bits, found);
+    } else if (command == "value") {
+        uint64_t cycle;
+        if (words.size() != 3 || !parseNumber(words[2], cycle)) return fail("usage: value <signal> <cycle>");
+        if (!lookup(words[1], bits)) return fail("no signal " + words[1]);
+        if (cycle >= waveform.cycles()) return fail("cycle " + words[2] + " is past the end of the run");
+        result.cycle = static_cast<size_t>(cycle);
+        result.text = waveformValueAt(waveform, bits, result.cycle);
+    } else if (command == "count") {
+        uint64_t first = 0, last = waveform.cycles();
+        if ((words.size() != 2 && words.size() != 4) ||
+            (words.size() == 4 && (!parseNumber(words[2], first) || !parseNumber(words[3], last))))
+            return fail("usage: count <signal> [<first> <last>]");
+        if (!lookup(words[1], bits)) return fail("no signal " + words[1]);
+        if (bits.size() > 1) return fail("count needs a single wire");
+        result.text = std::to_string(waveform.countChanges(bits[0], first, last)) + " edges";
+    } else if (command == "find") {
+        size_t from = 0;
+        if (!trailingCycle("from", from)) return fail("bad cycle number");
+        const size_t split = words.size() == 2 ? words[1].find("==") : std::string::npos;
+        uint64_t value;
+        if (split == std::string::npos || !parseNumber(words[1].substr(split + 2), value))
+            return fail("usage: find <signal>==<value> [from <cycle>]");
+        const std::string name = words[1].substr(0, split);
+        if (!lookup(name, bits)) return fail("no signal " + name);
+        const size_t found = waveform.findValue(bits, value, from);
+        if (found == SIZE_MAX) return fail("not found from cycle " + std::to_string(from));
+        result.cycle = found;
+        result.text = "at cycle " + std::to_string(found);
+    } else if (command == "period") {
+        size_t from = 0;
+        if (!trailingCycle("from", from)) return fail("bad cycle number");
+        if (words.size() != 2) return fail("usage: period <signal> [from <cycle>]");
+        if (!lookup(words[1], bits)) return fail("no signal " + words[1]);
+        if (bits.size() > 1) return fail("period needs a single wire");
+        size_t period, high;
+        if (!waveform.measurePeriod(bits[0], from, period, high)) return fail("fewer than two rising edges from cycle " + std::to_string(from));
+        result.cycle = waveform.nextEdge(bits[0], from, WaveformStore::EDGE::RISING);
+        std::ostringstream text;
+        text << "period " << period << " cycles, high " << high << " (" << 100 * high / period << "% duty) from cycle " << result.cycle;
+        result.text = text.str();
+    } else {
+        return fail("unknown query " + command + " (next, prev, value, count, find, period)");
+    }
+    result.ok = true;
+    return result;
+}
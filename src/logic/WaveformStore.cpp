@@ -0,0 +1,706 @@
+#include "../includes/WaveformStore.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static const char DATABASE_MAGIC[8] = {'L', 'S', 'I', 'M', 'W', 'A', 'V', 'E'};
+static const uint32_t DATABASE_VERSION = 1;
+
+WaveformStore::~WaveformStore() {
+    if (output) std::fclose(output);
+}
+
+void WaveformStore::clear() {
+    if (output) {
+        // An unfinished recording is abandoned
+        std::fclose(output);
+        output = nullptr;
+    }
+    file.close();
+    sliceOffsets = nullptr;
+    groupMasks = nullptr;
+    groupChangeCounts = nullptr;
+    signalCount = 0;
+    sliceCount = 0;
+    groupCount = 0;
+
+    entries.clear();
+    signals.clear();
+    signalWires.clear();
+    pending.clear();
+    pendingCycles = 0;
+    cycleCount = 0;
+    ++generationCount;
+}
+
+void WaveformStore::begin(size_t) {
+    clear();
+    snapshotWords = Wire::states.packed().size();
+    pending.reserve(snapshotWords * BLOCK_CYCLES);
+
+    // One signal per wire, one entry per name that points at it
+    std::vector<uint32_t> signalOf(Wire::wires.size(), UINT32_MAX);
+    for (const auto& wire : Wire::wireMap) {
+        if (!wire.second) continue;
+        uint32_t handle = wire.second->getIndex();
+        if (signalOf[handle] == UINT32_MAX) {
+            signalOf[handle] = static_cast<uint32_t>(signalWires.size());
+            signalWires.push_back(handle);
+        }
+        entries.push_back({wire.first, signalOf[handle]});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+    lastStates.assign(signalWires.size(), 0);
+
+    if (!databasePath.empty()) {
+        output = std::fopen(databasePath.c_str(), "wb");
+        if (!output) {
+            std::cerr << "Cannot open waveform database for writing: " << databasePath << ", keeping the run in memory" << std::endl;
+        } else {
+            // Placeholder, rewritten by finishDatabase() once the counts are known
+            DatabaseHeader header{};
+            std::fwrite(&header, sizeof(header), 1, output);
+            outputOffset = sizeof(header);
+            writtenSlices.clear();
+            writtenGroups.clear();
+            writtenGroupChanges.clear();
+            return;
+        }
+    }
+    signals.resize(signalWires.size());
+}
+
+void WaveformStore::sample(size_t) {
+    const std::vector<uint64_t>& packed = Wire::states.packed();
+    pending.insert(pending.end(), packed.begin(), packed.begin() + snapshotWords);
+    ++cycleCount;
+    if (++pendingCycles == BLOCK_CYCLES) flushPending();
+}
+
+void WaveformStore::end(size_t) {
+    if (pendingCycles > 0) flushPending();
+    if (output) finishDatabase();
+    ++generationCount;
+    pending.clear();
+    pending.shrink_to_fit();
+}
+
+void WaveformStore::flushPending() {
+    uint8_t states[BLOCK_CYCLES];
+    const size_t count = signalWires.size();
+    if (output) {
+        // One slice: every signal's block header, then their bytes
+        const size_t index = writtenSlices.size();
+        const size_t group = index / GROUP_BLOCKS;
+        writtenGroups.resize((group + 1) * count, 0);
+        writtenGroupChanges.resize((group + 1) * count, 0);
+        slice.assign(count * sizeof(Block), 0);
+        for (size_t s = 0; s < count; ++s) {
+            for (size_t cycle = 0; cycle < pendingCycles; ++cycle) {
+                states[cycle] = static_cast<uint8_t>(WireStates::unpack(&pending[cycle * snapshotWords], signalWires[s]));
+            }
+            uint8_t mask;
+            uint32_t changes;
+            Block block = encodeBlock(states, pendingCycles, slice, mask, changes);
+            std::memcpy(slice.data() + s * sizeof(Block), &block, sizeof(Block));
+            writtenGroups[group * count + s] |= mask;
+            writtenGroupChanges[group * count + s] += changes + (index % GROUP_BLOCKS != 0 && states[0] != lastStates[s]);
+            lastStates[s] = states[pendingCycles - 1];
+        }
+        // Keep every slice 8 byte aligned so its headers can be read in place
+        slice.resize((slice.size() + 7) & ~size_t(7), 0);
+        if (std::fwrite(slice.data(), 1, slice.size(), output) != slice.size()) {
+            std::cerr << "Error writing waveform database: " << databasePath << std::endl;
+        }
+        writtenSlices.push_back(outputOffset);
+        outputOffset += slice.size();
+    } else {
+        for (size_t s = 0; s < count; ++s) {
+            for (size_t cycle = 0; cycle < pendingCycles; ++cycle) {
+                states[cycle] = static_cast<uint8_t>(WireStates::unpack(&pending[cycle * snapshotWords], signalWires[s]));
+            }
+            Signal& signal = signals[s];
+            const size_t index = signal.blocks.size();
+            uint8_t mask;
+            uint32_t changes;
+            signal.blocks.push_back(encodeBlock(states, pendingCycles, signal.data, mask, changes));
+            signal.groups.resize(index / GROUP_BLOCKS + 1, 0);
+            signal.groupChanges.resize(index / GROUP_BLOCKS + 1, 0);
+            signal.groups.back() |= mask;
+            signal.groupChanges.back() += changes + (index % GROUP_BLOCKS != 0 && states[0] != lastStates[s]);
+            lastStates[s] = states[pendingCycles - 1];
+        }
+    }
+    pending.clear();
+    pendingCycles = 0;
+}
+
+void WaveformStore::finishDatabase() {
+    const size_t count = signalWires.size();
+    const size_t groups = (writtenSlices.size() + GROUP_BLOCKS - 1) / GROUP_BLOCKS;
+    DatabaseHeader header{};
+    std::memcpy(header.magic, DATABASE_MAGIC, sizeof(header.magic));
+    header.version = DATABASE_VERSION;
+    header.signalCount = static_cast<uint32_t>(count);
+    header.cycleCount = cycleCount;
+    header.sliceCount = writtenSlices.size();
+    header.groupCount = groups;
+    header.footerOffset = outputOffset;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+
+    // Footer: slice offsets, group change counts and masks per signal, names
+    bool written = std::fwrite(writtenSlices.data(), sizeof(uint64_t), writtenSlices.size(), output) == writtenSlices.size();
+    std::vector<uint32_t> changes(count * groups);
+    std::vector<uint8_t> masks(count * groups);
+    for (size_t group = 0; group < groups; ++group) {
+        for (size_t s = 0; s < count; ++s) {
+            changes[s * groups + group] = writtenGroupChanges[group * count + s];
+            masks[s * groups + group] = writtenGroups[group * count + s];
+        }
+    }
+    written = written && std::fwrite(changes.data(), sizeof(uint32_t), changes.size(), output) == changes.size();
+    written = written && std::fwrite(masks.data(), 1, masks.size(), output) == masks.size();
+    for (const Entry& entry : entries) {
+        const uint32_t record[2] = {entry.signal, static_cast<uint32_t>(entry.name.size())};
+        written = written && std::fwrite(record, sizeof(record), 1, output) == 1;
+        written = written && std::fwrite(entry.name.data(), 1, entry.name.size(), output) == entry.name.size();
+    }
+    written = written && std::fseek(output, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, output) == 1;
+    written = std::fclose(output) == 0 && written;
+    output = nullptr;
+    writtenSlices.clear();
+    writtenGroups.clear();
+    writtenGroupChanges.clear();
+    slice.clear();
+    slice.shrink_to_fit();
+
+    if (!written) {
+        std::cerr << "Error writing waveform database: " << databasePath << std::endl;
+        clear();
+        return;
+    }
+    load(databasePath);
+}
+
+bool WaveformStore::load(const std::string& path) {
+    clear();
+    if (!file.open(path)) {
+        std::cerr << "Cannot open waveform database: " << path << std::endl;
+        return false;
+    }
+    const uint8_t* bytes = file.data();
+    const size_t size = file.size();
+
+    // The counts are divided up rather than rounded up by adding, so a cycle count near UINT64_MAX can't wrap
+    // around to zero slices
+    DatabaseHeader header{};
+    bool valid = size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, bytes, sizeof(header));
+        valid = std::memcmp(header.magic, DATABASE_MAGIC, sizeof(header.magic)) == 0 && header.version == DATABASE_VERSION &&
+                header.sliceCount == header.cycleCount / BLOCK_CYCLES + (header.cycleCount % BLOCK_CYCLES != 0) &&
+                header.groupCount == header.sliceCount / GROUP_BLOCKS + (header.sliceCount % GROUP_BLOCKS != 0) && header.footerOffset % 8 == 0 &&
+                header.footerOffset <= size && (size - header.footerOffset) / 8 >= header.sliceCount &&
+                (size - header.footerOffset - header.sliceCount * 8) / 5 >= uint64_t(header.signalCount) * header.groupCount;
+    }
+    if (valid) {
+        sliceOffsets = reinterpret_cast<const uint64_t*>(bytes + header.footerOffset);
+        for (size_t s = 0; s < header.sliceCount && valid; ++s) {
+            valid = sliceOffsets[s] % 8 == 0 && sliceOffsets[s] + uint64_t(header.signalCount) * sizeof(Block) <= header.footerOffset;
+        }
+        // Every block header has to describe bytes inside its own slice, so reading a block never leaves the file.
+        // Only the headers are touched, the block bytes stay unread until they are looked at.
+        for (size_t s = 0; s < header.sliceCount && valid; ++s) {
+            const uint64_t sliceEnd = s + 1 < header.sliceCount ? sliceOffsets[s + 1] : header.footerOffset;
+            const size_t length = std::min<uint64_t>(BLOCK_CYCLES, header.cycleCount - s * BLOCK_CYCLES);
+            valid = sliceEnd >= sliceOffsets[s] + uint64_t(header.signalCount) * sizeof(Block) && sliceEnd <= header.footerOffset;
+            const Block* blocks = reinterpret_cast<const Block*>(bytes + sliceOffsets[s]);
+            for (uint32_t signal = 0; signal < header.signalCount && valid; ++signal) {
+                valid = validBlock(blocks[signal], length, sliceEnd - sliceOffsets[s]);
+            }
+        }
+    }
+    // Names
+    const size_t groupTables = size_t(header.signalCount) * header.groupCount;
+    size_t position = valid ? header.footerOffset + header.sliceCount * 8 + groupTables * 5 : 0;
+    for (uint32_t e = 0; e < header.entryCount && valid; ++e) {
+        uint32_t record[2];
+        valid = size - position >= sizeof(record);
+        if (!valid) break;
+        std::memcpy(record, bytes + position, sizeof(record));
+        position += sizeof(record);
+        valid = record[0] < header.signalCount && size - position >= record[1];
+        if (!valid) break;
+        entries.push_back({std::string(reinterpret_cast<const char*>(bytes + position), record[1]), record[0]});
+        position += record[1];
+    }
+    if (!valid) {
+        std::cerr << "Invalid waveform database: " << path << std::endl;
+        clear();
+        return false;
+    }
+
+    groupChangeCounts = reinterpret_cast<const uint32_t*>(bytes + header.footerOffset + header.sliceCount * 8);
+    groupMasks = bytes + header.footerOffset + header.sliceCount * 8 + groupTables * 4;
+    signalCount = header.signalCount;
+    sliceCount = header.sliceCount;
+    groupCount = header.groupCount;
+    cycleCount = header.cycleCount;
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+    return true;
+}
+
+void WaveformStore::assign(const std::unordered_map<std::string, std::vector<WIRE_STATE>>& states) {
+    clear();
+    for (const auto& wire : states) {
+        cycleCount = std::max(cycleCount, wire.second.size());
+    }
+    for (const auto& wire : states) {
+        entries.push_back({wire.first, static_cast<uint32_t>(signals.size())});
+        signals.emplace_back();
+        Signal& signal = signals.back();
+        uint8_t block[BLOCK_CYCLES];
+        uint8_t lastState = 0;
+        for (size_t first = 0; first < cycleCount; first += BLOCK_CYCLES) {
+            size_t count = std::min<size_t>(BLOCK_CYCLES, cycleCount - first);
+            for (size_t i = 0; i < count; ++i) {
+                // Short traces hold their last state
+                size_t cycle = std::min(first + i, wire.second.size() - 1);
+                block[i] = wire.second.empty() ? static_cast<uint8_t>(WIRE_STATE::LOGIC_UNDEFINED) : static_cast<uint8_t>(wire.second[cycle]);
+            }
+            const size_t index = signal.blocks.size();
+            uint8_t mask;
+            uint32_t changes;
+            signal.blocks.push_back(encodeBlock(block, count, signal.data, mask, changes));
+            signal.groups.resize(index / GROUP_BLOCKS + 1, 0);
+            signal.groupChanges.resize(index / GROUP_BLOCKS + 1, 0);
+            signal.groups.back() |= mask;
+            signal.groupChanges.back() += changes + (index % GROUP_BLOCKS != 0 && block[0] != lastState);
+            lastState = block[count - 1];
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.name < b.name; });
+}
+
+WaveformStore::Block WaveformStore::encodeBlock(const uint8_t* states, size_t count, std::vector<uint8_t>& data, uint8_t& mask, uint32_t& changes) {
+    Block block{0, 0, ENCODING::CHANGES, states[0]};
+    uint8_t list[2 * BLOCK_CYCLES]; // offset, state pairs
+    size_t changeCount = 0;
+    mask = 1 << states[0];
+    for (size_t i = 1; i < count; ++i) {
+        if (states[i] != states[i - 1]) {
+            list[2 * changeCount] = static_cast<uint8_t>(i);
+            list[2 * changeCount + 1] = states[i];
+            ++changeCount;
+            mask |= 1 << states[i];
+        }
+    }
+    block.count = static_cast<uint16_t>(changeCount);
+    changes = static_cast<uint32_t>(changeCount);
+
+    // Periodic: alternates between the initial state and one other state at a fixed interval
+    if (changeCount >= 2) {
+        const uint8_t period = list[2] - list[0];
+        const uint8_t other = list[1];
+        bool periodic = other != block.initial;
+        for (size_t c = 0; c < changeCount && periodic; ++c) {
+            periodic = list[2 * c] == list[0] + c * period && list[2 * c + 1] == (c % 2 == 0 ? other : block.initial);
+        }
+        if (periodic) {
+            block.encoding = ENCODING::PERIODIC;
+            block.data = list[0] | (uint32_t(period) << 8) | (uint32_t(other) << 16);
+            return block;
+        }
+    }
+
+    const size_t denseBytes = (count + 3) / 4;
+    block.data = static_cast<uint32_t>(data.size());
+    if (2 * changeCount <= denseBytes) {
+        data.insert(data.end(), list, list + 2 * changeCount);
+    } else {
+        block.encoding = ENCODING::DENSE;
+        block.count = mask;
+        data.resize(data.size() + denseBytes, 0);
+        for (size_t i = 0; i < count; ++i) {
+            data[block.data + i / 4] |= states[i] << ((i % 4) * 2);
+        }
+    }
+    return block;
+}
+
+bool WaveformStore::validBlock(const Block& block, size_t count, uint64_t dataSize) {
+    if (block.initial > 2) return false;
+    switch (block.encoding) {
+        case ENCODING::CHANGES:
+            return block.count < count && uint64_t(block.data) + 2 * block.count <= dataSize;
+        case ENCODING::PERIODIC: {
+            const uint32_t first = block.data & 0xFF, period = (block.data >> 8) & 0xFF, other = block.data >> 16;
+            return block.count > 0 && period > 0 && other <= 2 && first + (block.count - 1) * period < count;
+        }
+        case ENCODING::DENSE:
+            return uint64_t(block.data) + (count + 3) / 4 <= dataSize;
+    }
+    return false;
+}
+
+uint8_t WaveformStore::blockState(const Block& block, const uint8_t* data, uint32_t offset) {
+    switch (block.encoding) {
+        case ENCODING::DENSE:
+            return storedState((data[block.data + offset / 4] >> ((offset % 4) * 2)) & 3);
+        case ENCODING::PERIODIC: {
+            const uint32_t first = block.data & 0xFF, period = (block.data >> 8) & 0xFF;
+            if (offset < first) return block.initial;
+            size_t change = std::min<size_t>((offset - first) / period, block.count - 1);
+            return change % 2 == 0 ? static_cast<uint8_t>(block.data >> 16) : block.initial;
+        }
+        default: {
+            // Last change at or before the offset
+            const uint8_t* changes = data + block.data;
+            size_t low = 0, high = block.count;
+            while (low < high) {
+                size_t middle = (low + high) / 2;
+                if (changes[2 * middle] <= offset) low = middle + 1;
+                else high = middle;
+            }
+            return low == 0 ? block.initial : storedState(changes[2 * (low - 1) + 1]);
+        }
+    }
+}
+
+uint8_t WaveformStore::blockStates(const Block& block, const uint8_t* data, uint32_t from, uint32_t to) {
+    uint8_t mask = 1 << blockState(block, data, from);
+    switch (block.encoding) {
+        case ENCODING::DENSE:
+            // Stop as soon as every state of the block has been seen
+            for (uint32_t offset = from + 1; offset < to && mask != block.count; ++offset) {
+                mask |= 1 << storedState((data[block.data + offset / 4] >> ((offset % 4) * 2)) & 3);
+            }
+            return mask;
+        case ENCODING::PERIODIC: {
+            const uint32_t first = block.data & 0xFF, period = (block.data >> 8) & 0xFF;
+            // First change after `from`
+            const uint32_t change = from < first ? 0 : (from - first) / period + 1;
+            if (change < block.count && first + change * period < to) {
+                mask |= (1 << block.initial) | (1 << ((block.data >> 16) & 0xFF));
+            }
+            return mask;
+        }
+        default: {
+            const uint8_t* changes = data + block.data;
+            size_t low = 0, high = block.count;
+            while (low < high) {
+                size_t middle = (low + high) / 2;
+                if (changes[2 * middle] <= from) low = middle + 1;
+                else high = middle;
+            }
+            for (size_t c = low; c < block.count && changes[2 * c] < to && mask != 7; ++c) {
+                mask |= 1 << storedState(changes[2 * c + 1]);
+            }
+            return mask;
+        }
+    }
+}
+
+size_t WaveformStore::blockCount(uint32_t signal) const {
+    return file.isOpen() ? sliceCount : signals[signal].blocks.size();
+}
+
+const WaveformStore::Block& WaveformStore::blockAt(uint32_t signal, size_t index, const uint8_t*& data) const {
+    if (file.isOpen()) {
+        data = file.data() + sliceOffsets[index];
+        return reinterpret_cast<const Block*>(data)[signal];
+    }
+    data = signals[signal].data.data();
+    return signals[signal].blocks[index];
+}
+
+uint8_t WaveformStore::groupStates(uint32_t signal, size_t group) const {
+    return file.isOpen() ? groupMasks[signal * groupCount + group] : signals[signal].groups[group];
+}
+
+uint32_t WaveformStore::groupEdges(uint32_t signal, size_t group) const {
+    return file.isOpen() ? groupChangeCounts[signal * groupCount + group] : signals[signal].groupChanges[group];
+}
+
+size_t WaveformStore::blockLength(size_t block) const {
+    return std::min<size_t>(BLOCK_CYCLES, cycleCount - block * BLOCK_CYCLES);
+}
+
+uint8_t WaveformStore::statesIn(size_t entry, size_t first, size_t last) const {
+    const uint32_t signal = entries[entry].signal;
+    const size_t groupCycles = size_t(BLOCK_CYCLES) * GROUP_BLOCKS;
+    last = std::min(last, cycleCount);
+    uint8_t mask = 0;
+    while (first < last && mask != 7) {
+        if (first % groupCycles == 0 && last - first >= groupCycles) {
+            mask |= groupStates(signal, first / groupCycles);
+            first += groupCycles;
+            continue;
+        }
+        const size_t block = first / BLOCK_CYCLES;
+        const size_t blockStart = block * BLOCK_CYCLES;
+        const uint32_t to = static_cast<uint32_t>(std::min<size_t>(BLOCK_CYCLES, last - blockStart));
+        const uint8_t* data;
+        const Block& header = blockAt(signal, block, data);
+        mask |= blockStates(header, data, static_cast<uint32_t>(first - blockStart), to);
+        first = blockStart + to;
+    }
+    return mask;
+}
+
+size_t WaveformStore::find(const std::string& name) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const Entry& entry, const std::string& key) { return entry.name < key; });
+    return it != entries.end() && it->name == name ? static_cast<size_t>(it - entries.begin()) : SIZE_MAX;
+}
+
+uint8_t WaveformStore::stateAt(uint32_t signal, size_t cycle) const {
+    const size_t block = cycle / BLOCK_CYCLES;
+    if (block >= blockCount(signal)) return static_cast<uint8_t>(WIRE_STATE::LOGIC_UNDEFINED);
+    const uint8_t* data;
+    const Block& header = blockAt(signal, block, data);
+    return blockState(header, data, cycle % BLOCK_CYCLES);
+}
+
+WIRE_STATE WaveformStore::at(size_t entry, size_t cycle) const {
+    return static_cast<WIRE_STATE>(stateAt(entries[entry].signal, cycle));
+}
+
+static void edgeMasks(WaveformStore::EDGE edge, uint8_t& fromMask, uint8_t& toMask) {
+    const uint8_t low = 1 << static_cast<int>(WIRE_STATE::LOGIC_LOW), high = 1 << static_cast<int>(WIRE_STATE::LOGIC_HIGH);
+    switch (edge) {
+        case WaveformStore::EDGE::RISING:  fromMask = low;  toMask = high; break;
+        case WaveformStore::EDGE::FALLING: fromMask = high; toMask = low;  break;
+        default:                           fromMask = 7;    toMask = 7;    break;
+    }
+}
+
+// The single state of a mask with one bit set
+static uint8_t onlyState(uint8_t mask) {
+    return mask == 1 ? 0 : mask == 2 ? 1 : 2;
+}
+
+size_t WaveformStore::nextChange(uint32_t signal, size_t after, uint8_t fromMask, uint8_t toMask) const {
+    if (after + 1 >= cycleCount) return SIZE_MAX;
+    const size_t groupCycles = size_t(BLOCK_CYCLES) * GROUP_BLOCKS;
+    auto matches = [&](uint8_t from, uint8_t to) { return from != to && ((fromMask >> from) & 1) && ((toMask >> to) & 1); };
+    std::vector<std::pair<uint16_t, uint8_t>> changes;
+    uint8_t previous = stateAt(signal, after);
+    size_t cycle = after + 1;
+    while (cycle < cycleCount) {
+        // A group in a single state can only have an edge at its first cycle
+        if (cycle % groupCycles == 0 && cycle + groupCycles <= cycleCount) {
+            const uint8_t mask = groupStates(signal, cycle / groupCycles);
+            if ((mask & (mask - 1)) == 0) {
+                if (matches(previous, onlyState(mask))) return cycle;
+                previous = onlyState(mask);
+                cycle += groupCycles;
+                continue;
+            }
+        }
+        const size_t block = cycle / BLOCK_CYCLES;
+        const size_t start = block * BLOCK_CYCLES;
+        const uint8_t* data;
+        const Block& header = blockAt(signal, block, data);
+        decodeChanges(header, data, blockLength(block), changes);
+        for (const auto& change : changes) {
+            if (start + change.first < cycle) continue;
+            if (matches(previous, change.second)) return start + change.first;
+            previous = change.second;
+        }
+        cycle = start + blockLength(block);
+    }
+    return SIZE_MAX;
+}
+
+size_t WaveformStore::nextEdge(size_t entry, size_t after, EDGE edge) const {
+    uint8_t fromMask, toMask;
+    edgeMasks(edge, fromMask, toMask);
+    return nextChange(entries[entry].signal, after, fromMask, toMask);
+}
+
+size_t WaveformStore::previousEdge(size_t entry, size_t before, EDGE edge) const {
+    uint8_t fromMask, toMask;
+    edgeMasks(edge, fromMask, toMask);
+    auto matches = [&](uint8_t from, uint8_t to) { return from != to && ((fromMask >> from) & 1) && ((toMask >> to) & 1); };
+    const uint32_t signal = entries[entry].signal;
+    const size_t groupCycles = size_t(BLOCK_CYCLES) * GROUP_BLOCKS;
+    std::vector<std::pair<uint16_t, uint8_t>> changes;
+    // Edges are searched at cycles below `cycle`, walking backwards
+    size_t cycle = std::min(before, cycleCount);
+    while (cycle > 1) {
+        if (cycle % groupCycles == 0) {
+            const uint8_t mask = groupStates(signal, cycle / groupCycles - 1);
+            if ((mask & (mask - 1)) == 0) {
+                const size_t groupStart = cycle - groupCycles;
+                if (groupStart > 0 && matches(stateAt(signal, groupStart - 1), onlyState(mask))) return groupStart;
+                cycle = groupStart;
+                continue;
+            }
+        }
+        const size_t block = (cycle - 1) / BLOCK_CYCLES;
+        const size_t start = block * BLOCK_CYCLES;
+        const uint8_t* data;
+        const Block& header = blockAt(signal, block, data);
+        decodeChanges(header, data, blockLength(block), changes);
+        for (size_t c = changes.size(); c-- > 0;) {
+            const size_t at = start + changes[c].first;
+            if (at >= cycle) continue;
+            if (at == 0) break;
+            const uint8_t from = c > 0 ? changes[c - 1].second : stateAt(signal, start - 1);
+            if (matches(from, changes[c].second)) return at;
+        }
+        cycle = start;
+    }
+    return SIZE_MAX;
+}
+
+size_t WaveformStore::countChanges(size_t entry, size_t first, size_t last) const {
+    const uint32_t signal = entries[entry].signal;
+    const size_t groupCycles = size_t(BLOCK_CYCLES) * GROUP_BLOCKS;
+    std::vector<std::pair<uint16_t, uint8_t>> changes;
+    last = std::min(last, cycleCount);
+    size_t count = 0;
+    size_t cycle = first + 1;
+    while (cycle < last) {
+        if (cycle % groupCycles == 0 && cycle + groupCycles <= last) {
+            count += stateAt(signal, cycle - 1) != stateAt(signal, cycle);
+            count += groupEdges(signal, cycle / groupCycles);
+            cycle += groupCycles;
+            continue;
+        }
+        const size_t block = cycle / BLOCK_CYCLES;
+        const size_t start = block * BLOCK_CYCLES;
+        const size_t end = std::min(start + blockLength(block), last);
+        const uint8_t* data;
+        const Block& header = blockAt(signal, block, data);
+        if (cycle == start && end == start + blockLength(block) && header.encoding != ENCODING::DENSE) {
+            // Whole block: the header has the count
+            count += (stateAt(signal, start - 1) != header.initial) + header.count;
+        } else {
+            decodeChanges(header, data, blockLength(block), changes);
+            for (size_t c = 0; c < changes.size(); ++c) {
+                const size_t at = start + changes[c].first;
+                if (at < cycle) continue;
+                if (at >= end) break;
+                count += c > 0 || stateAt(signal, at - 1) != changes[c].second;
+            }
+        }
+        cycle = end;
+    }
+    return count;
+}
+
+bool WaveformStore::measurePeriod(size_t entry, size_t after, size_t& period, size_t& high) const {
+    const size_t rise = nextEdge(entry, after, EDGE::RISING);
+    if (rise == SIZE_MAX) return false;
+    const size_t nextRise = nextEdge(entry, rise, EDGE::RISING);
+    if (nextRise == SIZE_MAX) return false;
+    period = nextRise - rise;
+    high = std::min(nextEdge(entry, rise, EDGE::FALLING), nextRise) - rise;
+    return true;
+}
+
+std::vector<size_t> WaveformStore::busEntries(const std::string& bus) const {
+    std::vector<size_t> bits;
+    for (size_t bit = 0;; ++bit) {
+        const size_t entry = find(bus + "[" + std::to_string(bit) + "]");
+        if (entry == SIZE_MAX) break;
+        bits.push_back(entry);
+    }
+    return bits;
+}
+
+size_t WaveformStore::findValue(const std::vector<size_t>& bits, uint64_t value, size_t from) const {
+    if (bits.empty() || bits.size() > 64 || (bits.size() < 64 && (value >> bits.size()) != 0)) return SIZE_MAX;
+    size_t cycle = from;
+    while (cycle < cycleCount) {
+        bool found = true;
+        for (size_t bit = 0; bit < bits.size(); ++bit) {
+            const uint8_t wanted = static_cast<uint8_t>((value >> bit) & 1); // LOGIC_LOW or LOGIC_HIGH
+            const uint32_t signal = entries[bits[bit]].signal;
+            if (stateAt(signal, cycle) != wanted) {
+                // Jump to where this bit next has the wanted value, and check every bit again from there
+                cycle = nextChange(signal, cycle, 7, 1 << wanted);
+                found = false;
+                break;
+            }
+        }
+        if (found) return cycle;
+    }
+    return SIZE_MAX;
+}
+
+WaveformStore::Transitions::Transitions(const WaveformStore& store, uint32_t signal, size_t fromCycle) : store(store), signal(signal) {
+    if (fromCycle == 0) return;
+    block = fromCycle / BLOCK_CYCLES;
+    if (block >= store.blockCount(signal) || fromCycle >= store.cycleCount) {
+        block = store.blockCount(signal);
+        return;
+    }
+    // Start at the last change at or before fromCycle, reported as happening at fromCycle
+    decodeBlock();
+    const uint16_t offset = static_cast<uint16_t>(fromCycle % BLOCK_CYCLES);
+    while (position + 1 < pending.size() && pending[position + 1].first <= offset) ++position;
+    pending[position].first = offset;
+}
+
+void WaveformStore::decodeChanges(const Block& block, const uint8_t* data, size_t count, std::vector<std::pair<uint16_t, uint8_t>>& changes) {
+    changes.clear();
+    changes.emplace_back(0, block.initial);
+    switch (block.encoding) {
+        case ENCODING::CHANGES:
+            for (size_t c = 0; c < block.count; ++c) {
+                changes.emplace_back(data[block.data + 2 * c], storedState(data[block.data + 2 * c + 1]));
+            }
+            break;
+        case ENCODING::PERIODIC: {
+            const uint32_t first = block.data & 0xFF, period = (block.data >> 8) & 0xFF;
+            const uint8_t other = static_cast<uint8_t>(block.data >> 16);
+            for (size_t c = 0; c < block.count; ++c) {
+                changes.emplace_back(static_cast<uint16_t>(first + c * period), c % 2 == 0 ? other : block.initial);
+            }
+            break;
+        }
+        case ENCODING::DENSE:
+            for (uint32_t offset = 1; offset < count; ++offset) {
+                uint8_t state = blockState(block, data, offset);
+                if (state != changes.back().second) changes.emplace_back(offset, state);
+            }
+            break;
+    }
+}
+
+void WaveformStore::Transitions::decodeBlock() {
+    const uint8_t* data;
+    const Block& current = store.blockAt(signal, block, data);
+    decodeChanges(current, data, store.blockLength(block), pending);
+    position = 0;
+}
+
+bool WaveformStore::Transitions::next(size_t& cycle, WIRE_STATE& state) {
+    const size_t blocks = store.blockCount(signal);
+    while (true) {
+        if (position >= pending.size()) {
+            if (block >= blocks) return false;
+            if (!pending.empty()) ++block;
+            if (block >= blocks) return false;
+            decodeBlock();
+        }
+        const auto& change = pending[position++];
+        // A block starting in the state the previous one ended in is not a transition
+        if (change.second == last) continue;
+        last = change.second;
+        cycle = block * BLOCK_CYCLES + change.first;
+        state = static_cast<WIRE_STATE>(change.second);
+        return true;
+    }
+}
+
+size_t WaveformStore::memoryBytes() const {
+    size_t bytes = entries.capacity() * sizeof(Entry) + signals.capacity() * sizeof(Signal);
+    for (const Signal& signal : signals) {
+        bytes += signal.blocks.capacity() * sizeof(Block) + signal.data.capacity() + signal.groups.capacity() +
+                 signal.groupChanges.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
@@ -1,5 +1,63 @@
 #include "../includes/Wire.h"
+#include "../includes/Tokenizer.h"
 #include <unordered_map>
 #include <string>
 
 std::unordered_map<std::string, Wire*> Wire::wireMap;
+WireStates Wire::states;
+std::vector<Wire*> Wire::wires;
+std::vector<uint32_t> Wire::clocks;
+std::vector<ClockTiming> Wire::clockTimings;
+
+bool ClockTiming::parse(const Tokenizer& words, size_t first, const std::function<const ClockTiming*(std::string_view)>& findClock,
+                        ClockTiming& timing) {
+    timing = ClockTiming();
+    const std::string_view periodWord = words[first];
+    if (periodWord.empty()) return true;
+
+    size_t value;
+    const size_t slash = periodWord.find('/');
+    const bool divided = slash != std::string_view::npos;
+    if (divided) {
+        // A divided clock rises on every divider-th rising edge of its source and keeps its duty cycle
+        const ClockTiming* source = findClock(periodWord.substr(0, slash));
+        if (!source) {
+            words.error(first, "unknown clock " + std::string(periodWord.substr(0, slash)));
+            return false;
+        }
+        if (!Tokenizer::number(periodWord.substr(slash + 1), value) || value == 0 || value > UINT32_MAX / source->period) {
+            words.error(first, "invalid clock divider " + std::string(periodWord.substr(slash + 1)));
+            return false;
+        }
+        timing.period = source->period * static_cast<uint32_t>(value);
+        timing.high = source->high * static_cast<uint32_t>(value);
+        timing.phase = source->phase % timing.period;
+    } else {
+        if (!Tokenizer::number(periodWord, value) || value < 2 || value > UINT32_MAX) {
+            words.error(first, "clock period has to be at least 2 cycles");
+            return false;
+        }
+        timing.period = static_cast<uint32_t>(value);
+        timing.high = timing.period / 2;
+    }
+
+    const std::string_view phaseWord = words[first + 1];
+    if (!phaseWord.empty() && phaseWord != "-") {
+        if (!Tokenizer::number(phaseWord, value)) {
+            words.error(first + 1, "invalid clock phase " + std::string(phaseWord));
+            return false;
+        }
+        timing.phase = static_cast<uint32_t>(value % timing.period);
+    }
+    const std::string_view highWord = words[first + 2];
+    if (!highWord.empty() && highWord != "-") {
+        if (!Tokenizer::number(highWord, value) || value == 0 || value >= timing.period) {
+            words.error(first + 2, "clock has to be high for 1 to " + std::to_string(timing.period - 1) + " cycles");
+            return false;
+        }
+        timing.high = static_cast<uint32_t>(value);
+    }
+    // Unless told otherwise, a clock starts low and rises once the low part of its period is over
+    if (!divided && (phaseWord.empty() || phaseWord == "-")) timing.phase = timing.period - timing.high;
+    return true;
+}
@@ -1,3 +1,54 @@
 #include "../includes/WireBus.h"
+#include <algorithm>
 
-std::unordered_map<std::string, std::vector<Wire*>> WireBus::wireBusMap;
\ No newline at end of file
+std::unordered_map<std::string, std::vector<Wire*>> WireBus::wireBusMap;
+
+bool WireBus::consecutive(const std::vector<Wire*>& bus) {
+    for (size_t i = 0; i < bus.size(); ++i) {
+        if (!bus[i] || bus[i]->getIndex() != bus[0]->getIndex() + i) return false;
+    }
+    return !bus.empty();
+}
+
+uint64_t WireBus::value(const std::vector<Wire*>& bus, bool consecutive, bool& defined) {
+    uint64_t result = 0;
+    defined = true;
+    for (size_t first = 0; first < bus.size(); first += 64) {
+        uint64_t high, unknown;
+        read(bus, consecutive, first, high, unknown);
+        if (unknown) defined = false;
+        if (first == 0) result = high;
+        else if (high) result = UINT64_MAX;
+    }
+    return result;
+}
+
+void WireBus::read(const std::vector<Wire*>& bus, bool consecutive, size_t first, uint64_t& value, uint64_t& unknown) {
+    const size_t count = std::min<size_t>(64, bus.size() - first);
+    if (consecutive) {
+        Wire::states.bits(bus[first]->getIndex(), static_cast<uint32_t>(count), value, unknown);
+        return;
+    }
+    value = unknown = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const WIRE_STATE state = bus[first + i] ? bus[first + i]->getState() : WIRE_STATE::LOGIC_UNDEFINED;
+        if (state == WIRE_STATE::LOGIC_HIGH) value |= uint64_t(1) << i;
+        if (state == WIRE_STATE::LOGIC_UNDEFINED) unknown |= uint64_t(1) << i;
+    }
+}
+
+void WireBus::drive(const std::vector<Wire*>& bus, bool consecutive, size_t first, uint64_t value, uint64_t unknown) {
+    const size_t count = std::min<size_t>(64, bus.size() - first);
+    if (!consecutive) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!bus[first + i]) continue;
+            bus[first + i]->setState((unknown >> i) & 1 ? WIRE_STATE::LOGIC_UNDEFINED
+                                     : (value >> i) & 1 ? WIRE_STATE::LOGIC_HIGH : WIRE_STATE::LOGIC_LOW);
+        }
+        return;
+    }
+    const uint32_t wire = bus[first]->getIndex();
+    for (uint64_t changed = Wire::states.setBits(wire, static_cast<uint32_t>(count), value, unknown); changed; changed &= changed - 1) {
+        Scheduler::wireChanged(wire + static_cast<uint32_t>(__builtin_ctzll(changed)));
+    }
+}